@@ -6,6 +6,7 @@ in FragData {
     vec3 vWorldPos;
     vec3 vNormal;
     vec2 vTexCoords;
+    flat vec4 vBaseColorFactor;
     // Noperspective so the interpolation is in screen-space
     noperspective vec3 wireframeDist;
 } fragData;
@@ -18,7 +19,7 @@ void main() {
 
     vec2 uv = fragData.vTexCoords;
 
-    vec4 color = texture(albedoMap, uv);//pow(texture(albedoMap, uv).rgb, vec2(2.2));
+    vec4 color = texture(albedoMap, uv) * fragData.vBaseColorFactor;//pow(texture(albedoMap, uv).rgb, vec2(2.2));
 
     // Wireframe
     if (render_wireframe > 0) {
@@ -10,17 +10,24 @@ layout (std140, binding = 0) uniform Matrices {
 };
 
 uniform mat4 modelMatrix;
+uniform vec4 baseColorFactor;
+// Maps quantized positions back to local space, identity for float vertices (see GLVertexLayout)
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 out VertexData {
     out vec3 vWorldPos;
     out vec3 vNormal;
     out vec2 vTexCoords;
+    flat out vec4 vBaseColorFactor;
 } vertexData;
 
 void main() {
     vertexData.vTexCoords = aTexCoords;
+    vertexData.vBaseColorFactor = baseColorFactor;
 
-    vertexData.vWorldPos = vec3(modelMatrix * vec4(aPosition, 1.0));
+    vec3 position = positionOffset + aPosition * positionScale;
+    vertexData.vWorldPos = vec3(modelMatrix * vec4(position, 1.0));
     vertexData.vNormal = mat3(modelMatrix) * aNormal;
 
     gl_Position = projection * view * vec4(vertexData.vWorldPos, 1.0);
@@ -0,0 +1,50 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// Instanced draw id, advanced by the indirect command's baseInstance
+layout (location = 3) in uint aDrawId;
+
+layout (std140, binding = 0) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+};
+
+// Per-draw data of the multi-draw indirect path
+layout (std430, binding = 1) readonly buffer Transforms {
+    mat4 modelMatrices[];
+};
+
+layout (std430, binding = 2) readonly buffer MaterialIds {
+    uint materialIds[];
+};
+
+layout (std430, binding = 3) readonly buffer Materials {
+    vec4 baseColorFactors[];
+};
+
+// Offset and scale mapping the draw's quantized positions back to local space (see GLVertexLayout)
+layout (std430, binding = 4) readonly buffer Quantizations {
+    vec4 positionQuantizations[];
+};
+
+out VertexData {
+    out vec3 vWorldPos;
+    out vec3 vNormal;
+    out vec2 vTexCoords;
+    flat out vec4 vBaseColorFactor;
+} vertexData;
+
+void main() {
+    mat4 modelMatrix = modelMatrices[aDrawId];
+
+    vertexData.vTexCoords = aTexCoords;
+    vertexData.vBaseColorFactor = baseColorFactors[materialIds[aDrawId]];
+
+    vec3 position = positionQuantizations[aDrawId * 2].xyz + aPosition * positionQuantizations[aDrawId * 2 + 1].xyz;
+    vertexData.vWorldPos = vec3(modelMatrix * vec4(position, 1.0));
+    vertexData.vNormal = mat3(modelMatrix) * aNormal;
+
+    gl_Position = projection * view * vec4(vertexData.vWorldPos, 1.0);
+}
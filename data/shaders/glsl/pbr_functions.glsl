@@ -1,5 +1,8 @@
 vec3 getNormalFromMap(vec3 worldPos, vec3 normal, vec2 uv) {
-    vec3 tangentNormal = texture(normalMap, uv).xyz * 2.0 - 1.0;
+    // Z is rebuilt from XY so that two-channel (BC5) normal maps work as well
+    vec3 tangentNormal;
+    tangentNormal.xy = texture(normalMap, uv).xy * 2.0 - 1.0;
+    tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
 
     vec3 Q1  = dFdx(worldPos);
     vec3 Q2  = dFdy(worldPos);
@@ -6,6 +6,9 @@ out vec4 FragColor;
 
 uniform samplerCube environmentMap;
 uniform float roughness;
+// Resolution of the source cubemap (per face) and number of GGX samples per texel
+uniform float resolution;
+uniform int sampleCount;
 
 const float PI = 3.14159265359;
 // ----------------------------------------------------------------------------
@@ -70,7 +73,7 @@ void main() {
     vec3 R = N;
     vec3 V = R;
 
-    const uint SAMPLE_COUNT = 1024u;
+    uint SAMPLE_COUNT = uint(sampleCount);
     vec3 prefilteredColor = vec3(0.0);
     float totalWeight = 0.0;
     
@@ -90,7 +93,6 @@ void main() {
             float HdotV = max(dot(H, V), 0.0);
             float pdf = D * NdotH / (4.0 * HdotV) + 0.0001; 
 
-            float resolution = 512.0; // resolution of source cubemap (per face)
             float saTexel  = 4.0 * PI / (6.0 * resolution * resolution);
             float saSample = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.0001);
 
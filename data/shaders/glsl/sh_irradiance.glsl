@@ -0,0 +1,21 @@
+// L2 spherical harmonics irradiance, filled by Skybox when it runs with Skybox::irradiance_sh.
+// The coefficients already include the cosine convolution and 1 / PI (see SHIrradiance::project),
+// so the result matches a texture(irradianceMap, N) lookup. A lighting shader includes this file
+// in place of that lookup; mesh.frag is unlit and reads neither yet.
+layout (std140, binding = 4) uniform IrradianceSH {
+    vec4 shCoefficients[9];
+};
+
+vec3 irradianceSH(vec3 n) {
+    return max(
+        shCoefficients[0].rgb +
+        shCoefficients[1].rgb * n.y +
+        shCoefficients[2].rgb * n.z +
+        shCoefficients[3].rgb * n.x +
+        shCoefficients[4].rgb * (n.x * n.y) +
+        shCoefficients[5].rgb * (n.y * n.z) +
+        shCoefficients[6].rgb * (3.0 * n.y * n.y - 1.0) +
+        shCoefficients[7].rgb * (n.x * n.z) +
+        shCoefficients[8].rgb * (n.x * n.x - n.z * n.z),
+        vec3(0.0));
+}
@@ -0,0 +1,322 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "../utility/ThreadPool.h"
+
+namespace {
+    constexpr uint32_t BIN_COUNT = 16;
+    constexpr uint32_t MAX_LEAF_ITEMS = 4;
+    // Cost of visiting a node relative to testing one item box
+    constexpr float TRAVERSAL_COST = 1.0f;
+    // Subtrees with fewer items are built on the thread that split their parent
+    constexpr uint32_t PARALLEL_ITEMS = 4096;
+
+    float surfaceArea(const BVH::Box& box) {
+        const glm::vec3 size = glm::max(box.max - box.min, glm::vec3(0.0f));
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    BVH::Box emptyBox() {
+        return { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()) };
+    }
+
+    void grow(BVH::Box& box, const BVH::Box& other) {
+        box.min = glm::min(box.min, other.min);
+        box.max = glm::max(box.max, other.max);
+    }
+
+    // Entry distance of the ray into the box, or infinity if it misses within max_distance
+    float intersectBox(const BVH::Box& box, const glm::vec3& origin, const glm::vec3& inverse_direction, const float max_distance) {
+        const glm::vec3 t0 = (box.min - origin) * inverse_direction;
+        const glm::vec3 t1 = (box.max - origin) * inverse_direction;
+        const glm::vec3 near = glm::min(t0, t1);
+        const glm::vec3 far = glm::max(t0, t1);
+        const float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+        const float exit = std::min(std::min(far.x, far.y), std::min(far.z, max_distance));
+        return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+    }
+}
+
+BVH::Box BVH::Box::transformed(const glm::mat4& matrix) const {
+    // Arvo: the extents are projected through the absolute rotation and scale
+    const glm::vec3 center = glm::vec3(matrix * glm::vec4((min + max) * 0.5f, 1.0f));
+    const glm::vec3 half = (max - min) * 0.5f;
+    const glm::vec3 extent =
+        glm::abs(glm::vec3(matrix[0])) * half.x +
+        glm::abs(glm::vec3(matrix[1])) * half.y +
+        glm::abs(glm::vec3(matrix[2])) * half.z;
+    return { center - extent, center + extent };
+}
+
+void BVH::resize(const size_t count) {
+    m_boxes.assign(count, Box());
+    m_items.clear();
+    m_nodes.clear();
+    m_refitPending = false;
+}
+
+void BVH::setBox(const uint32_t item, const Box& box) {
+    m_boxes[item] = box;
+    m_refitPending = true;
+}
+
+void BVH::build() {
+    const auto count = static_cast<uint32_t>(m_boxes.size());
+    m_items.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        m_items[i] = i;
+    }
+    m_nodes.clear();
+    m_refitPending = false;
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        centroids[i] = (m_boxes[i].min + m_boxes[i].max) * 0.5f;
+    }
+
+    // A binary tree with one item per leaf at most has 2n - 1 nodes, children are claimed in pairs
+    m_nodes.resize(2 * count - 1);
+    m_nodes[0].firstItem = 0;
+    m_nodes[0].itemCount = count;
+    m_nodeCount = 1;
+    buildNode(0, centroids);
+    m_nodes.resize(m_nodeCount);
+}
+
+void BVH::buildNode(const uint32_t index, const std::vector<glm::vec3>& centroids) {
+    Node& node = m_nodes[index];
+    node.left = 0;
+    node.bounds = emptyBox();
+    Box centroid_bounds = emptyBox();
+    const uint32_t first = node.firstItem;
+    const uint32_t count = node.itemCount;
+    for (uint32_t i = first; i < first + count; ++i) {
+        grow(node.bounds, m_boxes[m_items[i]]);
+        grow(centroid_bounds, { centroids[m_items[i]], centroids[m_items[i]] });
+    }
+    if (count <= 1) {
+        return;
+    }
+
+    // Binned SAH: bin the centroids along each axis and sweep the bin boundaries for the cheapest split
+    const glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+    float best_cost = std::numeric_limits<float>::max();
+    int best_axis = -1;
+    uint32_t best_split = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (extent[axis] <= 0.0f) {
+            continue;
+        }
+
+        Box bin_bounds[BIN_COUNT];
+        uint32_t bin_counts[BIN_COUNT] = {};
+        for (auto& bounds : bin_bounds) {
+            bounds = emptyBox();
+        }
+        const float scale = BIN_COUNT / extent[axis];
+        for (uint32_t i = first; i < first + count; ++i) {
+            const uint32_t item = m_items[i];
+            const auto bin = std::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[item][axis] - centroid_bounds.min[axis]) * scale));
+            grow(bin_bounds[bin], m_boxes[item]);
+            ++bin_counts[bin];
+        }
+
+        // Areas and counts of everything right of each boundary, then sweep from the left
+        float right_areas[BIN_COUNT];
+        uint32_t right_counts[BIN_COUNT];
+        Box right = emptyBox();
+        uint32_t right_count = 0;
+        for (uint32_t bin = BIN_COUNT - 1; bin > 0; --bin) {
+            grow(right, bin_bounds[bin]);
+            right_count += bin_counts[bin];
+            right_areas[bin] = surfaceArea(right);
+            right_counts[bin] = right_count;
+        }
+        Box left = emptyBox();
+        uint32_t left_count = 0;
+        for (uint32_t split = 1; split < BIN_COUNT; ++split) {
+            grow(left, bin_bounds[split - 1]);
+            left_count += bin_counts[split - 1];
+            if (left_count == 0 || right_counts[split] == 0) {
+                continue;
+            }
+            const float cost = surfaceArea(left) * left_count + right_areas[split] * right_counts[split];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = split;
+            }
+        }
+    }
+
+    const float node_area = surfaceArea(node.bounds);
+    const float leaf_cost = node_area * count;
+    if (count <= MAX_LEAF_ITEMS && (best_axis < 0 || node_area * TRAVERSAL_COST + best_cost >= leaf_cost)) {
+        return;
+    }
+
+    uint32_t middle = first + count / 2;
+    if (best_axis >= 0) {
+        const float scale = BIN_COUNT / extent[best_axis];
+        const auto split = std::partition(m_items.begin() + first, m_items.begin() + first + count, [&](const uint32_t item) {
+            const auto bin = std::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[item][best_axis] - centroid_bounds.min[best_axis]) * scale));
+            return bin < best_split;
+        });
+        middle = static_cast<uint32_t>(split - m_items.begin());
+    }
+    // All centroids coincide: any split of the range is as good as another
+
+    const uint32_t left = m_nodeCount.fetch_add(2);
+    node.left = left;
+    m_nodes[left].firstItem = first;
+    m_nodes[left].itemCount = middle - first;
+    m_nodes[left + 1].firstItem = middle;
+    m_nodes[left + 1].itemCount = first + count - middle;
+
+    if (count >= PARALLEL_ITEMS) {
+        ThreadPool::getInstance().parallelFor(0, 2, [&](const size_t child) {
+            buildNode(left + static_cast<uint32_t>(child), centroids);
+        });
+    }
+    else {
+        buildNode(left, centroids);
+        buildNode(left + 1, centroids);
+    }
+}
+
+void BVH::refit() {
+    if (!m_refitPending || m_nodes.empty()) {
+        return;
+    }
+    m_refitPending = false;
+
+    // Children are always claimed after their parent, so a reverse sweep visits them first
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+        Node& node = m_nodes[i];
+        if (node.left) {
+            node.bounds = m_nodes[node.left].bounds;
+            grow(node.bounds, m_nodes[node.left + 1].bounds);
+            continue;
+        }
+        node.bounds = emptyBox();
+        for (uint32_t item = node.firstItem; item < node.firstItem + node.itemCount; ++item) {
+            grow(node.bounds, m_boxes[m_items[item]]);
+        }
+    }
+}
+
+size_t BVH::cull(const FrustumCuller::Frustum& frustum, std::vector<uint8_t>& visible) const {
+    visible.assign(m_boxes.size(), 0);
+    if (m_nodes.empty()) {
+        return 0;
+    }
+    cullNode(0, frustum, 0x3F, visible);
+    return static_cast<size_t>(std::count(visible.begin(), visible.end(), 1));
+}
+
+void BVH::cullNode(const uint32_t index, const FrustumCuller::Frustum& frustum, uint32_t planeMask, std::vector<uint8_t>& visible) const {
+    const Node& node = m_nodes[index];
+
+    // Planes the node lies fully inside are dropped from the mask and not tested again below it
+    const glm::vec3 center = (node.bounds.min + node.bounds.max) * 0.5f;
+    const glm::vec3 extent = (node.bounds.max - node.bounds.min) * 0.5f;
+    for (uint32_t plane = 0; plane < 6; ++plane) {
+        if (!(planeMask & (1u << plane))) {
+            continue;
+        }
+        const auto& p = frustum.planes[plane];
+        const float distance = glm::dot(glm::vec3(p), center) + p.w;
+        const float radius = glm::dot(glm::abs(glm::vec3(p)), extent);
+        if (distance + radius < 0.0f) {
+            return;
+        }
+        if (distance - radius >= 0.0f) {
+            planeMask &= ~(1u << plane);
+        }
+    }
+
+    if (planeMask == 0 || node.left == 0) {
+        for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; ++i) {
+            const uint32_t item = m_items[i];
+            bool inside = true;
+            // Items of a leaf still straddling planes get the same box test as FrustumCuller
+            for (uint32_t plane = 0; plane < 6 && inside; ++plane) {
+                if (!(planeMask & (1u << plane))) {
+                    continue;
+                }
+                const auto& p = frustum.planes[plane];
+                const glm::vec3 item_center = (m_boxes[item].min + m_boxes[item].max) * 0.5f;
+                const glm::vec3 item_extent = (m_boxes[item].max - m_boxes[item].min) * 0.5f;
+                if (glm::dot(glm::vec3(p), item_center) + p.w + glm::dot(glm::abs(glm::vec3(p)), item_extent) < 0.0f) {
+                    inside = false;
+                }
+            }
+            visible[item] = inside ? 1 : 0;
+        }
+        return;
+    }
+
+    cullNode(node.left, frustum, planeMask, visible);
+    cullNode(node.left + 1, frustum, planeMask, visible);
+}
+
+bool BVH::intersect(const glm::vec3& origin, const glm::vec3& direction, uint32_t& item, float& distance) const {
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    const glm::vec3 inverse_direction = 1.0f / direction;
+    float closest = std::numeric_limits<float>::infinity();
+    bool hit = false;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const Node& node = m_nodes[stack.back()];
+        stack.pop_back();
+        // Nodes pushed before a closer hit was found may be out of reach by now
+        if (!std::isfinite(intersectBox(node.bounds, origin, inverse_direction, closest))) {
+            continue;
+        }
+
+        if (node.left == 0) {
+            for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; ++i) {
+                const float t = intersectBox(m_boxes[m_items[i]], origin, inverse_direction, closest);
+                if (t < closest) {
+                    closest = t;
+                    item = m_items[i];
+                    hit = true;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so the closest hit shrinks the ray early
+        float near_t = intersectBox(m_nodes[node.left].bounds, origin, inverse_direction, closest);
+        float far_t = intersectBox(m_nodes[node.left + 1].bounds, origin, inverse_direction, closest);
+        uint32_t near_child = node.left;
+        uint32_t far_child = node.left + 1;
+        if (far_t < near_t) {
+            std::swap(near_t, far_t);
+            std::swap(near_child, far_child);
+        }
+        if (std::isfinite(far_t)) {
+            stack.push_back(far_child);
+        }
+        if (std::isfinite(near_t)) {
+            stack.push_back(near_child);
+        }
+    }
+
+    if (hit) {
+        distance = closest;
+    }
+    return hit;
+}
@@ -0,0 +1,62 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+
+// Bounding volume hierarchy over a set of boxes (one per item, e.g. a model primitive).
+// build() splits with a binned surface area heuristic and builds large subtrees on the thread pool.
+// Moving items only needs setBox() and refit(), which recomputes the node bounds without changing
+// the tree; rebuild once the boxes have drifted far from the positions the tree was built for.
+class BVH {
+    public:
+        struct Box {
+            glm::vec3 min { 0.0f };
+            glm::vec3 max { 0.0f };
+
+            // World box enclosing this box transformed by matrix
+            Box transformed(const glm::mat4& matrix) const;
+        };
+
+        struct Node {
+            Box bounds;
+            uint32_t firstItem;     // Items of the whole subtree are contiguous in the item order
+            uint32_t itemCount;
+            uint32_t left;          // First of the two adjacent children, 0 for leaves
+        };
+
+        // Drops the tree and sizes the box array for count items
+        void resize(const size_t count);
+        void setBox(const uint32_t item, const Box& box);
+        const Box& getBox(const uint32_t item) const { return m_boxes[item]; }
+
+        void build();
+        // Recomputes the node bounds after setBox(), does nothing if no box changed
+        void refit();
+
+        // Same result as FrustumCuller::cull, but skips subtrees entirely outside or inside the frustum
+        size_t cull(const FrustumCuller::Frustum& frustum, std::vector<uint8_t>& visible) const;
+        // Nearest item whose box the ray enters, returns false if it misses everything
+        bool intersect(const glm::vec3& origin, const glm::vec3& direction, uint32_t& item, float& distance) const;
+
+        bool empty() const { return m_nodes.empty(); }
+        size_t getNodeCount() const { return m_nodes.size(); }
+        const std::vector<Node>& getNodes() const { return m_nodes; }
+
+    private:
+        void buildNode(const uint32_t index, const std::vector<glm::vec3>& centroids);
+        void cullNode(const uint32_t index, const FrustumCuller::Frustum& frustum, uint32_t planeMask, std::vector<uint8_t>& visible) const;
+
+        std::vector<Box> m_boxes;
+        std::vector<uint32_t> m_items;
+        std::vector<Node> m_nodes;
+        std::atomic<uint32_t> m_nodeCount { 0 };
+        bool m_refitPending { false };
+};
+
+#endif
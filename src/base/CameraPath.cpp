@@ -0,0 +1,88 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    // Keyframes of the generated paths
+    constexpr int ORBIT_KEYFRAMES = 8;
+
+    glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const float t) {
+        const float t2 = t * t;
+        const float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+}
+
+CameraPath CameraPath::orbit(const float distance, const float pitch) {
+    CameraPath path;
+    for (int i = 0; i <= ORBIT_KEYFRAMES; ++i) {
+        const float yaw = 360.0f * static_cast<float>(i) / ORBIT_KEYFRAMES;
+        path.m_keyframes.push_back({ glm::vec3(0.0f, 0.0f, -distance), glm::vec3(pitch, yaw, 0.0f) });
+    }
+    return path;
+}
+
+CameraPath CameraPath::dolly(const float from, const float to) {
+    CameraPath path;
+    path.m_keyframes.push_back({ glm::vec3(0.0f, 0.0f, -from), glm::vec3(0.0f) });
+    path.m_keyframes.push_back({ glm::vec3(0.0f, 0.0f, -to), glm::vec3(0.0f) });
+    return path;
+}
+
+bool CameraPath::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Camera Path: Could not open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Keyframe> keyframes;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        Keyframe keyframe;
+        if (!(stream >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+                     >> keyframe.rotation.x >> keyframe.rotation.y >> keyframe.rotation.z)) {
+            std::cerr << "Camera Path: " << path << ":" << line_number << ": expected six numbers" << std::endl;
+            return false;
+        }
+        keyframes.push_back(keyframe);
+    }
+
+    if (keyframes.empty()) {
+        std::cerr << "Camera Path: " << path << " has no keyframes" << std::endl;
+        return false;
+    }
+    m_keyframes.swap(keyframes);
+    return true;
+}
+
+void CameraPath::apply(RenderCamera& camera, const float t) const {
+    if (m_keyframes.empty()) {
+        return;
+    }
+
+    // Segment and position inside it, the end keyframes are repeated as spline tangents
+    const int last = static_cast<int>(m_keyframes.size()) - 1;
+    const float segment_position = std::clamp(t, 0.0f, 1.0f) * last;
+    const int segment = std::min(static_cast<int>(segment_position), std::max(last - 1, 0));
+    const float local = segment_position - segment;
+
+    const auto& k0 = m_keyframes[std::max(segment - 1, 0)];
+    const auto& k1 = m_keyframes[segment];
+    const auto& k2 = m_keyframes[std::min(segment + 1, last)];
+    const auto& k3 = m_keyframes[std::min(segment + 2, last)];
+
+    camera.setPosition(catmullRom(k0.position, k1.position, k2.position, k3.position, local));
+    camera.setRotation(catmullRom(k0.rotation, k1.rotation, k2.rotation, k3.rotation, local));
+}
@@ -0,0 +1,38 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "RenderCamera.hpp"
+
+// Scripted RenderCamera motion for reproducible benchmark runs.
+// A path is a list of keyframes (camera position and rotation, as passed to setPosition/setRotation),
+// evenly spaced over the run and interpolated with Catmull-Rom splines.
+class CameraPath {
+    public:
+        struct Keyframe {
+            glm::vec3 position;
+            glm::vec3 rotation;
+        };
+
+        // Full turn around the origin at the given distance and pitch (degrees)
+        static CameraPath orbit(const float distance, const float pitch);
+        // Straight move towards the origin
+        static CameraPath dolly(const float from, const float to);
+
+        // Text file, one keyframe per line: "px py pz rx ry rz"; '#' starts a comment
+        bool load(const std::string& path);
+
+        // t in [0, 1]
+        void apply(RenderCamera& camera, const float t) const;
+
+        size_t getKeyframeCount() const { return m_keyframes.size(); }
+
+    private:
+        std::vector<Keyframe> m_keyframes;
+};
+
+#endif
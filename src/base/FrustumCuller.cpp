@@ -0,0 +1,134 @@
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE
+#endif
+
+namespace {
+    // Per plane constants, broadcast once per cull() instead of once per group of boxes
+    struct PlaneTerms {
+        float nx, ny, nz, w;
+        float ax, ay, az;   // absolute normal, projects the half extents onto the normal
+    };
+
+    // Writes the visibility of a group of boxes from its lane mask
+    void storeMask(const int mask, const size_t first, const size_t count, std::vector<uint8_t>& visible) {
+        for (size_t lane = 0; lane < count; ++lane) {
+            visible[first + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+}
+
+FrustumCuller::Frustum FrustumCuller::extractFrustum(const glm::mat4& viewProjection) {
+    // Gribb/Hartmann: every plane is the last row plus or minus one of the others
+    const glm::mat4 rows = glm::transpose(viewProjection);
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+    for (auto& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+void FrustumCuller::resize(const size_t count) {
+    m_count = count;
+    const size_t padded = (count + LANES - 1) / LANES * LANES;
+    for (auto* values : { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ }) {
+        values->assign(padded, 0.0f);
+    }
+}
+
+void FrustumCuller::setBox(const size_t index, const glm::vec3& min, const glm::vec3& max) {
+    const glm::vec3 center = (min + max) * 0.5f;
+    const glm::vec3 extent = (max - min) * 0.5f;
+
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_extentX[index] = extent.x;
+    m_extentY[index] = extent.y;
+    m_extentZ[index] = extent.z;
+}
+
+size_t FrustumCuller::cull(const Frustum& frustum, std::vector<uint8_t>& visible) const {
+    visible.resize(m_count);
+
+    PlaneTerms planes[6];
+    for (int i = 0; i < 6; ++i) {
+        const auto& plane = frustum.planes[i];
+        planes[i] = { plane.x, plane.y, plane.z, plane.w, std::abs(plane.x), std::abs(plane.y), std::abs(plane.z) };
+    }
+
+    // A box is outside once its center is further behind any plane than its extents reach
+    size_t first = 0;
+#if defined(FRUSTUM_CULLER_AVX)
+    for (; first < m_count; first += 8) {
+        const __m256 cx = _mm256_loadu_ps(&m_centerX[first]);
+        const __m256 cy = _mm256_loadu_ps(&m_centerY[first]);
+        const __m256 cz = _mm256_loadu_ps(&m_centerZ[first]);
+        const __m256 ex = _mm256_loadu_ps(&m_extentX[first]);
+        const __m256 ey = _mm256_loadu_ps(&m_extentY[first]);
+        const __m256 ez = _mm256_loadu_ps(&m_extentZ[first]);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (const auto& plane : planes) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.nx), cx), _mm256_set1_ps(plane.w));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.ny), cy));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.nz), cz));
+            __m256 radius = _mm256_mul_ps(_mm256_set1_ps(plane.ax), ex);
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(plane.ay), ey));
+            radius = _mm256_add_ps(radius, _mm256_mul_ps(_mm256_set1_ps(plane.az), ez));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        storeMask(~_mm256_movemask_ps(outside), first, std::min<size_t>(8, m_count - first), visible);
+    }
+#elif defined(FRUSTUM_CULLER_SSE)
+    for (; first < m_count; first += 4) {
+        const __m128 cx = _mm_loadu_ps(&m_centerX[first]);
+        const __m128 cy = _mm_loadu_ps(&m_centerY[first]);
+        const __m128 cz = _mm_loadu_ps(&m_centerZ[first]);
+        const __m128 ex = _mm_loadu_ps(&m_extentX[first]);
+        const __m128 ey = _mm_loadu_ps(&m_extentY[first]);
+        const __m128 ez = _mm_loadu_ps(&m_extentZ[first]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (const auto& plane : planes) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.nx), cx), _mm_set1_ps(plane.w));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.ny), cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.nz), cz));
+            __m128 radius = _mm_mul_ps(_mm_set1_ps(plane.ax), ex);
+            radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(plane.ay), ey));
+            radius = _mm_add_ps(radius, _mm_mul_ps(_mm_set1_ps(plane.az), ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+        storeMask(~_mm_movemask_ps(outside), first, std::min<size_t>(4, m_count - first), visible);
+    }
+#endif
+
+    // Whole array without SIMD
+    for (; first < m_count; ++first) {
+        bool inside = true;
+        for (const auto& plane : planes) {
+            const float distance = plane.nx * m_centerX[first] + plane.ny * m_centerY[first] + plane.nz * m_centerZ[first] + plane.w;
+            const float radius = plane.ax * m_extentX[first] + plane.ay * m_extentY[first] + plane.az * m_extentZ[first];
+            if (distance + radius < 0.0f) {
+                inside = false;
+            }
+        }
+        visible[first] = inside ? 1 : 0;
+    }
+
+    return static_cast<size_t>(std::count(visible.begin(), visible.end(), 1));
+}
@@ -0,0 +1,39 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// World-space bounding boxes stored as structure-of-arrays (centers and half extents per axis), so the
+// frustum test runs on several boxes per instruction: 8 with AVX, 4 with SSE, one at a time otherwise.
+class FrustumCuller {
+    public:
+        // Plane normals point into the frustum, a point p is inside a plane when dot(n, p) + w >= 0
+        struct Frustum {
+            glm::vec4 planes[6];
+        };
+
+        // Left, right, bottom, top, near and far planes of a GL clip space transform
+        static Frustum extractFrustum(const glm::mat4& viewProjection);
+
+        void resize(const size_t count);
+        size_t size() const { return m_count; }
+
+        void setBox(const size_t index, const glm::vec3& min, const glm::vec3& max);
+
+        // Writes 1 to visible[i] for every box intersecting the frustum and 0 otherwise, returns the visible count
+        size_t cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+
+    private:
+        // Padding lanes hold zero boxes, their results are never read
+        static constexpr size_t LANES = 8;
+
+        size_t m_count { 0 };
+        std::vector<float> m_centerX, m_centerY, m_centerZ;
+        std::vector<float> m_extentX, m_extentY, m_extentZ;
+};
+
+#endif
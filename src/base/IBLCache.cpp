@@ -0,0 +1,155 @@
+#include "IBLCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "../utility/Hash.h"
+#include "../utility/MappedFile.h"
+#include "../utility/ResourceManager.h"
+
+namespace {
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t textureCount;
+        uint32_t reserved;
+    };
+
+    struct TextureRecord {
+        uint32_t type;
+        uint32_t size;
+        uint32_t channels;
+        uint32_t levels;
+        uint64_t offset;    // from the start of the file
+        uint64_t halfCount;
+    };
+}
+
+size_t IBLCache::Texture::getFaceHalfCount(const uint32_t level) const {
+    const size_t level_size = getLevelSize(level);
+    return level_size * level_size * channels;
+}
+
+size_t IBLCache::Texture::getHalfCount() const {
+    size_t count = 0;
+    for (uint32_t level = 0; level < levels; ++level) {
+        count += getFaceHalfCount(level) * getFaceCount();
+    }
+    return count;
+}
+
+uint64_t IBLCache::makeKey(const uint64_t sourceHash, const uint32_t resolution, const uint32_t sampleCount) {
+    uint64_t key = Hash::combine(sourceHash, VERSION);
+    key = Hash::combine(key, resolution);
+    return Hash::combine(key, sampleCount);
+}
+
+std::string IBLCache::getBRDFLUTPath() {
+    return ResourceManager::getInstance().getAssetsPath() + "textures/brdf_lut.ibl";
+}
+
+std::string IBLCache::getCachePath(const uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return ResourceManager::getInstance().getAssetsPath() + "cache/ibl/" + name + ".ibl";
+}
+
+bool IBLCache::hashFile(const std::string& path, uint64_t& hash) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    hash = Hash::hash64(file.data(), file.size());
+    return true;
+}
+
+bool IBLCache::write(const std::string& cachePath, const uint64_t key, const std::vector<Texture>& textures) {
+    Header header{ MAGIC, VERSION, key, static_cast<uint32_t>(textures.size()), 0 };
+
+    std::vector<TextureRecord> records(textures.size());
+    uint64_t offset = sizeof(Header) + records.size() * sizeof(TextureRecord);
+    for (size_t i = 0; i < textures.size(); ++i) {
+        const auto& texture = textures[i];
+        if (texture.data.size() != texture.getHalfCount()) {
+            std::cerr << "IBL Cache: Texture " << i << " has " << texture.data.size() << " halves, expected "
+                      << texture.getHalfCount() << std::endl;
+            return false;
+        }
+        records[i] = { texture.type, texture.size, texture.channels, texture.levels, offset, texture.data.size() };
+        offset += texture.data.size() * sizeof(uint16_t);
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    // Write to a temporary file first so an interrupted bake never leaves a truncated cache behind
+    const auto temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "IBL Cache: Could not create cache file: " << temporaryPath << std::endl;
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(TextureRecord)));
+        for (const auto& texture : textures) {
+            out.write(reinterpret_cast<const char*>(texture.data.data()), static_cast<std::streamsize>(texture.data.size() * sizeof(uint16_t)));
+        }
+
+        if (!out) {
+            std::cerr << "IBL Cache: Failed writing cache file: " << temporaryPath << std::endl;
+            return false;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "IBL Cache: Could not move cache file into place: " << cachePath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool IBLCache::load(const std::string& cachePath, const uint64_t key, std::vector<Texture>& textures) {
+    MappedFile file;
+    if (!file.open(cachePath) || file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION || header.key != key ||
+        sizeof(Header) + static_cast<uint64_t>(header.textureCount) * sizeof(TextureRecord) > file.size()) {
+        return false;
+    }
+
+    std::vector<TextureRecord> records(header.textureCount);
+    std::memcpy(records.data(), file.data() + sizeof(Header), records.size() * sizeof(TextureRecord));
+
+    textures.resize(records.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        const auto& record = records[i];
+        auto& texture = textures[i];
+        texture.type = static_cast<texture_type>(record.type);
+        texture.size = record.size;
+        texture.channels = record.channels;
+        texture.levels = record.levels;
+
+        if (record.type > texture_cube || record.halfCount != texture.getHalfCount() ||
+            record.offset + record.halfCount * sizeof(uint16_t) > file.size()) {
+            std::cerr << "IBL Cache: Corrupt cache file: " << cachePath << std::endl;
+            textures.clear();
+            return false;
+        }
+
+        texture.data.resize(record.halfCount);
+        std::memcpy(texture.data.data(), file.data() + record.offset, record.halfCount * sizeof(uint16_t));
+    }
+    return true;
+}
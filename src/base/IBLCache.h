@@ -0,0 +1,51 @@
+#ifndef IBL_CACHE_H
+#define IBL_CACHE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Half-float container for the precomputed image based lighting textures.
+//
+// Layout: a fixed header, one record per texture, then the texel data of every texture as
+// IEEE half floats (level by level, the six faces of a cubemap level in GL order).
+// Environment caches are keyed by the HDR source hash, the bake resolution and the sample count.
+// The BRDF LUT does not depend on the environment and ships prebuilt as textures/brdf_lut.ibl.
+class IBLCache {
+    public:
+        static constexpr uint32_t MAGIC = 0x4C424947;   // "GIBL"
+        static constexpr uint32_t VERSION = 1;
+
+        static constexpr uint32_t BRDF_LUT_SIZE = 256;
+        static constexpr uint32_t BRDF_LUT_SAMPLES = 1024;
+
+        enum texture_type : uint32_t { texture_2d, texture_cube };
+
+        struct Texture {
+            texture_type type { texture_2d };
+            uint32_t size { 0 };        // width and height of level 0
+            uint32_t channels { 0 };    // 2 (RG) or 3 (RGB)
+            uint32_t levels { 1 };
+            std::vector<uint16_t> data;
+
+            uint32_t getFaceCount() const { return type == texture_cube ? 6 : 1; }
+            uint32_t getLevelSize(const uint32_t level) const { return size > level ? std::max(size >> level, 1u) : 1u; }
+            // Number of halves of one face of a level
+            size_t getFaceHalfCount(const uint32_t level) const;
+            size_t getHalfCount() const;
+        };
+
+        static uint64_t makeKey(const uint64_t sourceHash, const uint32_t resolution, const uint32_t sampleCount);
+        static uint64_t getBRDFLUTKey() { return makeKey(0, BRDF_LUT_SIZE, BRDF_LUT_SAMPLES); }
+        static std::string getBRDFLUTPath();
+        static std::string getCachePath(const uint64_t key);
+
+        static bool hashFile(const std::string& path, uint64_t& hash);
+
+        static bool write(const std::string& cachePath, const uint64_t key, const std::vector<Texture>& textures);
+        // Fails if the file is missing, corrupt, or was written for another key or version
+        static bool load(const std::string& cachePath, const uint64_t key, std::vector<Texture>& textures);
+};
+
+#endif
@@ -0,0 +1,427 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "../utility/Hash.h"
+
+namespace {
+    enum section : uint32_t {
+        DEPENDENCIES,
+        NODES,
+        PRIMITIVES,
+        LODS,
+        MESHLETS,
+        MATERIALS,
+        TEXTURES,
+        IMAGES,
+        VERTICES,
+        INDICES,
+        PIXELS,
+        SECTION_COUNT
+    };
+
+    struct Section {
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct MeshStatsRecord {
+        uint64_t triangles;
+        uint64_t verticesBefore;
+        uint64_t verticesAfter;
+        uint64_t missesBefore;
+        uint64_t missesAfter;
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t vertexSize;
+        uint32_t dependencyCount;
+        uint32_t nodeCount;
+        uint32_t primitiveCount;
+        uint32_t materialCount;
+        uint32_t textureCount;
+        uint32_t imageCount;
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        uint32_t reserved;
+        uint64_t vertexCount;
+        uint64_t indexCount;
+        MeshStatsRecord meshStats;
+        Section sections[SECTION_COUNT];
+    };
+
+    struct NodeRecord {
+        int32_t parent;
+        uint32_t firstPrimitive;
+        uint32_t primitiveCount;
+        float translation[3];
+        float rotation[4];      // x, y, z, w
+        float scale[3];
+    };
+
+    struct MaterialRecord {
+        float baseColorFactor[4];
+        int32_t baseColorTextureIndex;
+        uint32_t alphaMode;
+        uint32_t doubleSided;
+        uint32_t reserved;
+    };
+
+    struct ImageRecord {
+        int32_t width;
+        int32_t height;
+        int32_t component;
+        uint32_t compressed;
+        uint64_t pixelOffset;   // Relative to the pixel section
+        uint64_t size;
+    };
+
+    constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+    uint64_t alignOffset(const uint64_t offset) {
+        return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+    }
+
+    std::string directoryOf(const std::string& path) {
+        const auto separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+    }
+
+    template<typename T>
+    const T* sectionData(const MappedFile& file, const Section& section, const uint64_t count) {
+        if (section.offset + section.size > file.size() || section.size != count * sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(file.data() + section.offset);
+    }
+
+    bool rangeInside(const uint64_t first, const uint64_t count, const uint64_t size) {
+        return first <= size && count <= size - first;
+    }
+
+    // Whether every range the loaded scene is indexed with lies inside its section, and every index
+    // addresses a vertex of its primitive like the importer guarantees
+    bool rangesValid(const Header& header, const NodeRecord* nodes, const glTFSceneData::PrimitiveData* primitives,
+                     const glTFSceneData::LodData* lods, const glTFSceneData::MeshletData* meshlets, const ImageRecord* images,
+                     const GLuint* indices, const uint64_t pixelSize) {
+        for (uint32_t i = 0; i < header.nodeCount; ++i) {
+            if (!rangeInside(nodes[i].firstPrimitive, nodes[i].primitiveCount, header.primitiveCount)) {
+                return false;
+            }
+        }
+        for (uint32_t p = 0; p < header.primitiveCount; ++p) {
+            const auto& primitive = primitives[p];
+            if (primitive.mode > GL_TRIANGLE_FAN ||
+                !rangeInside(primitive.firstVertex, primitive.vertexCount, header.vertexCount) ||
+                !rangeInside(primitive.firstIndex, primitive.indexCount, header.indexCount) ||
+                !rangeInside(primitive.firstLod, primitive.lodCount, header.lodCount) ||
+                !rangeInside(primitive.firstMeshlet, primitive.meshletCount, header.meshletCount)) {
+                return false;
+            }
+            // The levels follow the primitive's own indices in order, they are uploaded as one range
+            uint64_t end = static_cast<uint64_t>(primitive.firstIndex) + primitive.indexCount;
+            for (uint32_t l = primitive.firstLod; l < primitive.firstLod + primitive.lodCount; ++l) {
+                if (lods[l].firstIndex < end || !rangeInside(lods[l].firstIndex, lods[l].indexCount, header.indexCount)) {
+                    return false;
+                }
+                end = static_cast<uint64_t>(lods[l].firstIndex) + lods[l].indexCount;
+            }
+            for (uint64_t i = primitive.firstIndex; i < end; ++i) {
+                if (indices[i] >= primitive.vertexCount) {
+                    return false;
+                }
+            }
+            // Meshlets cover the full level only
+            for (uint32_t m = primitive.firstMeshlet; m < primitive.firstMeshlet + primitive.meshletCount; ++m) {
+                if (meshlets[m].firstIndex < primitive.firstIndex ||
+                    !rangeInside(meshlets[m].firstIndex - primitive.firstIndex, meshlets[m].indexCount, primitive.indexCount)) {
+                    return false;
+                }
+            }
+        }
+        for (uint32_t i = 0; i < header.imageCount; ++i) {
+            const auto& image = images[i];
+            if (!rangeInside(image.pixelOffset, image.size, pixelSize)) {
+                return false;
+            }
+            // Texels are read by their dimensions, containers are parsed against their size
+            const bool dimensions_valid = image.width > 0 && image.height > 0 && image.component > 0;
+            if (!image.compressed && dimensions_valid &&
+                static_cast<uint64_t>(image.width) * static_cast<uint64_t>(image.height) * static_cast<uint64_t>(image.component) > image.size) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool MeshCache::hashSource(const std::string& sourcePath, const std::vector<std::string>& dependencies, uint64_t& hash) {
+    MappedFile source;
+    if (!source.open(sourcePath)) {
+        return false;
+    }
+    hash = Hash::hash64(source.data(), source.size());
+
+    const auto directory = directoryOf(sourcePath);
+    for (const auto& dependency : dependencies) {
+        MappedFile file;
+        if (!file.open(directory + dependency)) {
+            return false;
+        }
+        hash = Hash::combine(hash, Hash::hash64(dependency));
+        hash = Hash::combine(hash, Hash::hash64(file.data(), file.size()));
+    }
+    return true;
+}
+
+bool MeshCache::write(const std::string& cachePath, const glTFSceneData& scene, const uint64_t sourceHash) {
+    Header header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.sourceHash = sourceHash;
+    header.vertexSize = sizeof(Vertex);
+    header.dependencyCount = static_cast<uint32_t>(scene.dependencies.size());
+    header.nodeCount = static_cast<uint32_t>(scene.nodes.size());
+    header.primitiveCount = static_cast<uint32_t>(scene.primitives.size());
+    header.materialCount = static_cast<uint32_t>(scene.materials.size());
+    header.textureCount = static_cast<uint32_t>(scene.textures.size());
+    header.imageCount = static_cast<uint32_t>(scene.images.size());
+    header.lodCount = static_cast<uint32_t>(scene.lods.size());
+    header.meshletCount = static_cast<uint32_t>(scene.meshlets.size());
+    header.vertexCount = scene.vertexCount;
+    header.indexCount = scene.indexCount;
+    header.meshStats = { scene.meshStats.triangles, scene.meshStats.verticesBefore, scene.meshStats.verticesAfter,
+                         scene.meshStats.missesBefore, scene.meshStats.missesAfter };
+
+    // Dependency paths are stored as length-prefixed strings
+    std::vector<char> dependencies;
+    for (const auto& dependency : scene.dependencies) {
+        const auto length = static_cast<uint32_t>(dependency.size());
+        dependencies.insert(dependencies.end(), reinterpret_cast<const char*>(&length), reinterpret_cast<const char*>(&length) + sizeof(length));
+        dependencies.insert(dependencies.end(), dependency.begin(), dependency.end());
+    }
+
+    std::vector<NodeRecord> nodes(scene.nodes.size());
+    for (size_t i = 0; i < scene.nodes.size(); ++i) {
+        const auto& node = scene.nodes[i];
+        nodes[i].parent = node.parent;
+        nodes[i].firstPrimitive = node.firstPrimitive;
+        nodes[i].primitiveCount = node.primitiveCount;
+        const float rotation[4] = { node.rotation.x, node.rotation.y, node.rotation.z, node.rotation.w };
+        std::memcpy(nodes[i].translation, &node.translation[0], sizeof(nodes[i].translation));
+        std::memcpy(nodes[i].rotation, rotation, sizeof(nodes[i].rotation));
+        std::memcpy(nodes[i].scale, &node.scale[0], sizeof(nodes[i].scale));
+    }
+
+    std::vector<MaterialRecord> materials(scene.materials.size());
+    for (size_t i = 0; i < scene.materials.size(); ++i) {
+        std::memcpy(materials[i].baseColorFactor, &scene.materials[i].baseColorFactor[0], sizeof(materials[i].baseColorFactor));
+        materials[i].baseColorTextureIndex = scene.materials[i].baseColorTextureIndex;
+        materials[i].alphaMode = scene.materials[i].alphaMode;
+        materials[i].doubleSided = scene.materials[i].doubleSided;
+    }
+
+    std::vector<ImageRecord> images(scene.images.size());
+    uint64_t pixelSize = 0;
+    for (size_t i = 0; i < scene.images.size(); ++i) {
+        images[i].width = scene.images[i].width;
+        images[i].height = scene.images[i].height;
+        images[i].component = scene.images[i].component;
+        images[i].compressed = scene.images[i].compressed;
+        images[i].pixelOffset = pixelSize;
+        images[i].size = scene.images[i].size;
+        pixelSize = alignOffset(pixelSize + scene.images[i].size);
+    }
+
+    const uint64_t sizes[SECTION_COUNT] = {
+        dependencies.size(),
+        nodes.size() * sizeof(NodeRecord),
+        scene.primitives.size() * sizeof(glTFSceneData::PrimitiveData),
+        scene.lods.size() * sizeof(glTFSceneData::LodData),
+        scene.meshlets.size() * sizeof(glTFSceneData::MeshletData),
+        materials.size() * sizeof(MaterialRecord),
+        scene.textures.size() * sizeof(int32_t),
+        images.size() * sizeof(ImageRecord),
+        scene.vertexCount * sizeof(Vertex),
+        scene.indexCount * sizeof(GLuint),
+        pixelSize
+    };
+
+    uint64_t offset = alignOffset(sizeof(Header));
+    for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+        header.sections[i].offset = offset;
+        header.sections[i].size = sizes[i];
+        offset = alignOffset(offset + sizes[i]);
+    }
+
+    // Write to a temporary file first so an interrupted bake never leaves a truncated cache behind
+    const auto temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Mesh Cache: Could not create cache file: " << temporaryPath << std::endl;
+            return false;
+        }
+
+        const auto writeSection = [&out, &header](const uint32_t index, const void* data) {
+            out.seekp(static_cast<std::streamoff>(header.sections[index].offset));
+            if (header.sections[index].size > 0) {
+                out.write(static_cast<const char*>(data), static_cast<std::streamsize>(header.sections[index].size));
+            }
+        };
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeSection(DEPENDENCIES, dependencies.data());
+        writeSection(NODES, nodes.data());
+        writeSection(PRIMITIVES, scene.primitives.data());
+        writeSection(LODS, scene.lods.data());
+        writeSection(MESHLETS, scene.meshlets.data());
+        writeSection(MATERIALS, materials.data());
+        writeSection(TEXTURES, scene.textures.data());
+        writeSection(IMAGES, images.data());
+        writeSection(VERTICES, scene.vertices);
+        writeSection(INDICES, scene.indices);
+        for (size_t i = 0; i < scene.images.size(); ++i) {
+            out.seekp(static_cast<std::streamoff>(header.sections[PIXELS].offset + images[i].pixelOffset));
+            out.write(reinterpret_cast<const char*>(scene.images[i].pixels), static_cast<std::streamsize>(scene.images[i].size));
+        }
+
+        // Pad the file to its full size so every section lies inside the mapping
+        out.seekp(static_cast<std::streamoff>(offset - 1));
+        out.put('\0');
+
+        if (!out) {
+            std::cerr << "Mesh Cache: Failed writing cache file: " << temporaryPath << std::endl;
+            return false;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Mesh Cache: Could not move cache file into place: " << cachePath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::load(const std::string& cachePath, const std::string& sourcePath, glTFSceneData& scene) {
+    MappedFile file;
+    if (!file.open(cachePath) || file.size() < sizeof(Header)) {
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION || header.vertexSize != sizeof(Vertex)) {
+        return false;
+    }
+
+    // Dependencies
+    const auto& dependencySection = header.sections[DEPENDENCIES];
+    if (dependencySection.offset + dependencySection.size > file.size()) {
+        return false;
+    }
+    std::vector<std::string> dependencies;
+    const auto* cursor = file.data() + dependencySection.offset;
+    const auto* const dependencyEnd = cursor + dependencySection.size;
+    for (uint32_t i = 0; i < header.dependencyCount; ++i) {
+        uint32_t length;
+        if (cursor + sizeof(length) > dependencyEnd) {
+            return false;
+        }
+        std::memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        if (cursor + length > dependencyEnd) {
+            return false;
+        }
+        dependencies.emplace_back(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+    }
+
+    uint64_t sourceHash = 0;
+    if (!hashSource(sourcePath, dependencies, sourceHash) || sourceHash != header.sourceHash) {
+        return false;
+    }
+
+    const auto* nodes = sectionData<NodeRecord>(file, header.sections[NODES], header.nodeCount);
+    const auto* primitives = sectionData<glTFSceneData::PrimitiveData>(file, header.sections[PRIMITIVES], header.primitiveCount);
+    const auto* lods = sectionData<glTFSceneData::LodData>(file, header.sections[LODS], header.lodCount);
+    const auto* meshlets = sectionData<glTFSceneData::MeshletData>(file, header.sections[MESHLETS], header.meshletCount);
+    const auto* materials = sectionData<MaterialRecord>(file, header.sections[MATERIALS], header.materialCount);
+    const auto* textures = sectionData<int32_t>(file, header.sections[TEXTURES], header.textureCount);
+    const auto* images = sectionData<ImageRecord>(file, header.sections[IMAGES], header.imageCount);
+    const auto* vertices = sectionData<Vertex>(file, header.sections[VERTICES], header.vertexCount);
+    const auto* indices = sectionData<GLuint>(file, header.sections[INDICES], header.indexCount);
+    const auto& pixelSection = header.sections[PIXELS];
+    if ((header.nodeCount && !nodes) || (header.primitiveCount && !primitives) || (header.lodCount && !lods) || (header.meshletCount && !meshlets) ||
+        (header.materialCount && !materials) || (header.textureCount && !textures) || (header.imageCount && !images) || (header.vertexCount && !vertices) ||
+        (header.indexCount && !indices) || pixelSection.offset + pixelSection.size > file.size()) {
+        std::cerr << "Mesh Cache: Corrupt cache file: " << cachePath << std::endl;
+        return false;
+    }
+    // A cache whose source is unchanged can still be truncated or damaged on disk. Nothing is taken
+    // from it before its ranges are checked, so a rejected cache leaves the scene empty for the import.
+    if (!rangesValid(header, nodes, primitives, lods, meshlets, images, indices, pixelSection.size)) {
+        std::cerr << "Mesh Cache: Corrupt cache file: " << cachePath << std::endl;
+        return false;
+    }
+
+    scene.dependencies = std::move(dependencies);
+
+    scene.nodes.resize(header.nodeCount);
+    for (uint32_t i = 0; i < header.nodeCount; ++i) {
+        scene.nodes[i].parent = nodes[i].parent;
+        scene.nodes[i].firstPrimitive = nodes[i].firstPrimitive;
+        scene.nodes[i].primitiveCount = nodes[i].primitiveCount;
+        scene.nodes[i].translation = glm::vec3(nodes[i].translation[0], nodes[i].translation[1], nodes[i].translation[2]);
+        scene.nodes[i].rotation = glm::quat(nodes[i].rotation[3], nodes[i].rotation[0], nodes[i].rotation[1], nodes[i].rotation[2]);
+        scene.nodes[i].scale = glm::vec3(nodes[i].scale[0], nodes[i].scale[1], nodes[i].scale[2]);
+    }
+
+    scene.primitives.assign(primitives, primitives + header.primitiveCount);
+    scene.lods.assign(lods, lods + header.lodCount);
+    scene.meshlets.assign(meshlets, meshlets + header.meshletCount);
+
+    scene.materials.resize(header.materialCount);
+    for (uint32_t i = 0; i < header.materialCount; ++i) {
+        std::memcpy(&scene.materials[i].baseColorFactor[0], materials[i].baseColorFactor, sizeof(materials[i].baseColorFactor));
+        scene.materials[i].baseColorTextureIndex = materials[i].baseColorTextureIndex;
+        scene.materials[i].alphaMode = materials[i].alphaMode <= glTFSceneData::alpha_blend
+            ? static_cast<glTFSceneData::alpha_mode>(materials[i].alphaMode) : glTFSceneData::alpha_opaque;
+        scene.materials[i].doubleSided = materials[i].doubleSided != 0;
+    }
+
+    scene.textures.assign(textures, textures + header.textureCount);
+
+    scene.images.resize(header.imageCount);
+    for (uint32_t i = 0; i < header.imageCount; ++i) {
+        scene.images[i].width = images[i].width;
+        scene.images[i].height = images[i].height;
+        scene.images[i].component = images[i].component;
+        scene.images[i].compressed = images[i].compressed != 0;
+        scene.images[i].pixels = file.data() + pixelSection.offset + images[i].pixelOffset;
+        scene.images[i].size = images[i].size;
+    }
+
+    scene.vertices = vertices;
+    scene.vertexCount = header.vertexCount;
+    scene.indices = indices;
+    scene.indexCount = header.indexCount;
+
+    scene.meshStats.triangles = header.meshStats.triangles;
+    scene.meshStats.verticesBefore = header.meshStats.verticesBefore;
+    scene.meshStats.verticesAfter = header.meshStats.verticesAfter;
+    scene.meshStats.missesBefore = header.meshStats.missesBefore;
+    scene.meshStats.missesAfter = header.meshStats.missesAfter;
+
+    // The views above stay valid for as long as the scene keeps the mapping
+    scene.mapping = std::move(file);
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "glTFSceneData.h"
+
+// Versioned binary cache of a baked glTF scene.
+//
+// Layout: a fixed header (counts and the import's mesh optimization statistics) followed by 16-byte
+// aligned sections (dependency paths, nodes, primitives, levels of detail, meshlets, materials, textures, images,
+// interleaved vertices, indices and image pixels). The pixel section is stored exactly as it is
+// uploaded, so a cache hit only maps the file and hands pointers into the mapping to GL. Vertices stay
+// full Vertex structs and indices 32-bit, GLMeshArena packs them into its vertex layout and index type
+// on upload.
+class MeshCache {
+    public:
+        static constexpr uint32_t MAGIC = 0x4D534C47;   // "GLSM"
+        static constexpr uint32_t VERSION = 11;
+
+        static std::string getCachePath(const std::string& sourcePath) {
+            return sourcePath + ".meshcache";
+        }
+
+        // Hash of the source file and of every external file the scene depends on
+        static bool hashSource(const std::string& sourcePath, const std::vector<std::string>& dependencies, uint64_t& hash);
+
+        static bool write(const std::string& cachePath, const glTFSceneData& scene, const uint64_t sourceHash);
+
+        // Maps the cache and fills the scene with views into it. Fails if the cache is missing,
+        // was written by another version, or the source it was baked from has changed since.
+        static bool load(const std::string& cachePath, const std::string& sourcePath, glTFSceneData& scene);
+};
+
+#endif
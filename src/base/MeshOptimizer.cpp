@@ -0,0 +1,356 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../utility/Hash.h"
+
+namespace {
+    constexpr uint32_t NONE = ~0u;
+
+    static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertices are compared bytewise, they must not have padding");
+
+    // FIFO cache emulated with timestamps: a vertex is cached while fewer than CACHE_SIZE misses followed its own
+    struct CacheSimulator {
+        std::vector<uint32_t> timestamps;
+        uint32_t time;
+
+        explicit CacheSimulator(const uint32_t vertexCount)
+        : timestamps(vertexCount, 0), time(MeshOptimizer::CACHE_SIZE + 1) {
+        }
+
+        void flush() { time += MeshOptimizer::CACHE_SIZE + 1; }
+
+        uint32_t access(const GLuint vertex) {
+            if (time - timestamps[vertex] > MeshOptimizer::CACHE_SIZE) {
+                timestamps[vertex] = time++;
+                return 1;
+            }
+            return 0;
+        }
+
+        uint32_t triangle(const GLuint* corners) {
+            return access(corners[0]) + access(corners[1]) + access(corners[2]);
+        }
+    };
+}
+
+void MeshOptimizer::Stats::add(const Stats& other) {
+    triangles += other.triangles;
+    verticesBefore += other.verticesBefore;
+    verticesAfter += other.verticesAfter;
+    missesBefore += other.missesBefore;
+    missesAfter += other.missesAfter;
+}
+
+uint32_t MeshOptimizer::optimize(Vertex* vertices, const uint32_t vertexCount, GLuint* indices, const size_t indexCount,
+                                 const bool triangleList, Stats& stats) {
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (indices[i] >= vertexCount) {
+            return vertexCount;
+        }
+    }
+
+    stats.triangles += triangleList ? indexCount / 3 : 0;
+    stats.verticesBefore += vertexCount;
+    stats.missesBefore += countCacheMisses(indices, indexCount, vertexCount);
+
+    uint32_t count = deduplicateVertices(vertices, vertexCount, indices, indexCount);
+    if (triangleList && indexCount % 3 == 0) {
+        optimizeVertexCache(indices, indexCount, count);
+        optimizeOverdraw(indices, indexCount, vertices, count);
+    }
+    count = optimizeVertexFetch(vertices, count, indices, indexCount);
+
+    stats.verticesAfter += count;
+    stats.missesAfter += countCacheMisses(indices, indexCount, count);
+    return count;
+}
+
+uint64_t MeshOptimizer::countCacheMisses(const GLuint* indices, const size_t indexCount, const uint32_t vertexCount) {
+    CacheSimulator cache(vertexCount);
+    uint64_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        misses += cache.access(indices[i]);
+    }
+    return misses;
+}
+
+uint32_t MeshOptimizer::deduplicateVertices(Vertex* vertices, const uint32_t vertexCount, GLuint* indices, const size_t indexCount) {
+    // Open addressing, at most half full. Slots hold the unique index, unique vertices are compacted in place.
+    size_t table_size = 16;
+    while (table_size < 2 * static_cast<size_t>(vertexCount)) {
+        table_size *= 2;
+    }
+    const size_t mask = table_size - 1;
+    std::vector<uint32_t> table(table_size, NONE);
+    std::vector<uint32_t> remap(vertexCount);
+
+    uint32_t unique = 0;
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        size_t slot = Hash::hash64(&vertices[v], sizeof(Vertex)) & mask;
+        while (table[slot] != NONE && std::memcmp(&vertices[table[slot]], &vertices[v], sizeof(Vertex)) != 0) {
+            slot = (slot + 1) & mask;
+        }
+        if (table[slot] == NONE) {
+            // unique <= v, the vertex overwritten has already been read
+            vertices[unique] = vertices[v];
+            table[slot] = unique++;
+        }
+        remap[v] = table[slot];
+    }
+
+    for (size_t i = 0; i < indexCount; ++i) {
+        indices[i] = remap[indices[i]];
+    }
+    return unique;
+}
+
+// Tipsify, Sander, Nehab and Barczak 2007: fans around one vertex at a time and moves on to a neighbour
+// that is still cached, falling back to recently used vertices once every neighbour is done
+void MeshOptimizer::optimizeVertexCache(GLuint* indices, const size_t indexCount, const uint32_t vertexCount) {
+    const size_t triangle_count = indexCount / 3;
+    if (triangle_count < 2) {
+        return;
+    }
+
+    // Triangles around every vertex, live counts the ones not emitted yet
+    std::vector<uint32_t> live(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i) {
+        ++live[indices[i]];
+    }
+    std::vector<uint32_t> first_triangle(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        first_triangle[v + 1] = first_triangle[v] + live[v];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    {
+        std::vector<uint32_t> cursor(first_triangle.begin(), first_triangle.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i) {
+            adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangle_count, 0);
+    std::vector<uint32_t> dead_ends;
+    dead_ends.reserve(indexCount);
+    std::vector<uint32_t> candidates;
+    std::vector<GLuint> result;
+    result.reserve(indexCount);
+
+    uint32_t time = CACHE_SIZE + 1;
+    uint32_t next_input = 0;
+    uint32_t fanning = indices[0];
+    while (fanning != NONE) {
+        candidates.clear();
+        for (uint32_t a = first_triangle[fanning]; a < first_triangle[fanning + 1]; ++a) {
+            const uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (uint32_t corner = 0; corner < 3; ++corner) {
+                const GLuint v = indices[triangle * 3 + corner];
+                result.push_back(v);
+                dead_ends.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - timestamps[v] > CACHE_SIZE) {
+                    timestamps[v] = time++;
+                }
+            }
+            emitted[triangle] = 1;
+        }
+
+        // The oldest candidate that stays cached while its remaining triangles are emitted, else any one left
+        uint32_t next = NONE;
+        int64_t best_priority = -1;
+        for (const auto v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            const uint32_t age = time - timestamps[v];
+            if (age + 2 * live[v] <= CACHE_SIZE) {
+                priority = age;
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                next = v;
+            }
+        }
+        // Dead end: the most recently used vertex with triangles left, then the next one in input order
+        while (next == NONE && !dead_ends.empty()) {
+            const uint32_t v = dead_ends.back();
+            dead_ends.pop_back();
+            if (live[v] > 0) {
+                next = v;
+            }
+        }
+        for (; next == NONE && next_input < vertexCount; ++next_input) {
+            if (live[next_input] > 0) {
+                next = next_input;
+            }
+        }
+        fanning = next;
+    }
+
+    std::copy(result.begin(), result.end(), indices);
+}
+
+// Sander et al. 2007 as well: the vertex cache order is cut into clusters and the clusters are sorted
+// by how much they face away from the mesh center, which draws occluders before what they hide for
+// most views. Clusters are cut where restarting with a cold cache costs little.
+void MeshOptimizer::optimizeOverdraw(GLuint* indices, const size_t indexCount, const Vertex* vertices, const uint32_t vertexCount) {
+    const size_t triangle_count = indexCount / 3;
+    if (triangle_count < 2) {
+        return;
+    }
+
+    // Hard boundaries: a triangle missing all three vertices starts a new patch of the mesh
+    CacheSimulator cache(vertexCount);
+    std::vector<uint32_t> patches;
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        if (cache.triangle(&indices[t * 3]) == 3 || t == 0) {
+            patches.push_back(t);
+        }
+    }
+
+    // Soft boundaries: a patch is split once the triangles since the last cut, starting from a cold cache,
+    // are within OVERDRAW_THRESHOLD of the whole patch's ACMR
+    std::vector<uint32_t> clusters;
+    for (size_t p = 0; p < patches.size(); ++p) {
+        const uint32_t start = patches[p];
+        const uint32_t end = p + 1 < patches.size() ? patches[p + 1] : static_cast<uint32_t>(triangle_count);
+
+        cache.flush();
+        uint32_t patch_misses = 0;
+        for (uint32_t t = start; t < end; ++t) {
+            patch_misses += cache.triangle(&indices[t * 3]);
+        }
+        const float threshold = OVERDRAW_THRESHOLD * patch_misses / (end - start);
+
+        clusters.push_back(start);
+        cache.flush();
+        uint32_t misses = 0, triangles = 0;
+        for (uint32_t t = start; t < end; ++t) {
+            misses += cache.triangle(&indices[t * 3]);
+            ++triangles;
+            if (static_cast<float>(misses) / triangles <= threshold) {
+                clusters.push_back(t + 1);
+                cache.flush();
+                misses = triangles = 0;
+            }
+        }
+        // The part after the last cut rarely reaches the threshold, it joins the cluster before it.
+        // This also drops a cut at end.
+        if (clusters.back() != start) {
+            clusters.pop_back();
+        }
+    }
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    glm::vec3 mesh_center(0.0f);
+    for (size_t i = 0; i < indexCount; ++i) {
+        mesh_center += vertices[indices[i]].Position;
+    }
+    mesh_center /= static_cast<float>(indexCount);
+
+    struct Cluster {
+        uint32_t start;
+        uint32_t end;
+        float facing;
+    };
+    std::vector<Cluster> sorted(clusters.size());
+    for (size_t i = 0; i < clusters.size(); ++i) {
+        auto& cluster = sorted[i];
+        cluster.start = clusters[i];
+        cluster.end = i + 1 < clusters.size() ? clusters[i + 1] : static_cast<uint32_t>(triangle_count);
+
+        // Area weighted center and normal
+        glm::vec3 center(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t t = cluster.start; t < cluster.end; ++t) {
+            const glm::vec3& a = vertices[indices[t * 3]].Position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& c = vertices[indices[t * 3 + 2]].Position;
+            const glm::vec3 n = glm::cross(b - a, c - a);
+            const float triangle_area = glm::length(n);
+            center += (a + b + c) * (triangle_area / 3.0f);
+            normal += n;
+            area += triangle_area;
+        }
+        const float normal_length = glm::length(normal);
+        cluster.facing = area > 0.0f && normal_length > 0.0f ? glm::dot(center / area - mesh_center, normal / normal_length) : 0.0f;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.facing > b.facing; });
+
+    std::vector<GLuint> result;
+    result.reserve(indexCount);
+    for (const auto& cluster : sorted) {
+        result.insert(result.end(), indices + cluster.start * 3, indices + cluster.end * 3);
+    }
+    std::copy(result.begin(), result.end(), indices);
+}
+
+uint32_t MeshOptimizer::optimizeVertexFetch(Vertex* vertices, const uint32_t vertexCount, GLuint* indices, const size_t indexCount) {
+    std::vector<uint32_t> remap(vertexCount, NONE);
+    uint32_t referenced = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        auto& index = indices[i];
+        if (remap[index] == NONE) {
+            remap[index] = referenced++;
+        }
+        index = remap[index];
+    }
+
+    std::vector<Vertex> reordered(referenced);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        if (remap[v] != NONE) {
+            reordered[remap[v]] = vertices[v];
+        }
+    }
+    std::copy(reordered.begin(), reordered.end(), vertices);
+    return referenced;
+}
+
+std::vector<size_t> MeshOptimizer::splitByVertexCount(const GLuint* indices, const size_t indexCount, const uint32_t vertexCount, const uint32_t maxVertices) {
+    std::vector<size_t> runs;
+    if (indexCount == 0 || maxVertices < 3) {
+        runs.push_back(indexCount);
+        return runs;
+    }
+
+    // Run that last referenced every vertex, so counting a run's vertices needs no clearing
+    std::vector<uint32_t> last_run(vertexCount, NONE);
+    uint32_t run = 0;
+    uint32_t run_vertices = 0;
+    size_t run_start = 0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const GLuint a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a >= vertexCount || b >= vertexCount || c >= vertexCount) {
+            return { indexCount };
+        }
+        const uint32_t added = (last_run[a] != run) + (last_run[b] != run && b != a) + (last_run[c] != run && c != a && c != b);
+        if (run_vertices + added > maxVertices) {
+            runs.push_back(i - run_start);
+            run_start = i;
+            ++run;
+            run_vertices = 0;
+        }
+        for (const GLuint v : { a, b, c }) {
+            if (last_run[v] != run) {
+                last_run[v] = run;
+                ++run_vertices;
+            }
+        }
+    }
+    runs.push_back(indexCount - run_start);
+    return runs;
+}
+
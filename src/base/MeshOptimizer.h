@@ -0,0 +1,69 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "Vertex.h"
+
+// Reorders an indexed triangle list for the GPU at import time, before it is baked into the mesh cache:
+//   1. deduplicateVertices: bitwise identical vertices are merged
+//   2. optimizeVertexCache: triangles in Tipsify order for the post-transform vertex cache
+//   3. optimizeOverdraw: clusters of that order sorted so outward facing ones draw first
+//   4. optimizeVertexFetch: vertices in the order the indices first reference them
+// glTFImporter then cuts primitives too large for 16-bit indices with splitByVertexCount.
+// Indices are relative to the primitive's vertices. Nothing here touches GL, it runs on any thread.
+class MeshOptimizer {
+    public:
+        // FIFO post-transform cache size Tipsify targets and the statistics simulate
+        static constexpr uint32_t CACHE_SIZE = 16;
+        // An overdraw cluster may be this much worse than the vertex cache order of its part of the mesh
+        static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+        // Most vertices a primitive can have and still be drawn with 16-bit indices
+        static constexpr uint32_t MAX_SHORT_INDEX_VERTICES = 65536;
+
+        // Vertex cache behaviour of a mesh before and after optimize(), summed over primitives.
+        // Every miss is a vertex shader invocation: ACMR is misses per triangle (0.5 at best, 3 at worst),
+        // ATVR misses per vertex (1 at best).
+        struct Stats {
+            uint64_t triangles = 0;
+            uint64_t verticesBefore = 0;
+            uint64_t verticesAfter = 0;     // Without duplicates and unreferenced vertices
+            uint64_t missesBefore = 0;
+            uint64_t missesAfter = 0;
+
+            double getACMRBefore() const { return triangles ? static_cast<double>(missesBefore) / triangles : 0.0; }
+            double getACMRAfter() const { return triangles ? static_cast<double>(missesAfter) / triangles : 0.0; }
+            double getATVRBefore() const { return verticesBefore ? static_cast<double>(missesBefore) / verticesBefore : 0.0; }
+            double getATVRAfter() const { return verticesAfter ? static_cast<double>(missesAfter) / verticesAfter : 0.0; }
+
+            void add(const Stats& other);
+        };
+
+        // Runs every stage on one primitive in place and returns its new vertex count, the vertices past it
+        // are unused. Without triangleList (strips, fans, lines, points) only the vertex stages run, which
+        // keep the index order; primitives with out of range indices are left alone.
+        static uint32_t optimize(Vertex* vertices, const uint32_t vertexCount, GLuint* indices, const size_t indexCount,
+                                 const bool triangleList, Stats& stats);
+
+        // Cache misses of drawing the indices through a FIFO cache of CACHE_SIZE entries
+        static uint64_t countCacheMisses(const GLuint* indices, const size_t indexCount, const uint32_t vertexCount);
+
+        // Returns the number of unique vertices, moved to the front and referenced by the remapped indices
+        static uint32_t deduplicateVertices(Vertex* vertices, const uint32_t vertexCount, GLuint* indices, const size_t indexCount);
+        static void optimizeVertexCache(GLuint* indices, const size_t indexCount, const uint32_t vertexCount);
+        // Expects the indices in vertex cache order
+        static void optimizeOverdraw(GLuint* indices, const size_t indexCount, const Vertex* vertices, const uint32_t vertexCount);
+        // Returns the number of referenced vertices, moved to the front
+        static uint32_t optimizeVertexFetch(Vertex* vertices, const uint32_t vertexCount, GLuint* indices, const size_t indexCount);
+
+        // Cuts a triangle list into consecutive runs of triangles referencing at most maxVertices distinct
+        // vertices each, and returns the index count of every run. The triangle order is kept: after
+        // optimizeVertexCache the runs are compact patches of the mesh.
+        static std::vector<size_t> splitByVertexCount(const GLuint* indices, const size_t indexCount, const uint32_t vertexCount, const uint32_t maxVertices);
+};
+
+#endif
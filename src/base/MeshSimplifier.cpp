@@ -0,0 +1,273 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "../utility/Hash.h"
+
+namespace {
+    constexpr uint32_t NONE = ~0u;
+
+    // Symmetric 4x4 matrix of summed plane equations, weighted by triangle area.
+    // The error of a point is its weighted squared distance to the planes.
+    struct Quadric {
+        double a00, a01, a02, a03;
+        double a11, a12, a13;
+        double a22, a23;
+        double a33;
+        double weight;
+
+        static Quadric fromPlane(const glm::dvec3& normal, const double distance, const double weight) {
+            const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+            return {
+                weight * a * a, weight * a * b, weight * a * c, weight * a * d,
+                weight * b * b, weight * b * c, weight * b * d,
+                weight * c * c, weight * c * d,
+                weight * d * d,
+                weight
+            };
+        }
+
+        void add(const Quadric& q) {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+            weight += q.weight;
+        }
+
+        // Squared distance averaged over the weight
+        double error(const glm::vec3& p) const {
+            const double x = p.x, y = p.y, z = p.z;
+            const double e = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+                           + a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+                           + a22 * z * z + 2.0 * a23 * z
+                           + a33;
+            return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float cost;
+    };
+
+    // Id of the first vertex at the same position for every vertex, so seams count as one point of the surface
+    std::vector<uint32_t> weldPositions(const Vertex* vertices, const uint32_t vertexCount) {
+        size_t table_size = 16;
+        while (table_size < 2 * static_cast<size_t>(vertexCount)) {
+            table_size *= 2;
+        }
+        const size_t mask = table_size - 1;
+        std::vector<uint32_t> table(table_size, NONE);
+        std::vector<uint32_t> position_ids(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            const auto& position = vertices[v].Position;
+            size_t slot = Hash::hash64(&position, sizeof(position)) & mask;
+            while (table[slot] != NONE && std::memcmp(&vertices[table[slot]].Position, &position, sizeof(position)) != 0) {
+                slot = (slot + 1) & mask;
+            }
+            if (table[slot] == NONE) {
+                table[slot] = v;
+            }
+            position_ids[v] = table[slot];
+        }
+        return position_ids;
+    }
+
+    // Vertices that must stay where they are: seams, and borders or non-manifold edges of the welded surface
+    std::vector<uint8_t> findLockedVertices(const GLuint* indices, const size_t indexCount, const std::vector<uint32_t>& positionIds) {
+        const uint32_t vertex_count = static_cast<uint32_t>(positionIds.size());
+        std::vector<uint8_t> locked(vertex_count, 0);
+        std::vector<uint32_t> wedges(vertex_count, 0);
+        for (uint32_t v = 0; v < vertex_count; ++v) {
+            ++wedges[positionIds[v]];
+        }
+
+        // A closed manifold surface has every directed edge exactly once and its reverse exactly once
+        std::vector<uint64_t> edges;
+        edges.reserve(indexCount);
+        for (size_t i = 0; i < indexCount; i += 3) {
+            for (uint32_t e = 0; e < 3; ++e) {
+                const uint64_t a = positionIds[indices[i + e]];
+                const uint64_t b = positionIds[indices[i + (e + 1) % 3]];
+                if (a != b) {
+                    edges.push_back(a << 32 | b);
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        std::vector<uint8_t> locked_position(vertex_count, 0);
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const uint64_t edge = edges[i];
+            const uint64_t reverse = edge << 32 | edge >> 32;
+            const bool duplicate = (i > 0 && edges[i - 1] == edge) || (i + 1 < edges.size() && edges[i + 1] == edge);
+            const auto range = std::equal_range(edges.begin(), edges.end(), reverse);
+            if (duplicate || range.second - range.first != 1) {
+                locked_position[edge >> 32] = 1;
+                locked_position[edge & 0xFFFFFFFFu] = 1;
+            }
+        }
+
+        for (uint32_t v = 0; v < vertex_count; ++v) {
+            locked[v] = wedges[positionIds[v]] > 1 || locked_position[positionIds[v]];
+        }
+        return locked;
+    }
+
+    glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        return glm::cross(b - a, c - a);
+    }
+}
+
+size_t MeshSimplifier::simplify(GLuint* destination, const GLuint* indices, const size_t indexCount, const Vertex* vertices,
+                                const uint32_t vertexCount, const size_t targetIndexCount, const float maxError, float& error) {
+    error = 0.0f;
+    std::copy(indices, indices + indexCount, destination);
+    if (indexCount % 3 != 0 || indexCount <= targetIndexCount) {
+        return indexCount;
+    }
+
+    const auto position_ids = weldPositions(vertices, vertexCount);
+    const auto locked = findLockedVertices(indices, indexCount, position_ids);
+
+    // Quadrics belong to positions, a seam vertex a collapse lands on carries the planes of every wedge
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t i = 0; i < indexCount; i += 3) {
+        const glm::vec3& a = vertices[indices[i]].Position;
+        const glm::vec3& b = vertices[indices[i + 1]].Position;
+        const glm::vec3& c = vertices[indices[i + 2]].Position;
+        const glm::dvec3 normal = glm::dvec3(triangleNormal(a, b, c));
+        const double length = glm::length(normal);
+        if (length == 0.0) {
+            continue;
+        }
+        const glm::dvec3 unit = normal / length;
+        const auto plane = Quadric::fromPlane(unit, -glm::dot(unit, glm::dvec3(a)), 0.5 * length);
+        for (uint32_t corner = 0; corner < 3; ++corner) {
+            quadrics[position_ids[indices[i + corner]]].add(plane);
+        }
+    }
+
+    const double max_cost = static_cast<double>(maxError) * maxError;
+    double result_cost = 0.0;
+    size_t count = indexCount;
+    std::vector<uint32_t> first_triangle(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+
+    // Passes of independent collapses, cheapest first, until the target is reached or nothing cheap enough is left
+    while (count > targetIndexCount) {
+        // Triangles around every vertex
+        std::fill(first_triangle.begin(), first_triangle.end(), 0);
+        for (size_t i = 0; i < count; ++i) {
+            ++first_triangle[destination[i] + 1];
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            first_triangle[v + 1] += first_triangle[v];
+        }
+        adjacency.resize(count);
+        {
+            std::vector<uint32_t> fill(first_triangle.begin(), first_triangle.end() - 1);
+            for (size_t i = 0; i < count; ++i) {
+                adjacency[fill[destination[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        // Every edge in both directions, a vertex may only move onto a neighbour
+        collapses.clear();
+        for (size_t i = 0; i < count; i += 3) {
+            for (uint32_t e = 0; e < 3; ++e) {
+                const GLuint from = destination[i + e];
+                const GLuint to = destination[i + (e + 1) % 3];
+                if (locked[from] || from == to) {
+                    continue;
+                }
+                Quadric q = quadrics[position_ids[from]];
+                q.add(quadrics[position_ids[to]]);
+                const double cost = q.error(vertices[to].Position);
+                if (cost <= max_cost) {
+                    collapses.push_back({ from, to, static_cast<float>(cost) });
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+
+        // A collapse removes about two triangles, stop a pass once the target is in reach
+        const size_t collapse_budget = (count - targetIndexCount) / 6 + 1;
+        size_t collapsed = 0;
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            remap[v] = v;
+        }
+        std::fill(touched.begin(), touched.end(), 0);
+        for (const auto& collapse : collapses) {
+            if (collapsed >= collapse_budget) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            // Moving the vertex must not fold any of its remaining triangles over
+            const glm::vec3& target = vertices[collapse.to].Position;
+            bool flips = false;
+            for (uint32_t t = first_triangle[collapse.from]; t < first_triangle[collapse.from + 1] && !flips; ++t) {
+                const GLuint* corners = &destination[adjacency[t] * 3];
+                if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+                    continue;
+                }
+                glm::vec3 moved[3];
+                for (uint32_t corner = 0; corner < 3; ++corner) {
+                    moved[corner] = corners[corner] == collapse.from ? target : vertices[corners[corner]].Position;
+                }
+                const glm::vec3 before = triangleNormal(vertices[corners[0]].Position, vertices[corners[1]].Position, vertices[corners[2]].Position);
+                const glm::vec3 after = triangleNormal(moved[0], moved[1], moved[2]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips) {
+                continue;
+            }
+
+            // The one-ring keeps the positions the flip test saw until the next pass
+            remap[collapse.from] = collapse.to;
+            for (uint32_t t = first_triangle[collapse.from]; t < first_triangle[collapse.from + 1]; ++t) {
+                const GLuint* corners = &destination[adjacency[t] * 3];
+                touched[corners[0]] = touched[corners[1]] = touched[corners[2]] = 1;
+            }
+            quadrics[position_ids[collapse.to]].add(quadrics[position_ids[collapse.from]]);
+            result_cost = std::max(result_cost, static_cast<double>(collapse.cost));
+            ++collapsed;
+        }
+        if (collapsed == 0) {
+            break;
+        }
+
+        // Apply the pass and drop the triangles that lost an edge
+        size_t write = 0;
+        for (size_t i = 0; i < count; i += 3) {
+            const GLuint a = remap[destination[i]], b = remap[destination[i + 1]], c = remap[destination[i + 2]];
+            if (a != b && b != c && c != a) {
+                destination[write++] = a;
+                destination[write++] = b;
+                destination[write++] = c;
+            }
+        }
+        count = write;
+    }
+
+    error = static_cast<float>(std::sqrt(result_cost));
+    return count;
+}
@@ -0,0 +1,26 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include "Vertex.h"
+
+// Quadric error metric simplification (Garland and Heckbert 1997) of an indexed triangle list, used by
+// glTFImporter to build the levels of detail of every primitive.
+// Edges collapse onto one of their own vertices, so a level is only a new index list over the primitive's
+// vertices and shares its vertex range. Vertices on open borders and on attribute seams (several vertices
+// at one position) never move, the silhouette of open meshes and the texture layout stay intact.
+// Nothing here touches GL, it runs on any thread.
+class MeshSimplifier {
+    public:
+        // Writes at most targetIndexCount indices to destination, fewer when it runs out of collapses below
+        // maxError, and returns how many. error receives the largest distance a surface moved, in the units
+        // of the positions. destination must hold indexCount indices and may not alias indices.
+        static size_t simplify(GLuint* destination, const GLuint* indices, const size_t indexCount, const Vertex* vertices,
+                               const uint32_t vertexCount, const size_t targetIndexCount, const float maxError, float& error);
+};
+
+#endif
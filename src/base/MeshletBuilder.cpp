@@ -0,0 +1,91 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+void MeshletBuilder::build(const GLuint* indices, const size_t indexCount, const Vertex* vertices, const uint32_t vertexCount,
+                           std::vector<Meshlet>& meshlets) {
+    // Meshlet that last referenced every vertex, so counting a meshlet's vertices needs no clearing
+    std::vector<uint32_t> last_meshlet(vertexCount, std::numeric_limits<uint32_t>::max());
+    uint32_t meshlet = 0;
+    uint32_t meshlet_vertices = 0;
+    size_t meshlet_start = 0;
+
+    const auto emit = [&](const size_t end) {
+        const size_t count = end - meshlet_start;
+        meshlets.push_back({ static_cast<uint32_t>(meshlet_start), static_cast<uint32_t>(count),
+                             computeBounds(indices + meshlet_start, count, vertices) });
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const GLuint a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        const uint32_t added = (last_meshlet[a] != meshlet) + (last_meshlet[b] != meshlet && b != a) + (last_meshlet[c] != meshlet && c != a && c != b);
+        if (meshlet_vertices + added > MAX_VERTICES || i - meshlet_start == 3 * MAX_TRIANGLES) {
+            emit(i);
+            meshlet_start = i;
+            ++meshlet;
+            meshlet_vertices = 0;
+        }
+        for (const GLuint v : { a, b, c }) {
+            if (last_meshlet[v] != meshlet) {
+                last_meshlet[v] = meshlet;
+                ++meshlet_vertices;
+            }
+        }
+    }
+    if (indexCount / 3 * 3 > meshlet_start) {
+        emit(indexCount / 3 * 3);
+    }
+}
+
+MeshletCuller::Bounds MeshletBuilder::computeBounds(const GLuint* indices, const size_t indexCount, const Vertex* vertices) {
+    MeshletCuller::Bounds bounds { glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), 0.0f };
+    if (indexCount < 3) {
+        return bounds;
+    }
+
+    // Sphere around the center of the box, it is within a factor of sqrt(3) of the smallest one
+    glm::vec3 min = vertices[indices[0]].Position, max = min;
+    for (size_t i = 1; i < indexCount; ++i) {
+        min = glm::min(min, vertices[indices[i]].Position);
+        max = glm::max(max, vertices[indices[i]].Position);
+    }
+    bounds.center = 0.5f * (min + max);
+    float radius_squared = 0.0f;
+    for (size_t i = 0; i < indexCount; ++i) {
+        const glm::vec3 offset = vertices[indices[i]].Position - bounds.center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+    bounds.radius = std::sqrt(radius_squared);
+
+    // Cone around the mean face normal; a degenerate triangle has no facing and disables it
+    std::vector<glm::vec3> normals;
+    normals.reserve(indexCount / 3);
+    glm::vec3 sum(0.0f);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const glm::vec3& a = vertices[indices[i]].Position;
+        const glm::vec3& b = vertices[indices[i + 1]].Position;
+        const glm::vec3& c = vertices[indices[i + 2]].Position;
+        const glm::vec3 normal = glm::cross(b - a, c - a);
+        const float length = glm::length(normal);
+        if (length == 0.0f) {
+            return bounds;
+        }
+        normals.push_back(normal / length);
+        sum += normals.back();
+    }
+    const float sum_length = glm::length(sum);
+    if (sum_length < 1e-6f) {
+        return bounds;
+    }
+    bounds.coneAxis = sum / sum_length;
+    float cutoff = 1.0f;
+    for (const auto& normal : normals) {
+        cutoff = std::min(cutoff, glm::dot(bounds.coneAxis, normal));
+    }
+    bounds.coneCutoff = std::max(cutoff, 0.0f);
+    return bounds;
+}
@@ -0,0 +1,36 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "MeshletCuller.h"
+#include "Vertex.h"
+
+// Partitions a triangle list into meshlets at import time: runs of consecutive triangles with at most
+// MAX_VERTICES distinct vertices and MAX_TRIANGLES triangles. The triangle order is kept, after
+// MeshOptimizer it keeps the vertex cache order and the runs are compact patches of the surface, and a
+// meshlet stays a plain index range that an indirect draw command can address.
+// Nothing here touches GL, it runs on any thread.
+class MeshletBuilder {
+    public:
+        static constexpr uint32_t MAX_VERTICES = 64;
+        static constexpr uint32_t MAX_TRIANGLES = 124;
+
+        struct Meshlet {
+            uint32_t firstIndex;    // Into the indices the meshlet was built from
+            uint32_t indexCount;
+            MeshletCuller::Bounds bounds;   // Local space
+        };
+
+        // Appends the meshlets of the triangle list to meshlets
+        static void build(const GLuint* indices, const size_t indexCount, const Vertex* vertices, const uint32_t vertexCount,
+                          std::vector<Meshlet>& meshlets);
+        // Bounding sphere and normal cone of a triangle list
+        static MeshletCuller::Bounds computeBounds(const GLuint* indices, const size_t indexCount, const Vertex* vertices);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "MeshletCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MESHLET_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MESHLET_CULLER_SSE
+#endif
+
+namespace {
+    void storeMask(const int mask, const size_t first, const size_t count, std::vector<uint8_t>& visible) {
+        for (size_t lane = 0; lane < count; ++lane) {
+            visible[first + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+}
+
+void MeshletCuller::resize(const size_t count) {
+    m_count = count;
+    const size_t padded = (count + LANES - 1) / LANES * LANES;
+    for (auto* values : { &m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_axisX, &m_axisY, &m_axisZ, &m_coneCos }) {
+        values->assign(padded, 0.0f);
+    }
+    m_coneSin.assign(padded, 1.0f);
+}
+
+void MeshletCuller::setBounds(const size_t index, const Bounds& local, const glm::mat4& world, const bool useCone) {
+    const glm::vec3 center = glm::vec3(world * glm::vec4(local.center, 1.0f));
+    const glm::mat3 linear = glm::mat3(world);
+    const glm::vec3 scale(glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]));
+    const float max_scale = std::max({ scale.x, scale.y, scale.z });
+    const float min_scale = std::min({ scale.x, scale.y, scale.z });
+
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_radius[index] = local.radius * max_scale;
+
+    // Under uniform scale the cross product of transformed edges is the rotated normal, negated by a mirroring transform
+    float cone_cos = 0.0f;
+    glm::vec3 axis(0.0f);
+    if (useCone && local.coneCutoff > 0.0f && max_scale > 0.0f && max_scale - min_scale <= 1e-3f * max_scale) {
+        axis = glm::normalize(linear * local.coneAxis) * (glm::determinant(linear) < 0.0f ? -1.0f : 1.0f);
+        cone_cos = std::min(local.coneCutoff, 1.0f);
+    }
+    m_axisX[index] = axis.x;
+    m_axisY[index] = axis.y;
+    m_axisZ[index] = axis.z;
+    m_coneCos[index] = cone_cos;
+    m_coneSin[index] = std::sqrt(1.0f - cone_cos * cone_cos);
+}
+
+// A meshlet is culled when its sphere lies behind a frustum plane, or when every point of the sphere
+// sees every normal of the cone facing away: with v the vector from the eye to the center, theta its
+// angle to the axis and alpha the cone's half angle, each triangle normal n and point p satisfy
+// dot(n, p - eye) >= |v| cos(theta + alpha) - radius, which is positive when
+// dot(axis, v) cos(alpha) - sqrt(|v|^2 - dot(axis, v)^2) sin(alpha) > radius.
+size_t MeshletCuller::cull(const FrustumCuller::Frustum& frustum, const glm::vec3& eye, std::vector<uint8_t>& visible) const {
+    visible.resize(m_count);
+
+#if defined(MESHLET_CULLER_AVX)
+    const __m256 eye_x = _mm256_set1_ps(eye.x), eye_y = _mm256_set1_ps(eye.y), eye_z = _mm256_set1_ps(eye.z);
+    for (size_t first = 0; first < m_count; first += 8) {
+        const __m256 cx = _mm256_loadu_ps(&m_centerX[first]);
+        const __m256 cy = _mm256_loadu_ps(&m_centerY[first]);
+        const __m256 cz = _mm256_loadu_ps(&m_centerZ[first]);
+        const __m256 radius = _mm256_loadu_ps(&m_radius[first]);
+        const __m256 negative_radius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+
+        __m256 culled = _mm256_setzero_ps();
+        for (const auto& plane : frustum.planes) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_set1_ps(plane.w));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), cy));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), cz));
+            culled = _mm256_or_ps(culled, _mm256_cmp_ps(distance, negative_radius, _CMP_LT_OQ));
+        }
+
+        const __m256 vx = _mm256_sub_ps(cx, eye_x);
+        const __m256 vy = _mm256_sub_ps(cy, eye_y);
+        const __m256 vz = _mm256_sub_ps(cz, eye_z);
+        __m256 along = _mm256_mul_ps(_mm256_loadu_ps(&m_axisX[first]), vx);
+        along = _mm256_add_ps(along, _mm256_mul_ps(_mm256_loadu_ps(&m_axisY[first]), vy));
+        along = _mm256_add_ps(along, _mm256_mul_ps(_mm256_loadu_ps(&m_axisZ[first]), vz));
+        __m256 length_squared = _mm256_mul_ps(vx, vx);
+        length_squared = _mm256_add_ps(length_squared, _mm256_mul_ps(vy, vy));
+        length_squared = _mm256_add_ps(length_squared, _mm256_mul_ps(vz, vz));
+        const __m256 across = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(length_squared, _mm256_mul_ps(along, along)), _mm256_setzero_ps()));
+        const __m256 facing = _mm256_sub_ps(_mm256_mul_ps(along, _mm256_loadu_ps(&m_coneCos[first])),
+                                            _mm256_mul_ps(across, _mm256_loadu_ps(&m_coneSin[first])));
+        culled = _mm256_or_ps(culled, _mm256_cmp_ps(facing, radius, _CMP_GT_OQ));
+
+        storeMask(~_mm256_movemask_ps(culled), first, std::min<size_t>(8, m_count - first), visible);
+    }
+#elif defined(MESHLET_CULLER_SSE)
+    const __m128 eye_x = _mm_set1_ps(eye.x), eye_y = _mm_set1_ps(eye.y), eye_z = _mm_set1_ps(eye.z);
+    for (size_t first = 0; first < m_count; first += 4) {
+        const __m128 cx = _mm_loadu_ps(&m_centerX[first]);
+        const __m128 cy = _mm_loadu_ps(&m_centerY[first]);
+        const __m128 cz = _mm_loadu_ps(&m_centerZ[first]);
+        const __m128 radius = _mm_loadu_ps(&m_radius[first]);
+        const __m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+        __m128 culled = _mm_setzero_ps();
+        for (const auto& plane : frustum.planes) {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_set1_ps(plane.w));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), cz));
+            culled = _mm_or_ps(culled, _mm_cmplt_ps(distance, negative_radius));
+        }
+
+        const __m128 vx = _mm_sub_ps(cx, eye_x);
+        const __m128 vy = _mm_sub_ps(cy, eye_y);
+        const __m128 vz = _mm_sub_ps(cz, eye_z);
+        __m128 along = _mm_mul_ps(_mm_loadu_ps(&m_axisX[first]), vx);
+        along = _mm_add_ps(along, _mm_mul_ps(_mm_loadu_ps(&m_axisY[first]), vy));
+        along = _mm_add_ps(along, _mm_mul_ps(_mm_loadu_ps(&m_axisZ[first]), vz));
+        __m128 length_squared = _mm_mul_ps(vx, vx);
+        length_squared = _mm_add_ps(length_squared, _mm_mul_ps(vy, vy));
+        length_squared = _mm_add_ps(length_squared, _mm_mul_ps(vz, vz));
+        const __m128 across = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(length_squared, _mm_mul_ps(along, along)), _mm_setzero_ps()));
+        const __m128 facing = _mm_sub_ps(_mm_mul_ps(along, _mm_loadu_ps(&m_coneCos[first])),
+                                         _mm_mul_ps(across, _mm_loadu_ps(&m_coneSin[first])));
+        culled = _mm_or_ps(culled, _mm_cmpgt_ps(facing, radius));
+
+        storeMask(~_mm_movemask_ps(culled), first, std::min<size_t>(4, m_count - first), visible);
+    }
+#else
+    // Whole array without SIMD
+    return cullReference(frustum, eye, visible);
+#endif
+
+    return static_cast<size_t>(std::count(visible.begin(), visible.end(), 1));
+}
+
+size_t MeshletCuller::cullReference(const FrustumCuller::Frustum& frustum, const glm::vec3& eye, std::vector<uint8_t>& visible) const {
+    visible.resize(m_count);
+    for (size_t i = 0; i < m_count; ++i) {
+        bool culled = false;
+        for (const auto& plane : frustum.planes) {
+            float distance = plane.x * m_centerX[i] + plane.w;
+            distance = distance + plane.y * m_centerY[i];
+            distance = distance + plane.z * m_centerZ[i];
+            culled = culled || distance < -m_radius[i];
+        }
+
+        const float vx = m_centerX[i] - eye.x;
+        const float vy = m_centerY[i] - eye.y;
+        const float vz = m_centerZ[i] - eye.z;
+        float along = m_axisX[i] * vx;
+        along = along + m_axisY[i] * vy;
+        along = along + m_axisZ[i] * vz;
+        float length_squared = vx * vx;
+        length_squared = length_squared + vy * vy;
+        length_squared = length_squared + vz * vz;
+        const float across = std::sqrt(std::max(length_squared - along * along, 0.0f));
+        const float facing = along * m_coneCos[i] - across * m_coneSin[i];
+        culled = culled || facing > m_radius[i];
+
+        visible[i] = culled ? 0 : 1;
+    }
+    return static_cast<size_t>(std::count(visible.begin(), visible.end(), 1));
+}
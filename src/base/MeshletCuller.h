@@ -0,0 +1,49 @@
+#ifndef MESHLET_CULLER_H
+#define MESHLET_CULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+
+// Culls meshlets (small clusters of a primitive's triangles, see MeshletBuilder) against the view
+// frustum with their bounding spheres and against the eye with their normal cones: a cluster whose
+// triangles all face away from the eye is dropped. World-space bounds are stored as structure-of-arrays
+// like FrustumCuller's boxes, so the test runs on 8 meshlets per instruction with AVX and 4 with SSE.
+// Only needs glm, the kernel runs and can be checked against cullReference() without a GPU.
+class MeshletCuller {
+    public:
+        // Every triangle lies inside the sphere and its normal is within the cone's half angle of the
+        // axis, coneCutoff being the cosine of that angle. A cutoff of 0 or less never culls.
+        struct Bounds {
+            glm::vec3 center;
+            float radius;
+            glm::vec3 coneAxis;
+            float coneCutoff;
+        };
+
+        void resize(const size_t count);
+        size_t size() const { return m_count; }
+
+        // Transforms local bounds by a node's world matrix. The cone is dropped under non-uniform scale,
+        // which bends normals, and when useCone is false, e.g. for double-sided materials.
+        void setBounds(const size_t index, const Bounds& local, const glm::mat4& world, const bool useCone);
+
+        // Writes 1 to visible[i] for every meshlet that may be seen from eye and 0 otherwise, returns the visible count
+        size_t cull(const FrustumCuller::Frustum& frustum, const glm::vec3& eye, std::vector<uint8_t>& visible) const;
+        // Same result one meshlet at a time, the reference the SIMD paths are checked against
+        size_t cullReference(const FrustumCuller::Frustum& frustum, const glm::vec3& eye, std::vector<uint8_t>& visible) const;
+
+    private:
+        static constexpr size_t LANES = 8;
+
+        size_t m_count { 0 };
+        std::vector<float> m_centerX, m_centerY, m_centerZ, m_radius;
+        // Cosine and sine of the cone's half angle, a cone that never culls has 0 and 1
+        std::vector<float> m_axisX, m_axisY, m_axisZ, m_coneCos, m_coneSin;
+};
+
+#endif
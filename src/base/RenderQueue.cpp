@@ -0,0 +1,65 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+    constexpr uint32_t RADIX_BITS = 8;
+    constexpr uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+    constexpr uint32_t BUCKETS = 1 << RADIX_BITS;
+
+    uint64_t field(const uint32_t value, const uint32_t bits) {
+        return static_cast<uint64_t>(value & ((1u << bits) - 1));
+    }
+}
+
+uint64_t RenderQueue::makeKey(const render_pass pass, const uint32_t shader, const uint32_t texture, const uint32_t material, const float depth) {
+    constexpr uint32_t max_depth = (1u << DEPTH_BITS) - 1;
+    const auto depth_bucket = static_cast<uint32_t>(std::lround(std::clamp(depth, 0.0f, 1.0f) * max_depth));
+
+    const uint64_t state = field(shader, SHADER_BITS) << (TEXTURE_BITS + MATERIAL_BITS) |
+                           field(texture, TEXTURE_BITS) << MATERIAL_BITS |
+                           field(material, MATERIAL_BITS);
+    const uint64_t key = static_cast<uint64_t>(pass) << 62;
+    if (pass == pass_transparent) {
+        return key | static_cast<uint64_t>(max_depth - depth_bucket) << (SHADER_BITS + TEXTURE_BITS + MATERIAL_BITS) | state;
+    }
+    return key | state << DEPTH_BITS | depth_bucket;
+}
+
+void RenderQueue::sort() {
+    const size_t count = m_items.size();
+    if (count < 2) {
+        return;
+    }
+
+    // Histograms of every digit in one read of the keys
+    std::array<std::array<uint32_t, BUCKETS>, RADIX_PASSES> histograms{};
+    for (const auto& item : m_items) {
+        for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass) {
+            ++histograms[pass][(item.key >> (pass * RADIX_BITS)) & (BUCKETS - 1)];
+        }
+    }
+
+    m_scratch.resize(count);
+    for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass) {
+        auto& histogram = histograms[pass];
+        const uint32_t shift = pass * RADIX_BITS;
+        // Every key has the same digit, the pass would not move anything. Unused key bits skip most passes.
+        if (histogram[(m_items[0].key >> shift) & (BUCKETS - 1)] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (auto& bucket : histogram) {
+            const uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (const auto& item : m_items) {
+            m_scratch[histogram[(item.key >> shift) & (BUCKETS - 1)]++] = item;
+        }
+        m_items.swap(m_scratch);
+    }
+}
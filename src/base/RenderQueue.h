@@ -0,0 +1,47 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Draws of a frame as 64-bit sort keys with a payload identifying what to draw, e.g. a primitive index.
+// sort() orders them with a radix sort so that replaying them in order changes state only where the
+// key changes. Bits from the most significant:
+//   opaque:      pass (2) | shader (6) | texture (16) | material (16) | depth (24), near to far
+//   transparent: pass (2) | depth (24), far to near | shader (6) | texture (16) | material (16)
+// Opaque draws are grouped by state and front to back within a group for early depth rejection.
+// Transparent draws blend in back to front order, which comes before the state.
+class RenderQueue {
+    public:
+        enum render_pass : uint32_t { pass_opaque, pass_transparent };
+
+        static constexpr uint32_t SHADER_BITS = 6;
+        static constexpr uint32_t TEXTURE_BITS = 16;
+        static constexpr uint32_t MATERIAL_BITS = 16;
+        static constexpr uint32_t DEPTH_BITS = 24;
+
+        struct Item {
+            uint64_t key;
+            uint32_t payload;
+        };
+
+        // shader, texture and material are small indices, only their low bits are kept: larger ones still
+        // sort correctly by pass and depth but may interleave state groups. depth is in [0, 1], 0 is nearest.
+        static uint64_t makeKey(const render_pass pass, const uint32_t shader, const uint32_t texture, const uint32_t material, const float depth);
+        static render_pass getPass(const uint64_t key) { return static_cast<render_pass>(key >> 62); }
+
+        void clear() { m_items.clear(); }
+        void submit(const uint64_t key, const uint32_t payload) { m_items.push_back({ key, payload }); }
+        // Stable, items with equal keys keep their submission order
+        void sort();
+
+        const std::vector<Item>& getItems() const { return m_items; }
+        size_t size() const { return m_items.size(); }
+
+    private:
+        std::vector<Item> m_items;
+        std::vector<Item> m_scratch;    // kept between frames, sorting does not allocate once warm
+};
+
+#endif
@@ -0,0 +1,234 @@
+#include "SHIrradiance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SH_IRRADIANCE_SSE
+#endif
+
+#include "../utility/ThreadPool.h"
+
+namespace {
+    constexpr double PI = 3.14159265358979323846;
+
+    // Rows handed to a worker at once
+    constexpr int ROWS_PER_TASK = 8;
+
+    // Within a row the latitude is constant, so every basis function is a row factor times one of
+    // 1, cos(phi), sin(phi), sin(phi)cos(phi) or cos(2phi). A row sum holds those five terms for r, g and b.
+    constexpr int TERM_COUNT = 5;
+    using RowSums = std::array<float, TERM_COUNT * 3>;
+
+    struct ColumnTerms {
+        std::vector<float> cos_phi;
+        std::vector<float> sin_phi;
+        std::vector<float> sin_cos_phi;
+        std::vector<float> cos_2phi;
+    };
+
+    // Sums radiance times the column terms over one row of interleaved RGB texels
+    RowSums sumRow(const float* row, const ColumnTerms& terms, const int width) {
+        RowSums sums{};
+        int x = 0;
+
+#ifdef SH_IRRADIANCE_SSE
+        __m128 acc[TERM_COUNT][3];
+        for (auto& term : acc) {
+            for (auto& channel : term) {
+                channel = _mm_setzero_ps();
+            }
+        }
+
+        for (; x + 4 <= width; x += 4) {
+            // Deinterleave four RGB texels
+            const float* texel = row + x * 3;
+            const __m128 a = _mm_loadu_ps(texel);       // r0 g0 b0 r1
+            const __m128 b = _mm_loadu_ps(texel + 4);   // g1 b1 r2 g2
+            const __m128 c = _mm_loadu_ps(texel + 8);   // b2 r3 g3 b3
+            const __m128 r = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+            const __m128 g = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 bl = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 rgb[3] = { r, g, bl };
+
+            const __m128 factors[TERM_COUNT - 1] = {
+                _mm_loadu_ps(&terms.cos_phi[x]),
+                _mm_loadu_ps(&terms.sin_phi[x]),
+                _mm_loadu_ps(&terms.sin_cos_phi[x]),
+                _mm_loadu_ps(&terms.cos_2phi[x])
+            };
+
+            for (int channel = 0; channel < 3; ++channel) {
+                acc[0][channel] = _mm_add_ps(acc[0][channel], rgb[channel]);
+                for (int term = 1; term < TERM_COUNT; ++term) {
+                    acc[term][channel] = _mm_add_ps(acc[term][channel], _mm_mul_ps(rgb[channel], factors[term - 1]));
+                }
+            }
+        }
+
+        for (int term = 0; term < TERM_COUNT; ++term) {
+            for (int channel = 0; channel < 3; ++channel) {
+                alignas(16) float lanes[4];
+                _mm_store_ps(lanes, acc[term][channel]);
+                sums[term * 3 + channel] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            }
+        }
+#endif
+
+        // Remaining texels, or the whole row without SSE
+        for (; x < width; ++x) {
+            const float factors[TERM_COUNT] = { 1.0f, terms.cos_phi[x], terms.sin_phi[x], terms.sin_cos_phi[x], terms.cos_2phi[x] };
+            for (int term = 0; term < TERM_COUNT; ++term) {
+                for (int channel = 0; channel < 3; ++channel) {
+                    sums[term * 3 + channel] += row[x * 3 + channel] * factors[term];
+                }
+            }
+        }
+        return sums;
+    }
+}
+
+SHIrradiance::Coefficients SHIrradiance::project(const float* pixels, const int width, const int height) {
+    // Texel (x, y) looks along the direction cubemapConverter.frag samples it from:
+    // phi = atan(z, x) over the width, latitude = asin(y) over the height
+    ColumnTerms terms;
+    terms.cos_phi.resize(width);
+    terms.sin_phi.resize(width);
+    terms.sin_cos_phi.resize(width);
+    terms.cos_2phi.resize(width);
+    for (int x = 0; x < width; ++x) {
+        const double phi = ((x + 0.5) / width - 0.5) * 2.0 * PI;
+        terms.cos_phi[x] = static_cast<float>(std::cos(phi));
+        terms.sin_phi[x] = static_cast<float>(std::sin(phi));
+        terms.sin_cos_phi[x] = static_cast<float>(std::sin(phi) * std::cos(phi));
+        terms.cos_2phi[x] = static_cast<float>(std::cos(2.0 * phi));
+    }
+
+    // Unnormalized basis polynomials, in the order of sh_irradiance.glsl:
+    // 1, y, z, x, xy, yz, 3y^2 - 1, xz, x^2 - z^2
+    const size_t task_count = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    std::vector<Projection> partial(task_count);
+
+    ThreadPool::getInstance().parallelFor(0, task_count, [&](const size_t task) {
+        auto& projection = partial[task];
+        projection.fill(0.0);
+
+        const int end = std::min(height, static_cast<int>(task + 1) * ROWS_PER_TASK);
+        for (int row = static_cast<int>(task) * ROWS_PER_TASK; row < end; ++row) {
+            const double latitude = ((row + 0.5) / height - 0.5) * PI;
+            const double y = std::sin(latitude);
+            const double cos_latitude = std::cos(latitude);
+            // Solid angle of a texel in this row
+            const double weight = cos_latitude * (2.0 * PI / width) * (PI / height);
+
+            const auto sums = sumRow(pixels + static_cast<size_t>(row) * width * 3, terms, width);
+            for (int channel = 0; channel < 3; ++channel) {
+                const double radiance = sums[0 * 3 + channel];
+                const double cos_phi = sums[1 * 3 + channel] * cos_latitude;
+                const double sin_phi = sums[2 * 3 + channel] * cos_latitude;
+                const double sin_cos_phi = sums[3 * 3 + channel] * cos_latitude * cos_latitude;
+                const double cos_2phi = sums[4 * 3 + channel] * cos_latitude * cos_latitude;
+
+                // x = cos(phi) cos(latitude), z = sin(phi) cos(latitude)
+                const double basis_sums[COEFFICIENT_COUNT] = {
+                    radiance,
+                    y * radiance,
+                    sin_phi,
+                    cos_phi,
+                    y * cos_phi,
+                    y * sin_phi,
+                    (3.0 * y * y - 1.0) * radiance,
+                    sin_cos_phi,
+                    cos_2phi
+                };
+                for (uint32_t i = 0; i < COEFFICIENT_COUNT; ++i) {
+                    projection[i * 3 + channel] += basis_sums[i] * weight;
+                }
+            }
+        }
+    });
+
+    // Summed in a fixed order so the result does not depend on the thread count
+    Projection total{};
+    for (const auto& projection : partial) {
+        for (size_t i = 0; i < total.size(); ++i) {
+            total[i] += projection[i];
+        }
+    }
+    return normalize(total);
+}
+
+SHIrradiance::Coefficients SHIrradiance::projectCubemap(const float* faces, const int size) {
+    std::vector<Projection> partial(6);
+
+    ThreadPool::getInstance().parallelFor(0, 6, [&](const size_t face) {
+        auto& projection = partial[face];
+        projection.fill(0.0);
+
+        const float* texels = faces + face * static_cast<size_t>(size) * size * 3;
+        for (int y = 0; y < size; ++y) {
+            // Face coordinates of the GL cube map lookup (s along the row, t down the rows)
+            const double t = (y + 0.5) / size * 2.0 - 1.0;
+            for (int x = 0; x < size; ++x) {
+                const double s = (x + 0.5) / size * 2.0 - 1.0;
+                glm::dvec3 direction;
+                switch (face) {
+                case 0: direction = glm::dvec3(1.0, -t, -s); break;
+                case 1: direction = glm::dvec3(-1.0, -t, s); break;
+                case 2: direction = glm::dvec3(s, 1.0, t); break;
+                case 3: direction = glm::dvec3(s, -1.0, -t); break;
+                case 4: direction = glm::dvec3(s, -t, 1.0); break;
+                default: direction = glm::dvec3(-s, -t, -1.0); break;
+                }
+                // Solid angle of the texel: its area on the unit cube over the cubed distance
+                const double length_squared = glm::dot(direction, direction);
+                const double weight = (4.0 / (static_cast<double>(size) * size)) / (length_squared * std::sqrt(length_squared));
+                const glm::dvec3 d = direction / std::sqrt(length_squared);
+
+                const double basis[COEFFICIENT_COUNT] = {
+                    1.0, d.y, d.z, d.x, d.x * d.y, d.y * d.z, 3.0 * d.y * d.y - 1.0, d.x * d.z, d.x * d.x - d.z * d.z
+                };
+                const float* texel = texels + (static_cast<size_t>(y) * size + x) * 3;
+                for (uint32_t i = 0; i < COEFFICIENT_COUNT; ++i) {
+                    for (int channel = 0; channel < 3; ++channel) {
+                        projection[i * 3 + channel] += basis[i] * texel[channel] * weight;
+                    }
+                }
+            }
+        }
+    });
+
+    Projection total{};
+    for (const auto& projection : partial) {
+        for (size_t i = 0; i < total.size(); ++i) {
+            total[i] += projection[i];
+        }
+    }
+    return normalize(total);
+}
+
+SHIrradiance::Coefficients SHIrradiance::normalize(const Projection& total) {
+    // Squared basis normalization (once for the projection, once for the evaluation)
+    // times the clamped cosine convolution A_l / pi: 1, 2/3 and 1/4 for bands 0, 1 and 2
+    constexpr double BASIS[COEFFICIENT_COUNT] = {
+        0.282094792, 0.488602512, 0.488602512, 0.488602512,
+        1.092548431, 1.092548431, 0.315391565, 1.092548431, 0.546274215
+    };
+    constexpr double BAND_CONVOLUTION[COEFFICIENT_COUNT] = {
+        1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25
+    };
+
+    Coefficients coefficients;
+    for (uint32_t i = 0; i < COEFFICIENT_COUNT; ++i) {
+        const double scale = BASIS[i] * BASIS[i] * BAND_CONVOLUTION[i];
+        coefficients[i] = glm::vec4(
+            static_cast<float>(total[i * 3 + 0] * scale),
+            static_cast<float>(total[i * 3 + 1] * scale),
+            static_cast<float>(total[i * 3 + 2] * scale),
+            0.0f
+        );
+    }
+    return coefficients;
+}
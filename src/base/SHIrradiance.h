@@ -0,0 +1,35 @@
+#ifndef SH_IRRADIANCE_H
+#define SH_IRRADIANCE_H
+
+#include <array>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Diffuse irradiance of an environment as nine L2 spherical harmonics coefficients.
+// Replaces the irradiance cubemap: the projection runs on the CPU straight from the equirectangular HDR,
+// and shaders evaluate it from a 144 byte uniform block (see shaders/glsl/sh_irradiance.glsl).
+class SHIrradiance {
+    public:
+        static constexpr uint32_t COEFFICIENT_COUNT = 9;
+
+        // std140 vec4 array, rgb holds the coefficient
+        using Coefficients = std::array<glm::vec4, COEFFICIENT_COUNT>;
+
+        // Projects RGB float texels laid out like ResourceManager::loadHDRIPixels (bottom row first).
+        // The coefficients are convolved with the clamped cosine and divided by pi, so evaluating them
+        // gives the same values as the irradianceConvolution.frag cubemap.
+        // Rows are spread over the ThreadPool and each row is summed with SSE.
+        static Coefficients project(const float* pixels, const int width, const int height);
+        // Same for a cubemap: six faces of size x size RGB float texels in GL face order, each with
+        // its rows as glGetTexImage returns them
+        static Coefficients projectCubemap(const float* faces, const int size);
+
+    private:
+        // Radiance times basis polynomial summed over the sphere, rgb per coefficient
+        using Projection = std::array<double, COEFFICIENT_COUNT * 3>;
+
+        static Coefficients normalize(const Projection& total);
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include "SceneGraph.h"
+
+namespace {
+    // translation * rotation * scale, built directly instead of multiplying three matrices
+    glm::mat4 composeLocal(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale) {
+        const glm::mat3 basis = glm::mat3_cast(rotation);
+        return glm::mat4(
+            glm::vec4(basis[0] * scale.x, 0.0f),
+            glm::vec4(basis[1] * scale.y, 0.0f),
+            glm::vec4(basis[2] * scale.z, 0.0f),
+            glm::vec4(translation, 1.0f)
+        );
+    }
+}
+
+uint32_t SceneGraph::addNode(const int32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale) {
+    const auto node = static_cast<uint32_t>(m_parents.size());
+    m_parents.push_back(parent >= 0 && parent < static_cast<int32_t>(node) ? parent : NO_PARENT);
+    m_translations.push_back(translation);
+    m_rotations.push_back(rotation);
+    m_scales.push_back(scale);
+    m_worldMatrices.push_back(glm::mat4(1.0f));
+    m_dirty.push_back(0);
+    markDirty(node);
+    return node;
+}
+
+void SceneGraph::clear() {
+    m_parents.clear();
+    m_translations.clear();
+    m_rotations.clear();
+    m_scales.clear();
+    m_worldMatrices.clear();
+    m_dirty.clear();
+    m_updatedNodes.clear();
+    m_firstDirty = 0;
+    m_anyDirty = false;
+}
+
+void SceneGraph::setTranslation(const uint32_t node, const glm::vec3& translation) {
+    m_translations[node] = translation;
+    markDirty(node);
+}
+
+void SceneGraph::setRotation(const uint32_t node, const glm::quat& rotation) {
+    m_rotations[node] = rotation;
+    markDirty(node);
+}
+
+void SceneGraph::setScale(const uint32_t node, const glm::vec3& scale) {
+    m_scales[node] = scale;
+    markDirty(node);
+}
+
+void SceneGraph::markDirty(const uint32_t node) {
+    if (!m_anyDirty || node < m_firstDirty) {
+        m_firstDirty = node;
+    }
+    m_dirty[node] = 1;
+    m_anyDirty = true;
+}
+
+size_t SceneGraph::update() {
+    m_updatedNodes.clear();
+    if (!m_anyDirty) {
+        return 0;
+    }
+
+    // Parents come first, so a node sees its parent's flag and world matrix already final.
+    // Flags stay set until the pass is over for the descendants further down the arrays.
+    const auto count = static_cast<uint32_t>(m_parents.size());
+    for (uint32_t node = m_firstDirty; node < count; ++node) {
+        const int32_t parent = m_parents[node];
+        if (!m_dirty[node] && (parent == NO_PARENT || !m_dirty[parent])) {
+            continue;
+        }
+        m_dirty[node] = 1;
+
+        const glm::mat4 local = composeLocal(m_translations[node], m_rotations[node], m_scales[node]);
+        m_worldMatrices[node] = parent == NO_PARENT ? local : m_worldMatrices[parent] * local;
+        m_updatedNodes.push_back(node);
+    }
+
+    for (const auto node : m_updatedNodes) {
+        m_dirty[node] = 0;
+    }
+    m_anyDirty = false;
+    return m_updatedNodes.size();
+}
@@ -0,0 +1,56 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Node transforms of a scene, stored as parallel arrays in topological order (parents before children).
+// Setting a local transform only marks the node dirty; update() then recomputes the world matrices in
+// one forward pass, composing each dirty node and its descendants with the already updated parent.
+class SceneGraph {
+    public:
+        static constexpr int32_t NO_PARENT = -1;
+
+        // The parent must already exist, which keeps the arrays topologically ordered
+        uint32_t addNode(const int32_t parent, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+        void clear();
+
+        void setTranslation(const uint32_t node, const glm::vec3& translation);
+        void setRotation(const uint32_t node, const glm::quat& rotation);
+        void setScale(const uint32_t node, const glm::vec3& scale);
+
+        // Recomputes the world matrices of dirty nodes and their descendants, returns how many changed
+        size_t update();
+
+        size_t size() const { return m_parents.size(); }
+        bool empty() const { return m_parents.empty(); }
+
+        int32_t getParent(const uint32_t node) const { return m_parents[node]; }
+        const glm::vec3& getTranslation(const uint32_t node) const { return m_translations[node]; }
+        const glm::quat& getRotation(const uint32_t node) const { return m_rotations[node]; }
+        const glm::vec3& getScale(const uint32_t node) const { return m_scales[node]; }
+        // Valid as of the last update()
+        const glm::mat4& getWorldMatrix(const uint32_t node) const { return m_worldMatrices[node]; }
+        // Nodes whose world matrix changed in the last update(), in ascending order
+        const std::vector<uint32_t>& getUpdatedNodes() const { return m_updatedNodes; }
+
+    private:
+        void markDirty(const uint32_t node);
+
+        std::vector<int32_t> m_parents;
+        std::vector<glm::vec3> m_translations;
+        std::vector<glm::quat> m_rotations;
+        std::vector<glm::vec3> m_scales;
+        std::vector<glm::mat4> m_worldMatrices;
+        std::vector<uint8_t> m_dirty;
+
+        std::vector<uint32_t> m_updatedNodes;
+        // First dirty node, update() starts there since no earlier node can be affected
+        uint32_t m_firstDirty { 0 };
+        bool m_anyDirty { false };
+};
+
+#endif
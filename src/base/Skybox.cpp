@@ -1,11 +1,25 @@
 #include "Skybox.h"
 
 #include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include "../utility/CompressedTexture.h"
+#include "../utility/Hash.h"
+#include "../utility/MappedFile.h"
+#include "../utility/Profiler.h"
 #include "../utility/ResourceManager.h"
+#include "../utility/ThreadPool.h"
 #include "../graphic/GLShaderProgram.h"
+#include "../graphic/GLState.h"
+#include "../graphic/GLStats.h"
 
 const std::array<float, 108> vertices{
     // back face
@@ -52,43 +66,162 @@ const std::array<float, 108> vertices{
     -1.0f,  1.0f,  1.0f
 };
 
-void Skybox::init(const std::string hdr_path, const GLsizei resolution) {
+namespace {
+    // The coefficients are cached as a 3x3 RGB half texture next to the maps
+    IBLCache::Texture shToTexture(const SHIrradiance::Coefficients& coefficients) {
+        IBLCache::Texture texture;
+        texture.type = IBLCache::texture_2d;
+        texture.size = 3;
+        texture.channels = 3;
+        texture.levels = 1;
+        for (const auto& coefficient : coefficients) {
+            for (int channel = 0; channel < 3; ++channel) {
+                texture.data.push_back(static_cast<uint16_t>(glm::packHalf1x16(coefficient[channel])));
+            }
+        }
+        return texture;
+    }
+
+    bool shFromTexture(const IBLCache::Texture& texture, SHIrradiance::Coefficients& coefficients) {
+        if (texture.type != IBLCache::texture_2d || texture.size != 3 || texture.channels != 3 || texture.levels != 1) {
+            return false;
+        }
+        for (uint32_t i = 0; i < SHIrradiance::COEFFICIENT_COUNT; ++i) {
+            coefficients[i] = glm::vec4(
+                glm::unpackHalf1x16(texture.data[i * 3 + 0]),
+                glm::unpackHalf1x16(texture.data[i * 3 + 1]),
+                glm::unpackHalf1x16(texture.data[i * 3 + 2]),
+                0.0f
+            );
+        }
+        return true;
+    }
+}
+
+void Skybox::init(const std::string hdr_path, const GLsizei resolution, const uint32_t sampleCount, const irradiance_mode irradianceMode) {
+    Profiler::CpuZone zone("Skybox init");
+    m_irradianceMode = irradianceMode;
+
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS); // No seams at cubemap edges
 
+    auto& state = GLState::getInstance();
     glGenVertexArrays(1, &m_cubeVAO);
-    glBindVertexArray(m_cubeVAO);
+    state.bindVertexArray(m_cubeVAO);
 
     unsigned int vbo;
     glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    state.bindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices.data(), GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
 
+    const auto start = std::chrono::steady_clock::now();
+
+    // The BRDF LUT ships prebuilt, only bake it if the asset is missing
+    std::vector<IBLCache::Texture> textures;
+    if (IBLCache::load(IBLCache::getBRDFLUTPath(), IBLCache::getBRDFLUTKey(), textures) && textures.size() == 1) {
+        m_BRDFLUT = uploadTexture(textures[0]);
+    }
+    else {
+        std::cerr << "Skybox: Missing BRDF LUT asset " << IBLCache::getBRDFLUTPath() << ", baking it" << std::endl;
+        bakeBRDFLUT(IBLCache::BRDF_LUT_SIZE, IBLCache::BRDF_LUT_SAMPLES);
+    }
+
+    // Environment maps are cached per HDR file, irradiance mode, resolution and sample count
+    uint64_t hdr_hash = 0;
+    const bool cacheable = IBLCache::hashFile(ResourceManager::getInstance().getAssetsPath() + hdr_path, hdr_hash);
+    const auto cache_key = IBLCache::makeKey(Hash::combine(hdr_hash, m_irradianceMode), static_cast<uint32_t>(resolution), sampleCount);
+    const auto cache_path = IBLCache::getCachePath(cache_key);
+
+    // A compressed cubemap is loaded as is every time, the cache only holds the maps baked from it
+    GLsizei environment_size = 0;
+    if (CompressedTexture::isContainerPath(hdr_path)) {
+        environment_size = loadEnvironment(hdr_path);
+        if (environment_size == 0) {
+            std::cerr << "Skybox: Failed to load environment cubemap " << hdr_path << std::endl;
+            std::abort();
+        }
+    }
+    const size_t lighting = environment_size > 0 ? 0 : 1;
+
+    bool from_cache = cacheable && IBLCache::load(cache_path, cache_key, textures) && textures.size() == lighting + 2 &&
+        (lighting == 0 || textures[0].size == static_cast<uint32_t>(resolution));
+    if (from_cache && m_irradianceMode == irradiance_sh) {
+        from_cache = shFromTexture(textures[lighting + 1], m_irradianceSH);
+    }
+
+    if (from_cache) {
+        if (lighting > 0) {
+            m_envCubemap = uploadTexture(textures[0], true);
+        }
+        if (m_irradianceMode == irradiance_cubemap) {
+            m_irradianceMap = uploadTexture(textures[lighting]);
+            m_prefilterMap = uploadTexture(textures[lighting + 1]);
+        }
+        else {
+            m_prefilterMap = uploadTexture(textures[lighting]);
+        }
+    }
+    else {
+        bakeEnvironment(hdr_path, resolution, sampleCount, environment_size);
+
+        if (cacheable) {
+            // The environment's mip chain is rebuilt on load, only its first level is stored
+            textures.clear();
+            if (lighting > 0) {
+                textures.push_back(readTexture(m_envCubemap, IBLCache::texture_cube, resolution, 3, 1));
+            }
+            if (m_irradianceMode == irradiance_cubemap) {
+                textures.push_back(readTexture(m_irradianceMap, IBLCache::texture_cube, resolution / 16, 3, 1));
+                textures.push_back(readTexture(m_prefilterMap, IBLCache::texture_cube, resolution / 4, 3, maxMipLevels));
+            }
+            else {
+                textures.push_back(readTexture(m_prefilterMap, IBLCache::texture_cube, resolution / 4, 3, maxMipLevels));
+                textures.push_back(shToTexture(m_irradianceSH));
+            }
+            IBLCache::write(cache_path, cache_key, textures);
+        }
+    }
+
+    if (m_irradianceMode == irradiance_sh) {
+        uploadIrradianceSH();
+    }
+
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Skybox " << hdr_path << (m_irradianceMode == irradiance_sh ? " (SH irradiance)" : "") << (from_cache ? " loaded from cache" : " baked") << " in " << elapsed << " ms" << std::endl;
+}
+
+GLsizei Skybox::loadEnvironment(const std::string& path) {
+    MappedFile file;
+    CompressedTexture texture;
+    if (!file.open(ResourceManager::getInstance().getAssetsPath() + path) || !texture.parse(file.data(), file.size())) {
+        return 0;
+    }
+    if (texture.getFaceCount() != 6) {
+        std::cerr << "Skybox: " << path << " is not a cubemap" << std::endl;
+        return 0;
+    }
+
+    m_envCubemap = ResourceManager::getInstance().textureFromCompressed(texture, path);
+    return m_envCubemap ? static_cast<GLsizei>(texture.getWidth()) : 0;
+}
+
+void Skybox::bakeEnvironment(const std::string& hdr_path, const GLsizei resolution, const uint32_t sampleCount, const GLsizei environmentSize) {
+    Profiler::CpuZone cpu_zone("IBL bake");
+    Profiler::GpuZone gpu_zone("IBL bake");
+    auto& state = GLState::getInstance();
+
     // 1.Environment map FBO
     glGenFramebuffers(1, &m_envMapFBO);
     unsigned int envMapRBO;
     glGenRenderbuffers(1, &envMapRBO);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
+    state.bindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
     glBindRenderbuffer(GL_RENDERBUFFER, envMapRBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, resolution, resolution);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, envMapRBO);
 
-    const auto hdrTexture = ResourceManager::getInstance().loadHDRI(hdr_path);
-
-    glGenTextures(1, &m_envCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
-    for (auto i = 0; i < 6; ++i) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, resolution, resolution, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // enable pre-filter mipmap sampling (helps against bright dot artifacts)
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
     // Setup projection and view matrices for capturing data onto the 6 cubemap face directions
     const auto& captureProjection{ glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f) };
     const glm::mat4 captureViews[] {
@@ -100,83 +233,129 @@ void Skybox::init(const std::string hdr_path, const GLsizei resolution) {
         glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
     };
 
-    GLShaderProgram convertToCubemapShader{ "Equirectangular to Cubemap Shader", {
-        {"shaders/glsl/cubemap.vert", "vertex"},
-        {"shaders/glsl/cubemapConverter.frag", "fragment"}
-    } };
+    // Project the SH irradiance on the workers while the GL thread uploads and bakes the maps
+    std::future<void> sh_projection;
+    if (environmentSize == 0) {
+        int hdr_width, hdr_height;
+        const auto hdr_pixels = ResourceManager::getInstance().loadHDRIPixels(hdr_path, hdr_width, hdr_height);
+        if (!hdr_pixels) {
+            std::cerr << "Skybox: Failed to load HDRI " << hdr_path << std::endl;
+            std::abort();
+        }
 
-    convertToCubemapShader.bind();
-    convertToCubemapShader.setUniformi("equirectangularMap", 0);
-    convertToCubemapShader.setUniform("projection", captureProjection);
+        if (m_irradianceMode == irradiance_sh) {
+            sh_projection = ThreadPool::getInstance().submit([this, hdr_pixels, hdr_width, hdr_height]() {
+                Profiler::CpuZone zone("SH projection");
+                m_irradianceSH = SHIrradiance::project(hdr_pixels.get(), hdr_width, hdr_height);
+            });
+        }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        const auto hdrTexture = ResourceManager::getInstance().hdriFromBuffer(hdr_pixels.get(), hdr_width, hdr_height);
 
-    glViewport(0, 0, resolution, resolution);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
-    for (auto i = 0; i < 6; ++i) {
-        convertToCubemapShader.setUniform("view", captureViews[i]);
+        glGenTextures(1, &m_envCubemap);
+        state.bindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
+        for (auto i = 0; i < 6; ++i) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, resolution, resolution, 0, GL_RGB, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // enable pre-filter mipmap sampling (helps against bright dot artifacts)
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        // Attach environment texture to FBO
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_envCubemap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        GLShaderProgram convertToCubemapShader{ "Equirectangular to Cubemap Shader", {
+            {"shaders/glsl/cubemap.vert", "vertex"},
+            {"shaders/glsl/cubemapConverter.frag", "fragment"}
+        } };
 
-        renderCube();
-    }
+        convertToCubemapShader.bind();
+        convertToCubemapShader.setUniformi("equirectangularMap", 0);
+        convertToCubemapShader.setUniform("projection", captureProjection);
 
-    glDeleteTextures(1, &hdrTexture);
-    convertToCubemapShader.deleteProgram();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        state.bindTexture(0, GL_TEXTURE_2D, hdrTexture);
 
-    // Generate mipmaps from first mip face (again to reduce bright dots)
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        glViewport(0, 0, resolution, resolution);
+        state.bindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
+        for (auto i = 0; i < 6; ++i) {
+            convertToCubemapShader.setUniform("view", captureViews[i]);
 
-    // 2.Precompute irradiance cubemap.
-    glGenTextures(1, &m_irradianceMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_irradianceMap);
-    for (auto i = 0; i < 6; ++i) {
-        // Convoluting a cubemap purposefully scrubs out the fine details so we only need a low-res image (default 32)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, resolution / 16, resolution / 16, 0, GL_RGB, GL_FLOAT, nullptr);
+            // Attach environment texture to FBO
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_envCubemap, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            renderCube();
+        }
+
+        state.deleteTextures(1, &hdrTexture);
+        convertToCubemapShader.deleteProgram();
+        state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // Generate mipmaps from first mip face (again to reduce bright dots)
+        state.bindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    }
+    else if (m_irradianceMode == irradiance_sh) {
+        // The driver decodes the compressed cubemap when reading it back
+        auto faces = std::make_shared<std::vector<float>>(static_cast<size_t>(environmentSize) * environmentSize * 3 * 6);
+        state.bindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
+        for (auto i = 0; i < 6; ++i) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, GL_FLOAT, faces->data() + static_cast<size_t>(environmentSize) * environmentSize * 3 * i);
+        }
+        sh_projection = ThreadPool::getInstance().submit([this, faces, environmentSize]() {
+            Profiler::CpuZone zone("SH projection");
+            m_irradianceSH = SHIrradiance::projectCubemap(faces->data(), environmentSize);
+        });
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, envMapRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, resolution / 16, resolution / 16);
+    // 2.Precompute irradiance cubemap, the SH path replaces it
+    if (m_irradianceMode == irradiance_cubemap) {
+        Profiler::CpuZone cpu_zone("Irradiance convolution");
+        Profiler::GpuZone gpu_zone("Irradiance convolution");
 
-    // Solve diffuse integral by convolution to create an irradiance cubemap
-    GLShaderProgram irradianceShader{"Irradiance Shader", {
-        {"shaders/glsl/cubemap.vert", "vertex"},
-        {"shaders/glsl/irradianceConvolution.frag", "fragment"}
-    }};
+        glGenTextures(1, &m_irradianceMap);
+        state.bindTexture(GL_TEXTURE_CUBE_MAP, m_irradianceMap);
+        for (auto i = 0; i < 6; ++i) {
+            // Convoluting a cubemap purposefully scrubs out the fine details so we only need a low-res image (default 32)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, resolution / 16, resolution / 16, 0, GL_RGB, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    irradianceShader.bind();
-    irradianceShader.setUniformi("environmentMap", 0);
-    irradianceShader.setUniform("projection", captureProjection);
+        state.bindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, envMapRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, resolution / 16, resolution / 16);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
+        // Solve diffuse integral by convolution to create an irradiance cubemap
+        GLShaderProgram irradianceShader{"Irradiance Shader", {
+            {"shaders/glsl/cubemap.vert", "vertex"},
+            {"shaders/glsl/irradianceConvolution.frag", "fragment"}
+        }};
 
-    glViewport(0, 0, resolution / 16, resolution / 16);
-    glBindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
-    for (unsigned int i = 0; i < 6; ++i) {
-        irradianceShader.setUniform("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_irradianceMap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        irradianceShader.bind();
+        irradianceShader.setUniformi("environmentMap", 0);
+        irradianceShader.setUniform("projection", captureProjection);
+
+        state.bindTexture(0, GL_TEXTURE_CUBE_MAP, m_envCubemap);
+
+        glViewport(0, 0, resolution / 16, resolution / 16);
+        state.bindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
+        for (unsigned int i = 0; i < 6; ++i) {
+            irradianceShader.setUniform("view", captureViews[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_irradianceMap, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        renderCube();
+            renderCube();
+        }
+        irradianceShader.deleteProgram();
+        state.bindFramebuffer(GL_FRAMEBUFFER, 0);
     }
-    irradianceShader.deleteProgram();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // 3.Create a pre-filter cubemap, and re-scale capture FBO to pre-filter scale
     glGenTextures(1, &m_prefilterMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_prefilterMap);
+    state.bindTexture(GL_TEXTURE_CUBE_MAP, m_prefilterMap);
     for (auto i = 0; i < 6; ++i) {
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, resolution / 4, resolution / 4, 0, GL_RGB, GL_FLOAT, nullptr);
     }
@@ -185,6 +364,8 @@ void Skybox::init(const std::string hdr_path, const GLsizei resolution) {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Guess what this is for?? :P
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Only the first maxMipLevels levels are rendered
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, maxMipLevels - 1);
     // Generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
@@ -198,12 +379,14 @@ void Skybox::init(const std::string hdr_path, const GLsizei resolution) {
     prefilterShader.bind();
     prefilterShader.setUniformi("environmentMap", 0);
     prefilterShader.setUniform("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
+    prefilterShader.setUniformf("resolution", static_cast<float>(environmentSize > 0 ? environmentSize : resolution));
+    prefilterShader.setUniformi("sampleCount", static_cast<int>(sampleCount));
+    state.bindTexture(0, GL_TEXTURE_CUBE_MAP, m_envCubemap);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
-    const unsigned int maxMipLevels = 5;
+    state.bindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
     for (unsigned int mipLevel = 0; mipLevel < maxMipLevels; ++mipLevel) {
+        Profiler::GpuZone gpu_zone("Prefilter level");
+
         // Resize framebuffer according to mip-level size.
         const unsigned int mipWidth = (unsigned int)((resolution / 4) * std::pow(0.5f, mipLevel));
         const unsigned int mipHeight = (unsigned int)((resolution / 4) * std::pow(0.5f, mipLevel));
@@ -223,11 +406,32 @@ void Skybox::init(const std::string hdr_path, const GLsizei resolution) {
         }
     }
     prefilterShader.deleteProgram();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &envMapRBO);
+
+    if (sh_projection.valid()) {
+        sh_projection.get();
+    }
+}
 
-    // 4.Generate 2D LUT from BRDF equations
+void Skybox::uploadIrradianceSH() {
+    if (m_irradianceSHBuffer == 0) {
+        glGenBuffers(1, &m_irradianceSHBuffer);
+    }
+    auto& state = GLState::getInstance();
+    state.bindBuffer(GL_UNIFORM_BUFFER, m_irradianceSHBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(m_irradianceSH), m_irradianceSH.data(), GL_STATIC_DRAW);
+    state.bindBufferBase(GL_UNIFORM_BUFFER, IRRADIANCE_SH_BINDING, m_irradianceSHBuffer);
+}
+
+void Skybox::bakeBRDFLUT(const GLsizei resolution, const uint32_t sampleCount) {
+    Profiler::CpuZone cpu_zone("BRDF LUT bake");
+    Profiler::GpuZone gpu_zone("BRDF LUT bake");
+    auto& state = GLState::getInstance();
+
+    // Generate 2D LUT from BRDF equations
     glGenTextures(1, &m_BRDFLUT);
-    glBindTexture(GL_TEXTURE_2D, m_BRDFLUT);
+    state.bindTexture(GL_TEXTURE_2D, m_BRDFLUT);
 
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, resolution, resolution, 0, GL_RG, GL_FLOAT, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -235,10 +439,10 @@ void Skybox::init(const std::string hdr_path, const GLsizei resolution) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // Reconfigure capture framebuffer object and render screen-space quad with BRDF shader
-    glBindFramebuffer(GL_FRAMEBUFFER, m_envMapFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, envMapRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, resolution, resolution);
+    // Render a screen-space quad with the BRDF shader into the LUT
+    GLuint fbo;
+    glGenFramebuffers(1, &fbo);
+    state.bindFramebuffer(GL_FRAMEBUFFER, fbo);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_BRDFLUT, 0);
 
     GLShaderProgram brdfShader{"BRDF Shader", {
@@ -247,23 +451,116 @@ void Skybox::init(const std::string hdr_path, const GLsizei resolution) {
     }};
 
     brdfShader.bind();
+    brdfShader.setUniformi("sampleCount", static_cast<int>(sampleCount));
     glViewport(0, 0, resolution, resolution);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    m_quadVAO.bind();
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // Screen-space quad: position, texture coordinates
+    const float quad_vertices[] = {
+        -1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+        -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+         1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
+         1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+    };
+    GLVertexArray quad_vao;
+    quad_vao.init();
+    quad_vao.bind();
+    quad_vao.attachBuffer(GLVertexArray::buffer_type::ARRAY, sizeof(quad_vertices), GLVertexArray::draw_mode::STATIC, quad_vertices);
+    quad_vao.enableAttribute(0, 3, 5 * sizeof(float), nullptr);
+    quad_vao.enableAttribute(1, 2, 5 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(float)));
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    
+    quad_vao.unbind();
+    quad_vao.destroy();
+
     brdfShader.deleteProgram();
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    state.deleteFramebuffers(1, &fbo);
 }
 
 void Skybox::draw() {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, m_envCubemap);
+    GLState::getInstance().bindTexture(0, GL_TEXTURE_CUBE_MAP, m_envCubemap);
     renderCube();
 }
 
 void Skybox::renderCube() {
-    glBindVertexArray(m_cubeVAO);
+    // The cube stays bound, the bakes draw it several times in a row
+    GLState::getInstance().bindVertexArray(m_cubeVAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    GLStats::getInstance().countDraw();
+}
+
+
+namespace {
+    GLenum textureFormat(const uint32_t channels) {
+        return channels == 2 ? GL_RG : GL_RGB;
+    }
+
+    GLenum textureInternalFormat(const uint32_t channels) {
+        return channels == 2 ? GL_RG16F : GL_RGB16F;
+    }
+}
+
+GLuint Skybox::uploadTexture(const IBLCache::Texture& texture, const bool generateMipmaps) {
+    const GLenum target = texture.type == IBLCache::texture_cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+
+    GLuint id;
+    glGenTextures(1, &id);
+    GLState::getInstance().bindTexture(target, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    const uint16_t* data = texture.data.data();
+    for (uint32_t level = 0; level < texture.levels; ++level) {
+        const auto size = static_cast<GLsizei>(texture.getLevelSize(level));
+        for (uint32_t face = 0; face < texture.getFaceCount(); ++face) {
+            const GLenum face_target = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            glTexImage2D(face_target, level, textureInternalFormat(texture.channels), size, size, 0,
+                         textureFormat(texture.channels), GL_HALF_FLOAT, data);
+            data += texture.getFaceHalfCount(level);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (texture.levels > 1) {
+        // Pre-filtered map, sample exactly the stored levels
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, texture.levels - 1);
+    }
+    else if (generateMipmaps) {
+        // Environment map, rebuild the mip chain the pre-filter pass sampled from
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glGenerateMipmap(target);
+    }
+    else {
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    return id;
+}
+
+IBLCache::Texture Skybox::readTexture(const GLuint id, const IBLCache::texture_type type, const GLsizei size, const uint32_t channels, const uint32_t levels) {
+    IBLCache::Texture texture;
+    texture.type = type;
+    texture.size = static_cast<uint32_t>(size);
+    texture.channels = channels;
+    texture.levels = levels;
+    texture.data.resize(texture.getHalfCount());
+
+    const GLenum target = type == IBLCache::texture_cube ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    GLState::getInstance().bindTexture(target, id);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    uint16_t* data = texture.data.data();
+    for (uint32_t level = 0; level < levels; ++level) {
+        for (uint32_t face = 0; face < texture.getFaceCount(); ++face) {
+            const GLenum face_target = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            glGetTexImage(face_target, level, textureFormat(channels), GL_HALF_FLOAT, data);
+            data += texture.getFaceHalfCount(level);
+        }
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    return texture;
 }
@@ -1,22 +1,54 @@
 #ifndef SKYBOX_H
 #define SKYBOX_H
 
+#include <cstdint>
 #include <string>
 
+#include "IBLCache.h"
+#include "SHIrradiance.h"
 #include "../graphic/GLVertexArray.h"
 
 class Skybox {
     public:
-        void init(const std::string hdr_path, const GLsizei resolution = 512);
+        // Diffuse lighting source: the convolved irradiance cubemap, or L2 spherical harmonics in a
+        // uniform block (shaders/glsl/sh_irradiance.glsl) which skips the convolution pass and its texture
+        enum irradiance_mode { irradiance_cubemap, irradiance_sh };
+
+        static constexpr GLuint IRRADIANCE_SH_BINDING = 4;
+
+        // Loads the IBL maps from the disk cache, or bakes and caches them on a miss.
+        // hdr_path is an equirectangular HDR image, or a KTX2/DDS cubemap (BC6H, see Texture-Converter)
+        // which is used as the environment as is, only the lighting maps are baked from it.
+        void init(const std::string hdr_path, const GLsizei resolution = 512, const uint32_t sampleCount = 1024,
+                  const irradiance_mode irradianceMode = irradiance_cubemap);
         void draw();
 
+        auto getIrradianceMode() const { return m_irradianceMode; }
+        // Only created with irradiance_cubemap
         auto getIrradianceMap() const { return m_irradianceMap; }
+        // Only filled with irradiance_sh, the uniform block is bound to IRRADIANCE_SH_BINDING by init()
+        const auto& getIrradianceSH() const { return m_irradianceSH; }
         auto getPrefilterMap() const { return m_prefilterMap; }
         auto getBRDFLUT() const { return m_BRDFLUT; }
     private:
+        static constexpr uint32_t maxMipLevels = 5;
+
+        // environmentSize is the face size of a cubemap loaded by loadEnvironment(), 0 to convert the HDR image
+        void bakeEnvironment(const std::string& hdr_path, const GLsizei resolution, const uint32_t sampleCount, const GLsizei environmentSize);
+        // Returns the face size, 0 if the file is not a compressed cubemap
+        GLsizei loadEnvironment(const std::string& path);
+        void uploadIrradianceSH();
+        void bakeBRDFLUT(const GLsizei resolution, const uint32_t sampleCount);
+        GLuint uploadTexture(const IBLCache::Texture& texture, const bool generateMipmaps = false);
+        IBLCache::Texture readTexture(const GLuint id, const IBLCache::texture_type type, const GLsizei size, const uint32_t channels, const uint32_t levels);
+
         void renderCube();
-        unsigned int m_cubeVAO, m_envCubemap, m_envMapFBO, m_irradianceMap, m_prefilterMap, m_BRDFLUT;
-        GLVertexArray m_quadVAO;
+        unsigned int m_cubeVAO, m_envCubemap, m_envMapFBO, m_prefilterMap, m_BRDFLUT;
+        unsigned int m_irradianceMap { 0 };
+        unsigned int m_irradianceSHBuffer { 0 };
+
+        irradiance_mode m_irradianceMode { irradiance_cubemap };
+        SHIrradiance::Coefficients m_irradianceSH {};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,926 @@
+#include "glTFImporter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include "json.hpp"
+#include "stb_image.h"
+
+#include "MeshSimplifier.h"
+#include "../utility/CompressedTexture.h"
+#include "../utility/ThreadPool.h"
+
+namespace {
+    double elapsedMilliseconds(const std::chrono::steady_clock::time_point& start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    template<typename T>
+    void copyIndices(const unsigned char* data, size_t stride, size_t count, GLuint* indices) {
+        for (size_t index = 0; index < count; index++) {
+            indices[index] = *reinterpret_cast<const T*>(data + index * stride);
+        }
+    }
+
+    // Whether the first count elements of an accessor, elementSize bytes each, lie inside its buffer view
+    bool accessorInRange(const tinygltf::Model& input, const int accessorIndex, const size_t elementSize, const size_t count) {
+        if (accessorIndex < 0 || static_cast<size_t>(accessorIndex) >= input.accessors.size()) {
+            return false;
+        }
+        const tinygltf::Accessor& accessor = input.accessors[accessorIndex];
+        if (accessor.bufferView < 0 || static_cast<size_t>(accessor.bufferView) >= input.bufferViews.size() || count > accessor.count) {
+            return false;
+        }
+        const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
+        const int stride = accessor.ByteStride(view);
+        if (stride <= 0) {
+            return false;
+        }
+        return count == 0 ? accessor.byteOffset <= view.byteLength
+                          : accessor.byteOffset + (count - 1) * static_cast<size_t>(stride) + elementSize <= view.byteLength;
+    }
+
+    // Only triangle lists are reordered, split, simplified and clustered, other modes keep their index order
+    bool isTriangleList(const glTFSceneData::PrimitiveData& primitive) {
+        return primitive.mode == GL_TRIANGLES && primitive.indexCount % 3 == 0;
+    }
+
+    // glTF requires node matrices to be decomposable into translation, rotation and scale
+    void decomposeMatrix(const glm::mat4& matrix, glTFSceneData::NodeData& node) {
+        node.translation = glm::vec3(matrix[3]);
+        glm::mat3 basis(matrix);
+        node.scale = glm::vec3(glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]));
+        // A mirroring matrix is stored as a negative scale on x
+        if (glm::determinant(basis) < 0.0f) {
+            node.scale.x = -node.scale.x;
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            if (node.scale[axis] != 0.0f) {
+                basis[axis] /= node.scale[axis];
+            }
+        }
+        node.rotation = glm::normalize(glm::quat_cast(basis));
+    }
+
+    bool isExternalFile(const std::string& uri) {
+        return !uri.empty() && uri.compare(0, 5, "data:") != 0;
+    }
+
+    bool isBinaryFile(const std::string& filePath) {
+        if (filePath.size() < 4) {
+            return false;
+        }
+        auto extension = filePath.substr(filePath.size() - 4);
+        for (auto& c : extension) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return extension == ".glb";
+    }
+
+    std::string directoryOf(const std::string& path) {
+        const auto separator = path.find_last_of("/\\");
+        return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+    }
+
+    // GLB layout: https://registry.khronos.org/glTF/specs/2.0/glTF-2.0.html#binary-gltf-layout
+    constexpr uint32_t GLB_MAGIC = 0x46546C67;         // "glTF"
+    constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;    // "JSON"
+    constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;     // "BIN"
+
+    uint32_t readUint32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    // Placeholder payload for buffers and images whose bytes are served from the mapped GLB,
+    // tinygltf rejects empty data URIs
+    const char* PLACEHOLDER_BUFFER_URI = "data:application/octet-stream;base64,AA==";
+    const char* PLACEHOLDER_IMAGE_URI = "data:image/png;base64,AA==";
+
+    // Marks images whose pixels are a KTX2 or DDS container instead of decoded texels
+    const char* COMPRESSED_MIME_TYPE = "image/x-compressed-texture";
+
+    struct ImageLoaderData {
+        const std::vector<int32_t>* binaryImageViews;
+        std::string directory;
+    };
+
+    // A KTX2 or DDS file next to an external image (same name, other extension) replaces it,
+    // Texture-Converter writes them
+    bool loadCompressedImage(tinygltf::Image* image, const std::string& directory) {
+        if (!isExternalFile(image->uri)) {
+            return false;
+        }
+        const auto dot = image->uri.find_last_of('.');
+        const auto separator = image->uri.find_last_of("/\\");
+        const bool has_extension = dot != std::string::npos && (separator == std::string::npos || dot > separator);
+        const auto stem = has_extension ? image->uri.substr(0, dot) : image->uri;
+        for (const char* extension : { ".ktx2", ".dds" }) {
+            std::ifstream file(directory + stem + extension, std::ios::binary | std::ios::ate);
+            if (!file) {
+                continue;
+            }
+
+            std::vector<unsigned char> bytes(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            CompressedTexture texture;
+            if (!texture.parse(bytes.data(), bytes.size())) {
+                std::cerr << "glTF Importer: Ignoring invalid compressed image " << stem << extension << std::endl;
+                continue;
+            }
+            image->uri = stem + extension;
+            image->mimeType = COMPRESSED_MIME_TYPE;
+            image->width = static_cast<int>(texture.getWidth());
+            image->height = static_cast<int>(texture.getHeight());
+            image->component = 0;
+            image->image = std::move(bytes);
+            return true;
+        }
+        return false;
+    }
+
+    // Leaves the placeholder images of a GLB alone, they are decoded from the mapping afterwards
+    bool loadImageData(tinygltf::Image* image, const int image_idx, std::string* err, std::string* warn,
+                       int req_width, int req_height, const unsigned char* bytes, int size, void* user_data) {
+        const auto* loader_data = static_cast<const ImageLoaderData*>(user_data);
+        if (image_idx >= 0 && static_cast<size_t>(image_idx) < loader_data->binaryImageViews->size() &&
+            (*loader_data->binaryImageViews)[image_idx] >= 0) {
+            return true;
+        }
+        if (loadCompressedImage(image, loader_data->directory)) {
+            return true;
+        }
+        return tinygltf::LoadImageData(image, image_idx, err, warn, req_width, req_height, bytes, size, nullptr);
+    }
+}
+
+glTFImporter::glTFImporter(const load_mode mode)
+: m_loadMode(mode) {
+}
+
+bool glTFImporter::importFile(const std::string& filePath, glTFSceneData& scene) {
+    tinygltf::Model gltf_input;
+    tinygltf::TinyGLTF gltf_content;
+    std::string error, warning;
+
+    m_binaryBuffer = -1;
+    m_binaryImageViews.clear();
+
+    ImageLoaderData loader_data{ &m_binaryImageViews, directoryOf(filePath) };
+    gltf_content.SetImageLoader(loadImageData, &loader_data);
+
+    auto stage_start = std::chrono::steady_clock::now();
+    bool file_loaded = isBinaryFile(filePath)
+        ? loadBinaryFile(gltf_input, filePath, error, warning)
+        : gltf_content.LoadASCIIFromFile(&gltf_input, &error, &warning, filePath);
+    file_loaded = file_loaded && resolveBuffers(gltf_input, error);
+    if (file_loaded) {
+        decodeBinaryImages(gltf_input);
+    }
+    m_parseTime = elapsedMilliseconds(stage_start);
+
+    if (!file_loaded) {
+        std::cerr << "Could not open the glTF file: " << filePath << "error: " << error << std::endl;
+        m_binaryFile.close();
+        return false;
+    }
+
+    for (const auto& buffer : gltf_input.buffers) {
+        if (isExternalFile(buffer.uri)) {
+            scene.dependencies.push_back(buffer.uri);
+        }
+    }
+    for (const auto& image : gltf_input.images) {
+        if (isExternalFile(image.uri)) {
+            scene.dependencies.push_back(image.uri);
+        }
+    }
+
+    loadImages(gltf_input, scene);
+    loadMaterials(gltf_input, scene);
+    loadTextures(gltf_input, scene);
+
+    // Build the node hierarchy and lay out every primitive in one shared staging buffer
+    m_sources.clear();
+    const tinygltf::Scene& input_scene = gltf_input.scenes[0];
+    for (size_t i = 0; i < input_scene.nodes.size(); i++) {
+        const tinygltf::Node& node = gltf_input.nodes[input_scene.nodes[i]];
+        loadNode(node, gltf_input, -1, scene);
+    }
+
+    stage_start = std::chrono::steady_clock::now();
+    decodePrimitives(gltf_input, scene);
+    m_decodeTime = elapsedMilliseconds(stage_start);
+
+    stage_start = std::chrono::steady_clock::now();
+    optimizePrimitives(scene);
+    splitPrimitives(scene);
+    generateLods(scene);
+    buildMeshlets(scene);
+    m_optimizeTime = elapsedMilliseconds(stage_start);
+
+    m_binaryFile.close();
+    return true;
+}
+
+bool glTFImporter::loadBinaryFile(tinygltf::Model& input, const std::string& filePath, std::string& error, std::string& warning) {
+    if (!m_binaryFile.open(filePath)) {
+        error = "Could not map file.";
+        return false;
+    }
+
+    const auto* data = m_binaryFile.data();
+    const auto size = m_binaryFile.size();
+    if (size < 20 || readUint32(data) != GLB_MAGIC || readUint32(data + 4) != 2 || readUint32(data + 8) > size) {
+        error = "Invalid GLB header.";
+        return false;
+    }
+    const size_t length = readUint32(data + 8);
+
+    // Chunk 0 is always JSON, an optional BIN chunk follows
+    const size_t json_length = readUint32(data + 12);
+    if (readUint32(data + 16) != GLB_CHUNK_JSON || 20 + json_length > length) {
+        error = "Invalid GLB JSON chunk.";
+        return false;
+    }
+    const auto* json_begin = reinterpret_cast<const char*>(data + 20);
+
+    m_binaryChunk = nullptr;
+    m_binaryChunkSize = 0;
+    const size_t bin_header = (20 + json_length + 3) & ~size_t(3);
+    if (bin_header + 8 <= length && readUint32(data + bin_header + 4) == GLB_CHUNK_BIN) {
+        m_binaryChunkSize = readUint32(data + bin_header);
+        if (bin_header + 8 + m_binaryChunkSize > length) {
+            error = "Invalid GLB BIN chunk.";
+            return false;
+        }
+        m_binaryChunk = data + bin_header + 8;
+    }
+
+    // Point the buffer and images that live in the BIN chunk at tiny placeholders before tinygltf sees
+    // the JSON, so it neither copies the chunk nor decodes images out of it
+    auto json = nlohmann::json::parse(json_begin, json_begin + json_length, nullptr, false);
+    if (json.is_discarded() || !json.is_object()) {
+        error = "Invalid GLB JSON chunk.";
+        return false;
+    }
+
+    if (json.contains("buffers") && json["buffers"].is_array()) {
+        auto& buffers = json["buffers"];
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            if (!buffers[i].contains("uri")) {
+                if (!m_binaryChunk) {
+                    error = "GLB buffer without BIN chunk.";
+                    return false;
+                }
+                m_binaryBuffer = static_cast<int32_t>(i);
+                buffers[i]["uri"] = PLACEHOLDER_BUFFER_URI;
+                buffers[i]["byteLength"] = 1;
+                break;
+            }
+        }
+    }
+
+    if (json.contains("images") && json["images"].is_array()) {
+        auto& images = json["images"];
+        m_binaryImageViews.assign(images.size(), -1);
+        for (size_t i = 0; i < images.size(); ++i) {
+            if (images[i].contains("bufferView") && images[i]["bufferView"].is_number_integer()) {
+                m_binaryImageViews[i] = images[i]["bufferView"].get<int32_t>();
+                images[i].erase("bufferView");
+                images[i].erase("mimeType");
+                images[i]["uri"] = PLACEHOLDER_IMAGE_URI;
+            }
+        }
+    }
+
+    ImageLoaderData loader_data{ &m_binaryImageViews, directoryOf(filePath) };
+    tinygltf::TinyGLTF gltf_content;
+    gltf_content.SetImageLoader(loadImageData, &loader_data);
+
+    const auto json_string = json.dump();
+    if (!gltf_content.LoadASCIIFromString(&input, &error, &warning, json_string.c_str(),
+                                          static_cast<unsigned int>(json_string.size()), directoryOf(filePath))) {
+        return false;
+    }
+
+    // Drop the placeholders again, the data comes from the mapping
+    if (m_binaryBuffer >= 0) {
+        input.buffers[m_binaryBuffer].uri.clear();
+        input.buffers[m_binaryBuffer].data.clear();
+    }
+    for (size_t i = 0; i < m_binaryImageViews.size(); ++i) {
+        if (m_binaryImageViews[i] >= 0) {
+            input.images[i].uri.clear();
+            input.images[i].bufferView = m_binaryImageViews[i];
+        }
+    }
+    return true;
+}
+
+void glTFImporter::decodeBinaryImages(tinygltf::Model& input) {
+    const auto decode = [&](size_t i) {
+        const auto view_index = m_binaryImageViews[i];
+        if (view_index < 0) {
+            return;
+        }
+
+        tinygltf::Image& image = input.images[i];
+        if (static_cast<size_t>(view_index) >= input.bufferViews.size()) {
+            std::cerr << "glTF Importer: Image " << i << " references an invalid buffer view" << std::endl;
+            return;
+        }
+        // Buffer view ranges were validated by resolveBuffers
+        const tinygltf::BufferView& view = input.bufferViews[view_index];
+
+        // Always expand to RGBA, like tinygltf's own loader
+        int width = 0, height = 0, component = 0;
+        unsigned char* pixels = stbi_load_from_memory(m_bufferData[view.buffer] + view.byteOffset, static_cast<int>(view.byteLength), &width, &height, &component, 4);
+        if (!pixels) {
+            std::cerr << "glTF Importer: Failed to decode image " << i << ": " << stbi_failure_reason() << std::endl;
+            return;
+        }
+
+        image.width = width;
+        image.height = height;
+        image.component = 4;
+        image.bits = 8;
+        image.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+        image.image.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+    };
+
+    if (m_loadMode == load_mode::parallel) {
+        ThreadPool::getInstance().parallelFor(0, m_binaryImageViews.size(), decode);
+    } else {
+        for (size_t i = 0; i < m_binaryImageViews.size(); ++i) {
+            decode(i);
+        }
+    }
+}
+
+bool glTFImporter::resolveBuffers(const tinygltf::Model& input, std::string& error) {
+    m_bufferData.resize(input.buffers.size());
+    m_bufferSize.resize(input.buffers.size());
+    for (size_t i = 0; i < input.buffers.size(); ++i) {
+        if (static_cast<int32_t>(i) == m_binaryBuffer) {
+            m_bufferData[i] = m_binaryChunk;
+            m_bufferSize[i] = m_binaryChunkSize;
+        } else {
+            m_bufferData[i] = input.buffers[i].data.data();
+            m_bufferSize[i] = input.buffers[i].data.size();
+        }
+    }
+
+    // Buffer views are read without further checks while decoding, so make sure they are in range now
+    for (const auto& view : input.bufferViews) {
+        if (view.buffer < 0 || static_cast<size_t>(view.buffer) >= m_bufferData.size() ||
+            view.byteOffset + view.byteLength > m_bufferSize[view.buffer]) {
+            error = "Buffer view out of range.";
+            return false;
+        }
+    }
+
+    // So are the accessors decodePrimitives reads, as many elements as it reads from each
+    for (const auto& mesh : input.meshes) {
+        for (const auto& primitive : mesh.primitives) {
+            const auto position = primitive.attributes.find("POSITION");
+            if (position == primitive.attributes.end()) {
+                continue;
+            }
+            if (position->second < 0 || static_cast<size_t>(position->second) >= input.accessors.size()) {
+                error = "Accessor out of range.";
+                return false;
+            }
+            const size_t vertex_count = input.accessors[position->second].count;
+            bool in_range = accessorInRange(input, position->second, sizeof(glm::vec3), vertex_count);
+            const auto normal = primitive.attributes.find("NORMAL");
+            if (normal != primitive.attributes.end()) {
+                in_range = in_range && accessorInRange(input, normal->second, sizeof(glm::vec3), vertex_count);
+            }
+            const auto tex_coord = primitive.attributes.find("TEXCOORD_0");
+            if (tex_coord != primitive.attributes.end()) {
+                in_range = in_range && accessorInRange(input, tex_coord->second, sizeof(glm::vec2), vertex_count);
+            }
+            if (primitive.indices > -1) {
+                // Unsupported index types are skipped by loadNode
+                const bool valid_index = static_cast<size_t>(primitive.indices) < input.accessors.size();
+                const int32_t index_size = valid_index ? tinygltf::GetComponentSizeInBytes(input.accessors[primitive.indices].componentType) : 0;
+                in_range = in_range && valid_index && (index_size <= 0 ||
+                    accessorInRange(input, primitive.indices, static_cast<size_t>(index_size), input.accessors[primitive.indices].count));
+            }
+            if (!in_range) {
+                error = "Accessor out of range.";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+const unsigned char* glTFImporter::accessorData(const tinygltf::Model& input, const tinygltf::Accessor& accessor, size_t& stride) const {
+    const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
+    stride = static_cast<size_t>(accessor.ByteStride(view));
+    return m_bufferData[view.buffer] + accessor.byteOffset + view.byteOffset;
+}
+
+void glTFImporter::loadImages(tinygltf::Model& input, glTFSceneData& scene) {
+    // Images can be stored inside the glTF (which is the case for the sample model), so instead of directly
+    // loading them from disk, we take over the pixels decoded by the glTF loader
+    scene.images.resize(input.images.size());
+    scene.imageStorage.resize(input.images.size());
+    for (size_t i = 0; i < input.images.size(); i++) {
+        tinygltf::Image& glTFImage = input.images[i];
+        // Pixels are kept as decoded, the texture streamer expands them to RGBA on a worker
+        auto& pixels = scene.imageStorage[i];
+        pixels = std::move(glTFImage.image);
+
+        scene.images[i].width = glTFImage.width;
+        scene.images[i].height = glTFImage.height;
+        scene.images[i].component = glTFImage.component;
+        scene.images[i].compressed = glTFImage.mimeType == COMPRESSED_MIME_TYPE;
+        scene.images[i].pixels = pixels.empty() ? nullptr : pixels.data();
+        scene.images[i].size = pixels.size();
+    }
+}
+
+void glTFImporter::loadTextures(const tinygltf::Model& input, glTFSceneData& scene) {
+    scene.textures.resize(input.textures.size());
+    for (size_t i = 0; i < input.textures.size(); ++i) {
+        scene.textures[i] = input.textures[i].source;
+    }
+}
+
+void glTFImporter::loadMaterials(const tinygltf::Model& input, glTFSceneData& scene) {
+    scene.materials.resize(input.materials.size());
+    for (size_t i = 0; i < input.materials.size(); ++i) {
+        const tinygltf::Material& glTFMaterial = input.materials[i];
+        const auto& factor = glTFMaterial.pbrMetallicRoughness.baseColorFactor;
+        scene.materials[i].baseColorFactor = factor.size() == 4
+            ? glm::vec4(static_cast<float>(factor[0]), static_cast<float>(factor[1]), static_cast<float>(factor[2]), static_cast<float>(factor[3]))
+            : glm::vec4(1.0f);
+        scene.materials[i].baseColorTextureIndex = -1;
+        scene.materials[i].alphaMode = glTFMaterial.alphaMode == "BLEND" ? glTFSceneData::alpha_blend
+            : glTFMaterial.alphaMode == "MASK" ? glTFSceneData::alpha_mask : glTFSceneData::alpha_opaque;
+        scene.materials[i].doubleSided = glTFMaterial.doubleSided;
+        // Get base color texture index
+        if (glTFMaterial.values.find("baseColorTexture") != glTFMaterial.values.end()) {
+            scene.materials[i].baseColorTextureIndex = glTFMaterial.values.at("baseColorTexture").TextureIndex();
+        }
+    }
+}
+
+void glTFImporter::loadNode(const tinygltf::Node& input_node, const tinygltf::Model& input, int32_t parent, glTFSceneData& scene) {
+    glTFSceneData::NodeData node{};
+    node.parent = parent;
+    node.translation = glm::vec3(0.0f);
+    node.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    node.scale = glm::vec3(1.0f);
+
+    // Get the local node transform
+    // It's either made up from translation, rotation, scale or a 4x4 matrix
+    if (input_node.matrix.size() == 16) {
+        decomposeMatrix(glm::make_mat4x4(input_node.matrix.data()), node);
+    }
+    else {
+        if (input_node.translation.size() == 3) {
+            node.translation = glm::make_vec3(input_node.translation.data());
+        }
+        if (input_node.rotation.size() == 4) {
+            node.rotation = glm::make_quat(input_node.rotation.data());
+        }
+        if (input_node.scale.size() == 3) {
+            node.scale = glm::make_vec3(input_node.scale.data());
+        }
+    }
+
+    // If the node contains mesh data, reserve a range of the staging buffers for each primitive,
+    // the vertices and indices themselves are decoded later in decodePrimitives
+    node.firstPrimitive = static_cast<uint32_t>(scene.primitives.size());
+    if (input_node.mesh > -1) {
+        const tinygltf::Mesh& mesh = input.meshes[input_node.mesh];
+
+        for (size_t i = 0; i < mesh.primitives.size(); ++i) {
+            const tinygltf::Primitive& glTFPrimitive = mesh.primitives[i];
+
+            const auto position = glTFPrimitive.attributes.find("POSITION");
+            if (position == glTFPrimitive.attributes.end()) {
+                continue;
+            }
+
+            if (glTFPrimitive.indices > -1) {
+                const auto componentType = input.accessors[glTFPrimitive.indices].componentType;
+                if (componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT &&
+                    componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT &&
+                    componentType != TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE) {
+                    std::cerr << "Index component type " << componentType << " not supported!" << std::endl;
+                    continue;
+                }
+            }
+
+            // A missing mode means triangles
+            const int mode = glTFPrimitive.mode < 0 ? TINYGLTF_MODE_TRIANGLES : glTFPrimitive.mode;
+            if (mode > TINYGLTF_MODE_TRIANGLE_FAN) {
+                std::cerr << "Primitive mode " << mode << " not supported!" << std::endl;
+                continue;
+            }
+
+            glTFSceneData::PrimitiveData primitive{};
+            primitive.materialIndex = glTFPrimitive.material;
+            primitive.mode = static_cast<GLenum>(mode);
+            primitive.vertexCount = static_cast<uint32_t>(input.accessors[position->second].count);
+            // Non-indexed primitives get a sequential index list
+            primitive.indexCount = glTFPrimitive.indices > -1 ? static_cast<uint32_t>(input.accessors[glTFPrimitive.indices].count) : primitive.vertexCount;
+            // Bounds are mandatory for POSITION accessors, an empty box makes decodePrimitives compute them
+            const tinygltf::Accessor& position_accessor = input.accessors[position->second];
+            if (position_accessor.minValues.size() == 3 && position_accessor.maxValues.size() == 3) {
+                primitive.boundsMin = glm::vec3(position_accessor.minValues[0], position_accessor.minValues[1], position_accessor.minValues[2]);
+                primitive.boundsMax = glm::vec3(position_accessor.maxValues[0], position_accessor.maxValues[1], position_accessor.maxValues[2]);
+            }
+            else {
+                primitive.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+                primitive.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+            }
+            if (!scene.primitives.empty()) {
+                primitive.firstVertex = scene.primitives.back().firstVertex + scene.primitives.back().vertexCount;
+                primitive.firstIndex = scene.primitives.back().firstIndex + scene.primitives.back().indexCount;
+            }
+            scene.primitives.push_back(primitive);
+            m_sources.push_back(&glTFPrimitive);
+        }
+    }
+    node.primitiveCount = static_cast<uint32_t>(scene.primitives.size()) - node.firstPrimitive;
+
+    const auto node_index = static_cast<int32_t>(scene.nodes.size());
+    scene.nodes.push_back(node);
+
+    // Load node's children
+    for (size_t i = 0; i < input_node.children.size(); i++) {
+        loadNode(input.nodes[input_node.children[i]], input, node_index, scene);
+    }
+}
+
+void glTFImporter::decodePrimitives(const tinygltf::Model& input, glTFSceneData& scene) {
+    if (scene.primitives.empty()) {
+        return;
+    }
+
+    // Allocate the staging buffers once, every primitive writes into its own range
+    scene.vertexStorage.resize(scene.primitives.back().firstVertex + scene.primitives.back().vertexCount);
+    scene.indexStorage.resize(scene.primitives.back().firstIndex + scene.primitives.back().indexCount);
+
+    // Primitives whose indices address vertices they don't have
+    std::vector<uint8_t> invalid_indices(scene.primitives.size(), 0);
+    const auto decode = [&](size_t p) {
+        glTFSceneData::PrimitiveData& primitive = scene.primitives[p];
+        const tinygltf::Primitive& glTFPrimitive = *m_sources[p];
+        const bool compute_bounds = primitive.boundsMin.x > primitive.boundsMax.x;
+
+        // Vertices
+        {
+            const unsigned char* positionBuffer = nullptr;
+            const unsigned char* normalsBuffer = nullptr;
+            const unsigned char* texCoordsBuffer = nullptr;
+            size_t positionStride = 0, normalsStride = 0, texCoordsStride = 0;
+
+            // Get buffer data for vertex positions
+            positionBuffer = accessorData(input, input.accessors[glTFPrimitive.attributes.find("POSITION")->second], positionStride);
+            // Get buffer data for vertex normals
+            if (glTFPrimitive.attributes.find("NORMAL") != glTFPrimitive.attributes.end()) {
+                normalsBuffer = accessorData(input, input.accessors[glTFPrimitive.attributes.find("NORMAL")->second], normalsStride);
+            }
+            // Get buffer data for vertex texture coordinates
+            // glTF supports multiple sets, we only load the first one
+            if (glTFPrimitive.attributes.find("TEXCOORD_0") != glTFPrimitive.attributes.end()) {
+                texCoordsBuffer = accessorData(input, input.accessors[glTFPrimitive.attributes.find("TEXCOORD_0")->second], texCoordsStride);
+            }
+
+            Vertex* vertex = &scene.vertexStorage[primitive.firstVertex];
+            for (size_t v = 0; v < primitive.vertexCount; v++, vertex++) {
+                vertex->Position = glm::make_vec3(reinterpret_cast<const float*>(positionBuffer + v * positionStride));
+                vertex->Normal = normalsBuffer ? glm::normalize(glm::make_vec3(reinterpret_cast<const float*>(normalsBuffer + v * normalsStride))) : glm::vec3(0.0f);
+                vertex->TexCoords = texCoordsBuffer ? glm::make_vec2(reinterpret_cast<const float*>(texCoordsBuffer + v * texCoordsStride)) : glm::vec2(0.0f);
+                if (compute_bounds) {
+                    primitive.boundsMin = glm::min(primitive.boundsMin, vertex->Position);
+                    primitive.boundsMax = glm::max(primitive.boundsMax, vertex->Position);
+                }
+            }
+        }
+
+        // Indices
+        {
+            GLuint* indexBuffer = &scene.indexStorage[primitive.firstIndex];
+
+            if (glTFPrimitive.indices < 0) {
+                for (size_t index = 0; index < primitive.indexCount; index++) {
+                    indexBuffer[index] = static_cast<GLuint>(index);
+                }
+                return;
+            }
+
+            const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.indices];
+            size_t stride = 0;
+            const unsigned char* data = accessorData(input, accessor, stride);
+
+            // glTF supports different component types of indices
+            switch (accessor.componentType) {
+                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
+                    copyIndices<uint32_t>(data, stride, primitive.indexCount, indexBuffer);
+                    break;
+                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
+                    copyIndices<uint16_t>(data, stride, primitive.indexCount, indexBuffer);
+                    break;
+                case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
+                    copyIndices<uint8_t>(data, stride, primitive.indexCount, indexBuffer);
+                    break;
+            }
+
+            // Every later stage indexes per-vertex arrays with them, check them once here
+            for (size_t index = 0; index < primitive.indexCount; index++) {
+                if (indexBuffer[index] >= primitive.vertexCount) {
+                    invalid_indices[p] = 1;
+                    break;
+                }
+            }
+        }
+    };
+
+    if (m_loadMode == load_mode::parallel) {
+        ThreadPool::getInstance().parallelFor(0, scene.primitives.size(), decode);
+    } else {
+        for (size_t p = 0; p < scene.primitives.size(); ++p) {
+            decode(p);
+        }
+    }
+
+    // Such a primitive draws nothing, optimizePrimitives then drops its vertices since no index references them
+    for (size_t p = 0; p < scene.primitives.size(); ++p) {
+        if (invalid_indices[p]) {
+            std::cerr << "glTF Importer: Primitive " << p << " has indices beyond its " << scene.primitives[p].vertexCount
+                      << " vertices, it is skipped" << std::endl;
+            scene.primitives[p].indexCount = 0;
+        }
+    }
+
+    scene.vertices = scene.vertexStorage.data();
+    scene.vertexCount = scene.vertexStorage.size();
+    scene.indices = scene.indexStorage.data();
+    scene.indexCount = scene.indexStorage.size();
+}
+
+void glTFImporter::optimizePrimitives(glTFSceneData& scene) {
+    std::vector<MeshOptimizer::Stats> stats(scene.primitives.size());
+    const auto optimize = [&](size_t p) {
+        auto& primitive = scene.primitives[p];
+        primitive.vertexCount = MeshOptimizer::optimize(&scene.vertexStorage[primitive.firstVertex], primitive.vertexCount,
+                                                        &scene.indexStorage[primitive.firstIndex], primitive.indexCount,
+                                                        isTriangleList(primitive), stats[p]);
+    };
+
+    if (m_loadMode == load_mode::parallel) {
+        ThreadPool::getInstance().parallelFor(0, scene.primitives.size(), optimize);
+    } else {
+        for (size_t p = 0; p < scene.primitives.size(); ++p) {
+            optimize(p);
+        }
+    }
+
+    // Primitives only shrink, moving each one down to the end of the previous one never overwrites what is still to be moved
+    uint32_t first_vertex = 0;
+    scene.meshStats = MeshOptimizer::Stats();
+    for (size_t p = 0; p < scene.primitives.size(); ++p) {
+        auto& primitive = scene.primitives[p];
+        if (primitive.firstVertex != first_vertex) {
+            const auto source = scene.vertexStorage.begin() + primitive.firstVertex;
+            std::copy(source, source + primitive.vertexCount, scene.vertexStorage.begin() + first_vertex);
+            primitive.firstVertex = first_vertex;
+        }
+        first_vertex += primitive.vertexCount;
+        scene.meshStats.add(stats[p]);
+    }
+    scene.vertexStorage.resize(first_vertex);
+
+    scene.vertices = scene.vertexStorage.data();
+    scene.vertexCount = scene.vertexStorage.size();
+}
+
+void glTFImporter::splitPrimitives(glTFSceneData& scene) {
+    // Index count of every part each primitive becomes, a single part for most
+    std::vector<std::vector<size_t>> parts(scene.primitives.size());
+    bool split = false;
+    for (size_t p = 0; p < scene.primitives.size(); ++p) {
+        const auto& primitive = scene.primitives[p];
+        if (primitive.vertexCount <= MeshOptimizer::MAX_SHORT_INDEX_VERTICES || !isTriangleList(primitive)) {
+            parts[p].push_back(primitive.indexCount);
+            continue;
+        }
+
+        parts[p] = MeshOptimizer::splitByVertexCount(&scene.indexStorage[primitive.firstIndex], primitive.indexCount,
+                                                      primitive.vertexCount, MeshOptimizer::MAX_SHORT_INDEX_VERTICES);
+        if (parts[p].size() < 2) {
+            continue;
+        }
+
+        // Every index shrinks by two bytes, the cuts cost a copy of the vertices on both sides
+        size_t part_vertices = 0;
+        std::vector<uint32_t> last_part(primitive.vertexCount, ~0u);
+        size_t index = primitive.firstIndex;
+        for (uint32_t part = 0; part < parts[p].size(); ++part) {
+            for (const size_t end = index + parts[p][part]; index < end; ++index) {
+                auto& last = last_part[scene.indexStorage[index]];
+                if (last != part) {
+                    last = part;
+                    ++part_vertices;
+                }
+            }
+        }
+        const size_t duplicated_bytes = part_vertices > primitive.vertexCount ? (part_vertices - primitive.vertexCount) * sizeof(Vertex) : 0;
+        if (duplicated_bytes >= primitive.indexCount * (sizeof(GLuint) - sizeof(uint16_t))) {
+            parts[p].assign(1, primitive.indexCount);
+            continue;
+        }
+        split = true;
+    }
+    if (!split) {
+        return;
+    }
+
+    std::vector<glTFSceneData::PrimitiveData> primitives;
+    std::vector<Vertex> vertices;
+    vertices.reserve(scene.vertexStorage.size());
+    std::vector<uint32_t> first_part(scene.primitives.size() + 1);
+    std::vector<uint32_t> remap;
+    for (size_t p = 0; p < scene.primitives.size(); ++p) {
+        const auto& primitive = scene.primitives[p];
+        first_part[p] = static_cast<uint32_t>(primitives.size());
+        if (parts[p].size() == 1) {
+            primitives.push_back(primitive);
+            primitives.back().firstVertex = static_cast<uint32_t>(vertices.size());
+            vertices.insert(vertices.end(), scene.vertexStorage.begin() + primitive.firstVertex,
+                            scene.vertexStorage.begin() + primitive.firstVertex + primitive.vertexCount);
+            continue;
+        }
+
+        // Each part gets its own copy of the vertices it references, in the order it first references them
+        const Vertex* source = &scene.vertexStorage[primitive.firstVertex];
+        uint32_t first_index = primitive.firstIndex;
+        for (const size_t index_count : parts[p]) {
+            glTFSceneData::PrimitiveData part = primitive;
+            part.firstVertex = static_cast<uint32_t>(vertices.size());
+            part.firstIndex = first_index;
+            part.indexCount = static_cast<uint32_t>(index_count);
+            part.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+            part.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+            remap.assign(primitive.vertexCount, ~0u);
+            uint32_t vertex_count = 0;
+            for (GLuint* index = &scene.indexStorage[first_index]; index != &scene.indexStorage[first_index] + index_count; ++index) {
+                if (remap[*index] == ~0u) {
+                    remap[*index] = vertex_count++;
+                    vertices.push_back(source[*index]);
+                    part.boundsMin = glm::min(part.boundsMin, source[*index].Position);
+                    part.boundsMax = glm::max(part.boundsMax, source[*index].Position);
+                }
+                *index = remap[*index];
+            }
+            part.vertexCount = vertex_count;
+            primitives.push_back(part);
+            first_index += part.indexCount;
+        }
+    }
+    first_part[scene.primitives.size()] = static_cast<uint32_t>(primitives.size());
+
+    // Primitives are stored in node order, each node's range maps to the parts of its primitives
+    for (auto& node : scene.nodes) {
+        const uint32_t first = first_part[node.firstPrimitive];
+        node.primitiveCount = first_part[node.firstPrimitive + node.primitiveCount] - first;
+        node.firstPrimitive = first;
+    }
+
+    scene.primitives.swap(primitives);
+    scene.vertexStorage.swap(vertices);
+    scene.vertices = scene.vertexStorage.data();
+    scene.vertexCount = scene.vertexStorage.size();
+}
+
+
+void glTFImporter::generateLods(glTFSceneData& scene) {
+    // Every level is simplified from the full primitive so the errors do not compound.
+    // Index lists of each primitive's levels back to back, firstIndex relative to the list.
+    std::vector<std::vector<GLuint>> lod_indices(scene.primitives.size());
+    std::vector<std::vector<glTFSceneData::LodData>> lods(scene.primitives.size());
+    const auto generate = [&](size_t p) {
+        const auto& primitive = scene.primitives[p];
+        if (!isTriangleList(primitive) || primitive.indexCount < 2 * 3 * LOD_MIN_TRIANGLES) {
+            return;
+        }
+
+        // decodePrimitives guarantees every index addresses one of the primitive's vertices
+        const GLuint* indices = &scene.indexStorage[primitive.firstIndex];
+        const Vertex* vertices = &scene.vertexStorage[primitive.firstVertex];
+        const float max_error = LOD_MAX_ERROR * glm::length(primitive.boundsMax - primitive.boundsMin);
+        std::vector<GLuint> simplified(primitive.indexCount);
+        size_t previous_count = primitive.indexCount;
+        float previous_error = 0.0f;
+        for (uint32_t level = 0; level < MAX_LODS; ++level) {
+            const size_t target = static_cast<size_t>(previous_count * LOD_REDUCTION) / 3 * 3;
+            if (target < 3 * LOD_MIN_TRIANGLES) {
+                break;
+            }
+            float error = 0.0f;
+            const size_t count = MeshSimplifier::simplify(simplified.data(), indices, primitive.indexCount, vertices,
+                                                          primitive.vertexCount, target, max_error, error);
+            if (count > previous_count * (1.0f - LOD_MIN_SAVING)) {
+                break;
+            }
+            MeshOptimizer::optimizeVertexCache(simplified.data(), count, primitive.vertexCount);
+
+            // A coarser level never claims to be more accurate than a finer one
+            previous_error = std::max(previous_error, error);
+            lods[p].push_back({ static_cast<uint32_t>(lod_indices[p].size()), static_cast<uint32_t>(count), previous_error });
+            lod_indices[p].insert(lod_indices[p].end(), simplified.begin(), simplified.begin() + count);
+            previous_count = count;
+        }
+    };
+
+    if (m_loadMode == load_mode::parallel) {
+        ThreadPool::getInstance().parallelFor(0, scene.primitives.size(), generate);
+    } else {
+        for (size_t p = 0; p < scene.primitives.size(); ++p) {
+            generate(p);
+        }
+    }
+
+    size_t lod_index_count = 0;
+    for (const auto& indices : lod_indices) {
+        lod_index_count += indices.size();
+    }
+    if (lod_index_count == 0) {
+        return;
+    }
+
+    // Each primitive's levels follow its own indices, so one arena allocation holds all of them
+    std::vector<GLuint> indices;
+    indices.reserve(scene.indexStorage.size() + lod_index_count);
+    scene.lods.clear();
+    for (size_t p = 0; p < scene.primitives.size(); ++p) {
+        auto& primitive = scene.primitives[p];
+        const auto source = scene.indexStorage.begin() + primitive.firstIndex;
+        primitive.firstIndex = static_cast<uint32_t>(indices.size());
+        indices.insert(indices.end(), source, source + primitive.indexCount);
+
+        primitive.firstLod = static_cast<uint32_t>(scene.lods.size());
+        primitive.lodCount = static_cast<uint32_t>(lods[p].size());
+        const auto lod_start = static_cast<uint32_t>(indices.size());
+        for (auto lod : lods[p]) {
+            lod.firstIndex += lod_start;
+            scene.lods.push_back(lod);
+        }
+        indices.insert(indices.end(), lod_indices[p].begin(), lod_indices[p].end());
+    }
+
+    scene.indexStorage.swap(indices);
+    scene.indices = scene.indexStorage.data();
+    scene.indexCount = scene.indexStorage.size();
+}
+
+void glTFImporter::buildMeshlets(glTFSceneData& scene) {
+    std::vector<std::vector<glTFSceneData::MeshletData>> meshlets(scene.primitives.size());
+    const auto build = [&](size_t p) {
+        const auto& primitive = scene.primitives[p];
+        if (primitive.indexCount == 0 || !isTriangleList(primitive)) {
+            return;
+        }
+        // In range for the builder's per-vertex table, see decodePrimitives
+        const GLuint* indices = &scene.indexStorage[primitive.firstIndex];
+        MeshletBuilder::build(indices, primitive.indexCount, &scene.vertexStorage[primitive.firstVertex], primitive.vertexCount, meshlets[p]);
+    };
+
+    if (m_loadMode == load_mode::parallel) {
+        ThreadPool::getInstance().parallelFor(0, scene.primitives.size(), build);
+    } else {
+        for (size_t p = 0; p < scene.primitives.size(); ++p) {
+            build(p);
+        }
+    }
+
+    scene.meshlets.clear();
+    for (size_t p = 0; p < scene.primitives.size(); ++p) {
+        auto& primitive = scene.primitives[p];
+        primitive.firstMeshlet = static_cast<uint32_t>(scene.meshlets.size());
+        primitive.meshletCount = static_cast<uint32_t>(meshlets[p].size());
+        for (auto meshlet : meshlets[p]) {
+            meshlet.firstIndex += primitive.firstIndex;
+            scene.meshlets.push_back(meshlet);
+        }
+    }
+}
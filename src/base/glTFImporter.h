@@ -0,0 +1,78 @@
+#ifndef GLTF_IMPORTER_H
+#define GLTF_IMPORTER_H
+
+#include "tiny_gltf.h"
+
+#include <string>
+#include <vector>
+
+#include "glTFSceneData.h"
+
+// Parses a glTF file and decodes it into a glTFSceneData without touching the GL context,
+// so it can run on any thread and in offline tools.
+// Binary glTF (.glb) files are memory-mapped: buffer views and embedded images are read straight
+// from the mapping, the BIN chunk is never copied into tinygltf::Buffer::data.
+class glTFImporter {
+    public:
+        enum load_mode { serial, parallel };
+
+        // Levels of detail besides the full primitive, each aiming for LOD_REDUCTION of the previous
+        // one's indices. A level stops the chain when it cannot get there within LOD_MAX_ERROR of the
+        // bounds diagonal, saves less than LOD_MIN_SAVING, or would have fewer than LOD_MIN_TRIANGLES.
+        static constexpr uint32_t MAX_LODS = 4;
+        static constexpr float LOD_REDUCTION = 0.5f;
+        static constexpr float LOD_MAX_ERROR = 0.05f;
+        static constexpr float LOD_MIN_SAVING = 0.1f;
+        static constexpr uint32_t LOD_MIN_TRIANGLES = 32;
+
+        explicit glTFImporter(const load_mode mode = load_mode::parallel);
+
+        bool importFile(const std::string& filePath, glTFSceneData& scene);
+
+        double getParseTime() const { return m_parseTime; }
+        double getDecodeTime() const { return m_decodeTime; }
+        double getOptimizeTime() const { return m_optimizeTime; }
+
+    private:
+        bool loadBinaryFile(tinygltf::Model& input, const std::string& filePath, std::string& error, std::string& warning);
+        void decodeBinaryImages(tinygltf::Model& input);
+        bool resolveBuffers(const tinygltf::Model& input, std::string& error);
+        const unsigned char* accessorData(const tinygltf::Model& input, const tinygltf::Accessor& accessor, size_t& stride) const;
+
+        void loadImages(tinygltf::Model& input, glTFSceneData& scene);
+        void loadTextures(const tinygltf::Model& input, glTFSceneData& scene);
+        void loadMaterials(const tinygltf::Model& input, glTFSceneData& scene);
+        void loadNode(const tinygltf::Node& input_node, const tinygltf::Model& input, int32_t parent, glTFSceneData& scene);
+        void decodePrimitives(const tinygltf::Model& input, glTFSceneData& scene);
+        // Runs MeshOptimizer on every primitive and closes the gaps its removed vertices leave
+        void optimizePrimitives(glTFSceneData& scene);
+        // Replaces primitives with more vertices than 16-bit indices address by several smaller ones,
+        // where the index bytes saved outweigh the vertices duplicated along the cuts
+        void splitPrimitives(glTFSceneData& scene);
+        // Appends up to MAX_LODS simplified index lists to every triangle list primitive
+        void generateLods(glTFSceneData& scene);
+        // Clusters the full level of every triangle list primitive into meshlets for culling
+        void buildMeshlets(glTFSceneData& scene);
+
+        load_mode m_loadMode;
+        // Source primitive of every entry in glTFSceneData::primitives
+        std::vector<const tinygltf::Primitive*> m_sources;
+
+        // Start and size of every glTF buffer, either tinygltf's copy or a range of the mapped GLB
+        std::vector<const unsigned char*> m_bufferData;
+        std::vector<size_t> m_bufferSize;
+
+        // Mapped GLB file, only open while a binary file is imported
+        MappedFile m_binaryFile;
+        const unsigned char* m_binaryChunk { nullptr };
+        size_t m_binaryChunkSize { 0 };
+        int32_t m_binaryBuffer { -1 };
+        // Images embedded through a buffer view of the BIN chunk, decoded from the mapping
+        std::vector<int32_t> m_binaryImageViews;
+
+        double m_parseTime { 0.0 };
+        double m_decodeTime { 0.0 };
+        double m_optimizeTime { 0.0 };
+};
+
+#endif
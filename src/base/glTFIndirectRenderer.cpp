@@ -0,0 +1,297 @@
+#include "glTFIndirectRenderer.h"
+
+#include <algorithm>
+
+#include "../graphic/GLExtensions.h"
+#include "../graphic/GLMeshArena.h"
+#include "../graphic/GLState.h"
+#include "../graphic/GLStats.h"
+
+namespace {
+    // Shader storage bindings of mesh_indirect.vert
+    constexpr GLuint TRANSFORM_BINDING = 1;
+    constexpr GLuint MATERIAL_ID_BINDING = 2;
+    constexpr GLuint MATERIAL_BINDING = 3;
+    constexpr GLuint QUANTIZATION_BINDING = 4;
+
+    GLuint createBuffer(const GLenum target, const size_t size, const void* data, const GLenum usage) {
+        GLuint buffer;
+        glGenBuffers(1, &buffer);
+        GLState::getInstance().bindBuffer(target, buffer);
+        glBufferData(target, size, data, usage);
+        return buffer;
+    }
+}
+
+bool glTFIndirectRenderer::isSupported() {
+    return GLExtensions::getInstance().supportsMultiDrawIndirect();
+}
+
+void glTFIndirectRenderer::build(const glTFModel& model) {
+    destroy();
+
+    m_nodeDraws.resize(model.m_meshes.size());
+    for (uint32_t node = 0; node < model.m_meshes.size(); ++node) {
+        collectDraws(model, node);
+    }
+
+    // Group the draws by texture, index type and mode; the stable sort keeps the node order inside a group
+    std::vector<uint32_t> order(m_commands.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](const uint32_t a, const uint32_t b) {
+        if (m_drawTextures[a] != m_drawTextures[b]) {
+            return m_drawTextures[a] < m_drawTextures[b];
+        }
+        if (m_drawIndexTypes[a] != m_drawIndexTypes[b]) {
+            return m_drawIndexTypes[a] < m_drawIndexTypes[b];
+        }
+        return m_drawModes[a] < m_drawModes[b];
+    });
+
+    std::vector<DrawElementsIndirectCommand> commands(m_commands.size());
+    std::vector<glm::mat4> transforms(m_commands.size());
+    std::vector<GLuint> material_ids(m_commands.size());
+    std::vector<GLuint> draw_textures(m_commands.size());
+    std::vector<GLenum> draw_index_types(m_commands.size());
+    std::vector<GLenum> draw_modes(m_commands.size());
+    std::vector<uint32_t> draw_primitives(m_commands.size());
+    std::vector<uint32_t> draw_index(m_commands.size());
+    // Offset and scale of every draw, they never change
+    std::vector<glm::vec4> quantizations(m_commands.size() * 2);
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        commands[i] = m_commands[order[i]];
+        // baseInstance selects the draw id attribute, which indexes the storage buffers
+        commands[i].baseInstance = i;
+        transforms[i] = m_transforms[order[i]];
+        material_ids[i] = m_materialIds[order[i]];
+        draw_textures[i] = m_drawTextures[order[i]];
+        draw_index_types[i] = m_drawIndexTypes[order[i]];
+        draw_modes[i] = m_drawModes[order[i]];
+        draw_primitives[i] = m_drawPrimitives[order[i]];
+        quantizations[i * 2] = glm::vec4(m_quantizations[order[i]].offset, 0.0f);
+        quantizations[i * 2 + 1] = glm::vec4(m_quantizations[order[i]].scale, 0.0f);
+        draw_index[order[i]] = i;
+
+        if (m_batches.empty() || m_batches.back().texture != draw_textures[i] || m_batches.back().indexType != draw_index_types[i] ||
+            m_batches.back().mode != draw_modes[i]) {
+            m_batches.push_back({ draw_textures[i], draw_index_types[i], draw_modes[i], i, 0 });
+        }
+        ++m_batches.back().drawCount;
+    }
+    m_commands.swap(commands);
+    m_transforms.swap(transforms);
+    m_materialIds.swap(material_ids);
+    m_drawTextures.swap(draw_textures);
+    m_drawIndexTypes.swap(draw_index_types);
+    m_drawModes.clear();
+    m_drawPrimitives.swap(draw_primitives);
+    m_quantizations.clear();
+    m_visibleCommands = m_commands;
+    m_visibleBatches = m_batches;
+    for (auto& node_draws : m_nodeDraws) {
+        for (auto& draw : node_draws) {
+            draw = draw_index[draw];
+        }
+    }
+
+    // Base color factors, with a white default for primitives without a valid material
+    std::vector<glm::vec4> base_color_factors;
+    base_color_factors.reserve(model.materials.size() + 1);
+    for (const auto& material : model.materials) {
+        base_color_factors.push_back(material.baseColorFactor);
+    }
+    base_color_factors.push_back(glm::vec4(1.0f));
+
+    GLMeshArena::getInstance().reserveDrawIds(m_commands.size());
+
+    m_indirectBuffer = createBuffer(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data(), GL_DYNAMIC_DRAW);
+    m_indirectCapacity = m_commands.size();
+    m_transformBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, m_transforms.size() * sizeof(glm::mat4), m_transforms.data(), GL_DYNAMIC_DRAW);
+    m_materialIdBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, m_materialIds.size() * sizeof(GLuint), m_materialIds.data(), GL_STATIC_DRAW);
+    m_materialBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, base_color_factors.size() * sizeof(glm::vec4), base_color_factors.data(), GL_STATIC_DRAW);
+    m_quantizationBuffer = createBuffer(GL_SHADER_STORAGE_BUFFER, quantizations.size() * sizeof(glm::vec4), quantizations.data(), GL_STATIC_DRAW);
+}
+
+void glTFIndirectRenderer::collectDraws(const glTFModel& model, const uint32_t node) {
+    const auto& mesh = model.m_meshes[node];
+    for (uint32_t i = 0; i < mesh.primitives.size(); ++i) {
+        const auto& primitive = mesh.primitives[i];
+        if (primitive.m_indexCount == 0) {
+            continue;
+        }
+
+        // Blended primitives need sorting and blend state, glTFModel::draw handles them
+        const auto& material = model.getMaterial(primitive.m_materialIndex);
+        if (material.alphaMode == glTFSceneData::alpha_blend) {
+            m_hasTransparentDraws = true;
+            continue;
+        }
+
+        // Same texture lookup as glTFModel::draw
+        GLuint material_id = static_cast<GLuint>(model.materials.size());
+        if (primitive.m_materialIndex >= 0 && static_cast<size_t>(primitive.m_materialIndex) < model.materials.size()) {
+            material_id = static_cast<GLuint>(primitive.m_materialIndex);
+        }
+        const GLuint texture = model.getDrawTexture(material);
+
+        const auto& allocation = primitive.m_allocation;
+        m_nodeDraws[node].push_back(static_cast<uint32_t>(m_commands.size()));
+        m_commands.push_back({ primitive.m_indexCount, 1, allocation.firstIndex, static_cast<GLint>(allocation.baseVertex), 0 });
+        m_transforms.push_back(model.m_sceneGraph.getWorldMatrix(node));
+        m_materialIds.push_back(material_id);
+        m_drawTextures.push_back(texture);
+        m_drawIndexTypes.push_back(allocation.indexType);
+        m_drawModes.push_back(primitive.m_mode);
+        m_drawPrimitives.push_back(mesh.firstPrimitive + i);
+        m_quantizations.push_back(primitive.m_quantization);
+    }
+}
+
+void glTFIndirectRenderer::updateTransforms(glTFModel& model) {
+    model.updateTransforms();
+
+    const auto& scene_graph = model.m_sceneGraph;
+    for (const auto node : model.getMovedNodes()) {
+        if (node >= m_nodeDraws.size()) {
+            continue;
+        }
+        for (const auto draw : m_nodeDraws[node]) {
+            m_transforms[draw] = scene_graph.getWorldMatrix(node);
+            if (m_dirtyBegin == m_dirtyEnd) {
+                m_dirtyBegin = draw;
+                m_dirtyEnd = draw + 1;
+            }
+            else {
+                m_dirtyBegin = std::min(m_dirtyBegin, draw);
+                m_dirtyEnd = std::max(m_dirtyEnd, draw + 1);
+            }
+        }
+    }
+    model.clearMovedNodes();
+}
+
+void glTFIndirectRenderer::updateVisibility(const glTFModel& model) {
+    // The command buffer only changes with the visible primitives, their levels or their meshlets
+    if (m_visibilityCurrent && model.getDrawSetVersion() == m_drawSetVersion) {
+        return;
+    }
+    m_drawSetVersion = model.getDrawSetVersion();
+    m_visibilityCurrent = true;
+
+    const auto& visible = model.getVisibility();
+    const auto& meshlet_visible = model.getMeshletVisibility();
+    m_visibleCommands.clear();
+    m_visibleBatches.clear();
+    for (const auto& batch : m_batches) {
+        const auto first = static_cast<uint32_t>(m_visibleCommands.size());
+        for (uint32_t draw = batch.firstDraw; draw < batch.firstDraw + batch.drawCount; ++draw) {
+            if (!visible[m_drawPrimitives[draw]]) {
+                continue;
+            }
+            // baseInstance still points at the draw's transform and material id
+            const auto& primitive = model.getPrimitive(m_drawPrimitives[draw]);
+            if (primitive.m_lod == 0 && primitive.m_meshletCount > 0) {
+                // One command per run of consecutive visible meshlets, they cover the full level in order
+                const uint32_t end = primitive.m_firstMeshlet + primitive.m_meshletCount;
+                for (uint32_t m = primitive.m_firstMeshlet; m < end; ++m) {
+                    if (!meshlet_visible[m]) {
+                        continue;
+                    }
+                    auto command = m_commands[draw];
+                    command.firstIndex += model.m_meshlets[m].firstIndex;
+                    command.count = 0;
+                    for (; m < end && meshlet_visible[m]; ++m) {
+                        command.count += model.m_meshlets[m].indexCount;
+                    }
+                    m_visibleCommands.push_back(command);
+                }
+                continue;
+            }
+            auto command = m_commands[draw];
+            const auto& lod = primitive.getLod();
+            command.firstIndex += lod.firstIndex;
+            command.count = lod.indexCount;
+            m_visibleCommands.push_back(command);
+        }
+        const auto count = static_cast<uint32_t>(m_visibleCommands.size()) - first;
+        if (count > 0) {
+            m_visibleBatches.push_back({ batch.texture, batch.indexType, batch.mode, first, count });
+        }
+    }
+
+    if (!m_visibleCommands.empty()) {
+        GLState::getInstance().bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        // Meshlet culling can split a draw into several commands
+        if (m_visibleCommands.size() > m_indirectCapacity) {
+            m_indirectCapacity = std::max(m_visibleCommands.size(), m_indirectCapacity * 2);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, m_indirectCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+        }
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_visibleCommands.size() * sizeof(DrawElementsIndirectCommand), m_visibleCommands.data());
+    }
+}
+
+void glTFIndirectRenderer::uploadTransforms() {
+    if (m_dirtyBegin == m_dirtyEnd) {
+        return;
+    }
+
+    GLState::getInstance().bindBuffer(GL_SHADER_STORAGE_BUFFER, m_transformBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, m_dirtyBegin * sizeof(glm::mat4), (m_dirtyEnd - m_dirtyBegin) * sizeof(glm::mat4), &m_transforms[m_dirtyBegin]);
+    m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+void glTFIndirectRenderer::draw() {
+    if (m_visibleCommands.empty()) {
+        return;
+    }
+
+    uploadTransforms();
+
+    // Everything stays bound, the next frame skips the binds
+    auto& state = GLState::getInstance();
+    GLMeshArena::getInstance().bind();
+    state.bindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, TRANSFORM_BINDING, m_transformBuffer);
+    state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_ID_BINDING, m_materialIdBuffer);
+    state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDING, m_materialBuffer);
+    state.bindBufferBase(GL_SHADER_STORAGE_BUFFER, QUANTIZATION_BINDING, m_quantizationBuffer);
+
+    auto& stats = GLStats::getInstance();
+    const auto multi_draw = GLExtensions::getInstance().multiDrawElementsIndirect;
+    for (const auto& batch : m_visibleBatches) {
+        state.bindTexture(0, GL_TEXTURE_2D, batch.texture);
+        multi_draw(
+            batch.mode,
+            batch.indexType,
+            reinterpret_cast<void*>(static_cast<uintptr_t>(batch.firstDraw) * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLsizei>(batch.drawCount),
+            0
+        );
+        stats.countDraw(batch.drawCount);
+    }
+}
+
+void glTFIndirectRenderer::destroy() {
+    const GLuint buffers[] = { m_indirectBuffer, m_transformBuffer, m_materialIdBuffer, m_materialBuffer, m_quantizationBuffer };
+    GLState::getInstance().deleteBuffers(5, buffers);
+    m_indirectBuffer = m_transformBuffer = m_materialIdBuffer = m_materialBuffer = m_quantizationBuffer = 0;
+    m_indirectCapacity = 0;
+
+    m_commands.clear();
+    m_transforms.clear();
+    m_materialIds.clear();
+    m_drawTextures.clear();
+    m_drawIndexTypes.clear();
+    m_drawModes.clear();
+    m_batches.clear();
+    m_drawPrimitives.clear();
+    m_quantizations.clear();
+    m_visibleCommands.clear();
+    m_visibleBatches.clear();
+    m_nodeDraws.clear();
+    m_dirtyBegin = m_dirtyEnd = 0;
+    m_hasTransparentDraws = false;
+    m_visibilityCurrent = false;
+}
@@ -0,0 +1,98 @@
+#ifndef GLTF_INDIRECT_RENDERER_H
+#define GLTF_INDIRECT_RENDERER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "glTFModel.h"
+#include "../graphic/GLShaderProgram.h"
+
+// Draws a glTFModel with glMultiDrawElementsIndirect instead of walking its node tree.
+// The primitives are flattened once into indirect commands plus per-draw transform, material id and
+// position quantization storage buffers; afterwards a frame only re-uploads the transforms of nodes
+// whose world matrix changed.
+// Draws are grouped by base color texture, index type and primitive mode, so a pass is one multi-draw per
+// distinct combination (a multi-draw reads every command's indices with one type and one mode); culled
+// draws are compacted out of the command buffer before it is drawn. A full detail primitive whose
+// meshlets the model culled becomes one command per run of visible meshlets. The command buffer is only
+// rebuilt when the model's draw set changes. Blended primitives are left to glTFModel::draw with transparentOnly.
+// Needs GL 4.3 (see GLExtensions::supportsMultiDrawIndirect) and the mesh_indirect.vert shader.
+class glTFIndirectRenderer {
+    public:
+        // Layout mandated by GL_DRAW_INDIRECT_BUFFER
+        struct DrawElementsIndirectCommand {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLint baseVertex;
+            GLuint baseInstance;
+        };
+
+        static bool isSupported();
+
+        void build(const glTFModel& model);
+        // Call after moving nodes of the model's scene graph, the new transforms are uploaded by the next draw().
+        // Picks up every node moved since its last call, also those the model's cull() or draw() already updated.
+        void updateTransforms(glTFModel& model);
+        // Keeps only the draws of primitives the model's last cull() left visible, at their selected level of
+        // detail, and at full detail only the meshlets its last cullMeshlets() left visible
+        void updateVisibility(const glTFModel& model);
+        void draw();
+        void destroy();
+
+        size_t getDrawCount() const { return m_commands.size(); }
+        size_t getBatchCount() const { return m_batches.size(); }
+        // Whether the model has blended primitives, which draw() skips
+        bool hasTransparentDraws() const { return m_hasTransparentDraws; }
+
+    private:
+        // Consecutive commands sharing a base color texture, an index type and a primitive mode
+        struct Batch {
+            GLuint texture;
+            GLenum indexType;
+            GLenum mode;
+            uint32_t firstDraw;
+            uint32_t drawCount;
+        };
+
+        void collectDraws(const glTFModel& model, const uint32_t node);
+        void uploadTransforms();
+
+        std::vector<DrawElementsIndirectCommand> m_commands;
+        // Model primitive of every draw, for the visibility lookup
+        std::vector<uint32_t> m_drawPrimitives;
+        std::vector<glm::mat4> m_transforms;
+        std::vector<GLuint> m_materialIds;
+        std::vector<GLuint> m_drawTextures;
+        std::vector<GLenum> m_drawIndexTypes;
+        std::vector<GLenum> m_drawModes;       // Only needed until build() sorts the batches
+        // Only needed until build() uploads them
+        std::vector<GLVertexLayout::Quantization> m_quantizations;
+        std::vector<Batch> m_batches;
+        // Visible commands as uploaded to the indirect buffer, and their batches
+        std::vector<DrawElementsIndirectCommand> m_visibleCommands;
+        std::vector<Batch> m_visibleBatches;
+        // Draws of every node, indexed like the scene graph, to find the transforms touched by updateTransforms()
+        std::vector<std::vector<uint32_t>> m_nodeDraws;
+
+        // Range of m_transforms not yet uploaded
+        uint32_t m_dirtyBegin { 0 };
+        uint32_t m_dirtyEnd { 0 };
+
+        // Model draw set the visible commands were built from
+        uint64_t m_drawSetVersion { 0 };
+        bool m_visibilityCurrent { false };
+        bool m_hasTransparentDraws { false };
+
+        GLuint m_indirectBuffer { 0 };
+        size_t m_indirectCapacity { 0 };   // In commands
+        GLuint m_transformBuffer { 0 };
+        GLuint m_materialIdBuffer { 0 };
+        GLuint m_materialBuffer { 0 };
+        GLuint m_quantizationBuffer { 0 };
+};
+
+#endif
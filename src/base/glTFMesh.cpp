@@ -1,31 +1,63 @@
 #include "glTFMesh.h"
 
+#include "../graphic/GLStats.h"
+
 glTFMesh::glTFMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, int32_t materialIndex)
-: m_materialIndex(materialIndex), m_indexCount(static_cast<uint32_t>(indices.size())) {
-    setupMesh(vertices, indices);
+: glTFMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), materialIndex) {
+}
+
+glTFMesh::glTFMesh(const Vertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount, int32_t materialIndex)
+: m_materialIndex(materialIndex), m_indexCount(0) {
+    setupMesh(vertices, vertexCount, indices, indexCount);
 }
 
-void glTFMesh::setupMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices) {
-    m_VAO.init();
-    m_VAO.bind();
-    // Attach VBO
-    m_VAO.attachBuffer(GLVertexArray::buffer_type::ARRAY, vertices.size() * sizeof(Vertex), GLVertexArray::draw_mode::STATIC, &vertices[0]);
-    // Attach EBO
-    m_VAO.attachBuffer(GLVertexArray::buffer_type::ELEMENT, indices.size() * sizeof(GLuint), GLVertexArray::draw_mode::STATIC, &indices[0]);
+void glTFMesh::setupMesh(const Vertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount) {
+    auto& arena = GLMeshArena::getInstance();
+    m_quantization = GLVertexLayout::Quantization();
+    if (arena.getVertexLayout().quantizedPosition && vertexCount > 0) {
+        // Box of the vertices themselves, accessor bounds may be slightly off
+        glm::vec3 min = vertices[0].Position, max = vertices[0].Position;
+        for (size_t v = 1; v < vertexCount; ++v) {
+            min = glm::min(min, vertices[v].Position);
+            max = glm::max(max, vertices[v].Position);
+        }
+        m_quantization.offset = min;
+        m_quantization.scale = max - min;
+    }
+    arena.allocate(vertices, vertexCount, indices, indexCount, m_quantization, m_allocation);
+    m_indexCount = m_allocation.indexCount;
+    m_lods.assign(1, { 0, m_indexCount, 0.0f });
+    m_lod = 0;
+}
 
-    // Vertex Attributes
-    const static auto vertex_size = sizeof(Vertex);
-    // Position
-    m_VAO.enableAttribute(0, 3, vertex_size, nullptr);
-    // Normal
-    m_VAO.enableAttribute(1, 3, vertex_size, reinterpret_cast<void*>(offsetof(Vertex, Normal)));
-    // Texture Coord 0
-    m_VAO.enableAttribute(2, 2, vertex_size, reinterpret_cast<void*>(offsetof(Vertex, TexCoords)));
+void glTFMesh::setLods(const glTFSceneData& scene, const glTFSceneData::PrimitiveData& primitive) {
+    if (!m_allocation.isValid()) {
+        return;
+    }
+    m_indexCount = primitive.indexCount;
+    m_lods.assign(1, { 0, m_indexCount, 0.0f });
+    for (uint32_t l = primitive.firstLod; l < primitive.firstLod + primitive.lodCount; ++l) {
+        const auto& lod = scene.lods[l];
+        m_lods.push_back({ lod.firstIndex - primitive.firstIndex, lod.indexCount, lod.error });
+    }
+    m_lod = 0;
 }
 
-void glTFMesh::draw() {
-    m_VAO.bind();
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indexCount), GL_UNSIGNED_INT, nullptr);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    m_VAO.unbind();
-}
\ No newline at end of file
+void glTFMesh::release() {
+    GLMeshArena::getInstance().free(m_allocation);
+    m_indexCount = 0;
+    m_lods.assign(1, { 0, 0, 0.0f });
+    m_lod = 0;
+}
+
+void glTFMesh::draw() const {
+    const auto& lod = m_lods[m_lod];
+    glDrawElementsBaseVertex(
+        m_mode,
+        static_cast<GLsizei>(lod.indexCount),
+        m_allocation.indexType,
+        m_allocation.getIndexOffset(lod.firstIndex),
+        static_cast<GLint>(m_allocation.baseVertex)
+    );
+    GLStats::getInstance().countDraw();
+}
@@ -2,22 +2,50 @@
 #define GLTF_MESH_H
 
 #include "Vertex.h"
-#include "../graphic/GLVertexArray.h"
+#include "glTFSceneData.h"
+#include "../graphic/GLMeshArena.h"
 #include "../graphic/GLShaderProgram.h"
 
 #include <vector>
 
+// A primitive is a range of the shared mesh arena, draw() expects the arena to be bound.
+// Its levels of detail are index ranges of the same allocation; draw() uses the one in m_lod.
 class glTFMesh {
     public:
+        struct Lod {
+            uint32_t firstIndex;    // Relative to the allocation's first index
+            uint32_t indexCount;
+            float error;            // Local space distance to the full primitive
+        };
+
         glTFMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices, int32_t materialIndex);
+        glTFMesh(const Vertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount, int32_t materialIndex);
 
-        void setupMesh(const std::vector<Vertex>& vertices, const std::vector<GLuint>& indices);
+        void setupMesh(const Vertex* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount);
+        void release();
+        // The allocation holds the primitive's indices followed by those of its levels in the scene
+        void setLods(const glTFSceneData& scene, const glTFSceneData::PrimitiveData& primitive);
 
-        void draw();
+        const Lod& getLod() const { return m_lods[m_lod]; }
+        void draw() const;
 
         int32_t m_materialIndex;
-        uint32_t m_indexCount;
-        GLVertexArray m_VAO;
+        GLenum m_mode { GL_TRIANGLES };
+        uint32_t m_indexCount;      // Of the full primitive
+        GLMeshArena::Allocation m_allocation;
+        // Full primitive first, then coarser and coarser levels
+        std::vector<Lod> m_lods;
+        uint32_t m_lod { 0 };
+        // Range of the model's meshlets clustering the full level, empty for non-triangle primitives
+        uint32_t m_firstMeshlet { 0 };
+        uint32_t m_meshletCount { 0 };
+        // Local space bounding box
+        glm::vec3 m_boundsMin { 0.0f };
+        glm::vec3 m_boundsMax { 0.0f };
+        // Local space length spanned by one unit of texture coordinates, 0 without texture coordinates
+        float m_uvScale { 0.0f };
+        // Maps the arena's vertex positions back to local space, identity unless its layout quantizes them
+        GLVertexLayout::Quantization m_quantization;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -2,250 +2,551 @@
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
+#include "../utility/CompressedTexture.h"
 #include "../utility/ResourceManager.h"
 #include "../base/Vertex.h"
+#include "MeshCache.h"
+#include "../graphic/GLState.h"
+#include "../graphic/GLTextureStreamer.h"
+#include "../utility/Profiler.h"
+#include "../utility/ThreadPool.h"
 
-glTFModel::glTFModel(const std::string filePath) {
+#ifndef GL_TEXTURE_SRGB_DECODE_EXT
+#define GL_TEXTURE_SRGB_DECODE_EXT 0x8A48
+#define GL_SKIP_DECODE_EXT 0x8A4A
+#endif
+
+glTFModel::glTFModel(const std::string filePath, const glTFImporter::load_mode mode, const bool useCache)
+: m_loadMode(mode), m_useCache(useCache) {
     loadglTFFile(filePath);
 }
 
+glTFModel::~glTFModel() {
+    for (auto& mesh : m_meshes) {
+        for (auto& primitive : mesh.primitives) {
+            primitive.release();
+        }
+    }
+}
+
+namespace {
+    double elapsedMilliseconds(const std::chrono::steady_clock::time_point& start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Square root of the ratio of surface area to texture coordinate area over the primitive's triangles
+    float uvScale(const Vertex* vertices, const GLuint* indices, const size_t indexCount) {
+        double area = 0.0;
+        double uv_area = 0.0;
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            const Vertex& a = vertices[indices[i]];
+            const Vertex& b = vertices[indices[i + 1]];
+            const Vertex& c = vertices[indices[i + 2]];
+            area += glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position));
+            const glm::vec2 uv1 = b.TexCoords - a.TexCoords;
+            const glm::vec2 uv2 = c.TexCoords - a.TexCoords;
+            uv_area += std::abs(uv1.x * uv2.y - uv1.y * uv2.x);
+        }
+        return uv_area > 0.0 ? static_cast<float>(std::sqrt(area / uv_area)) : 0.0f;
+    }
+
+    // The primitive's indices and those of its levels of detail right after them
+    size_t uploadIndexCount(const glTFSceneData& scene, const glTFSceneData::PrimitiveData& primitive) {
+        if (primitive.lodCount == 0) {
+            return primitive.indexCount;
+        }
+        const auto& last = scene.lods[primitive.firstLod + primitive.lodCount - 1];
+        return last.firstIndex + last.indexCount - primitive.firstIndex;
+    }
+}
+
 void glTFModel::loadglTFFile(const std::string filePath) {
+    Profiler::CpuZone zone("Model load");
+
     std::string new_path = ResourceManager::getInstance().getAssetsPath() + filePath;
+    const std::string cache_path = MeshCache::getCachePath(new_path);
 
-    tinygltf::Model gltf_input;
-    tinygltf::TinyGLTF gltf_content;
-    std::string error, warning;
+    // Shared, the texture streamer keeps the scene alive until its pixels are uploaded
+    auto scene = std::make_shared<glTFSceneData>();
 
-    bool file_loaded = gltf_content.LoadASCIIFromFile(&gltf_input, &error, &warning, new_path);
+    // A valid baked cache replaces parsing and decoding entirely
+    auto stage_start = std::chrono::steady_clock::now();
+    m_loadStats.fromCache = m_useCache && MeshCache::load(cache_path, new_path, *scene);
+    if (m_loadStats.fromCache) {
+        m_loadStats.parseTime = elapsedMilliseconds(stage_start);
+    } else {
+        glTFImporter importer(m_loadMode);
+        if (!importer.importFile(new_path, *scene)) {
+            return;
+        }
+        m_loadStats.parseTime = importer.getParseTime();
+        m_loadStats.decodeTime = importer.getDecodeTime();
+        m_loadStats.optimizeTime = importer.getOptimizeTime();
 
-    if (file_loaded) {
-        loadImages(gltf_input);
-        loadMaterials(gltf_input);
-        loadTextures(gltf_input);
-        const tinygltf::Scene& scene = gltf_input.scenes[0];
-        for (size_t i = 0; i < scene.nodes.size(); i++) {
-            const tinygltf::Node node = gltf_input.nodes[scene.nodes[i]];
-            loadNode(node, gltf_input, nullptr);
+        // Rebuild the cache so the next start can skip the import
+        uint64_t source_hash = 0;
+        if (m_useCache && MeshCache::hashSource(new_path, scene->dependencies, source_hash)) {
+            MeshCache::write(cache_path, *scene, source_hash);
+        }
+    }
+
+    m_loadStats.meshStats = scene->meshStats;
+
+    stage_start = std::chrono::steady_clock::now();
+    {
+        Profiler::CpuZone cpu_zone("Model upload");
+        Profiler::GpuZone gpu_zone("Model upload");
+        loadImages(scene);
+        loadMaterials(*scene);
+        loadTextures(*scene);
+        loadNodes(*scene);
+    }
+    // Geometry is in the arena now, only the pixels have to outlive this call
+    std::vector<Vertex>().swap(scene->vertexStorage);
+    std::vector<GLuint>().swap(scene->indexStorage);
+    m_loadStats.uploadTime = elapsedMilliseconds(stage_start);
+
+    std::cout << "Loaded glTF model " << filePath << (m_loadStats.fromCache ? " from cache" : "") << " ("
+              << scene->primitives.size() << " primitives): parse " << m_loadStats.parseTime << " ms, decode "
+              << m_loadStats.decodeTime << " ms, optimize " << m_loadStats.optimizeTime << " ms, upload " << m_loadStats.uploadTime << " ms" << std::endl;
+    const auto& mesh_stats = m_loadStats.meshStats;
+    std::cout << "  vertex cache: ACMR " << mesh_stats.getACMRBefore() << " -> " << mesh_stats.getACMRAfter() << ", ATVR "
+              << mesh_stats.getATVRBefore() << " -> " << mesh_stats.getATVRAfter() << ", " << mesh_stats.verticesBefore << " -> "
+              << mesh_stats.verticesAfter << " vertices" << std::endl;
+}
+
+size_t glTFModel::updateTransforms() {
+    const size_t updated = m_sceneGraph.update();
+    m_nodeMoved.resize(m_sceneGraph.size(), 0);
+    for (const auto node : m_sceneGraph.getUpdatedNodes()) {
+        if (!m_nodeMoved[node]) {
+            m_nodeMoved[node] = 1;
+            m_movedNodes.push_back(node);
+        }
+        const auto& mesh = m_meshes[node];
+        const auto& world = m_sceneGraph.getWorldMatrix(node);
+        for (uint32_t i = 0; i < mesh.primitives.size(); ++i) {
+            const BVH::Box local = { mesh.primitives[i].m_boundsMin, mesh.primitives[i].m_boundsMax };
+            const BVH::Box box = local.transformed(world);
+            m_culler.setBox(mesh.firstPrimitive + i, box.min, box.max);
+            m_bvh.setBox(mesh.firstPrimitive + i, box);
+
+            const auto& primitive = mesh.primitives[i];
+            const bool double_sided = getMaterial(primitive.m_materialIndex).doubleSided;
+            for (uint32_t m = primitive.m_firstMeshlet; m < primitive.m_firstMeshlet + primitive.m_meshletCount; ++m) {
+                m_meshletCuller.setBounds(m, m_meshlets[m].bounds, world, !double_sided);
+            }
         }
-    } else {
-        std::cerr << "Could not open the glTF file: " << filePath << "error: " << error << std::endl;
     }
+    m_bvh.refit();
+    return updated;
 }
 
-void glTFModel::draw(GLShaderProgram& shader) {
-    for (auto& node : m_nodes) {
-        drawNode(node, shader);
+void glTFModel::clearMovedNodes() {
+    for (const auto node : m_movedNodes) {
+        m_nodeMoved[node] = 0;
     }
+    m_movedNodes.clear();
 }
 
-void glTFModel::drawNode(glTFModel::Node* node, GLShaderProgram& shader) {
-    if (node->mesh.primitives.size() > 0) {
- 
-        // Set model matrix
-        shader.setUniform("modelMatrix", node->matrix);
+void glTFModel::cull(const glm::mat4& viewProjection, const cull_mode mode) {
+    updateTransforms();
+    const auto frustum = FrustumCuller::extractFrustum(viewProjection);
+    const bool use_bvh = mode == cull_bvh || (mode == cull_auto && m_culler.size() >= BVH_CULL_PRIMITIVES);
+    m_previousVisible.swap(m_visible);
+    const auto visible = static_cast<uint32_t>(use_bvh ? m_bvh.cull(frustum, m_visible) : m_culler.cull(frustum, m_visible));
+    if (m_visible != m_previousVisible) {
+        ++m_drawSetVersion;
+    }
+    m_cullStats.visible = visible;
+    m_cullStats.culled = static_cast<uint32_t>(m_visible.size()) - visible;
+}
 
-        for (auto& primitive : node->mesh.primitives) {
-            if (primitive.m_indexCount > 0) {
+int32_t glTFModel::pick(const glm::vec3& origin, const glm::vec3& direction) const {
+    uint32_t primitive = 0;
+    float distance = 0.0f;
+    return m_bvh.intersect(origin, direction, primitive, distance) ? static_cast<int32_t>(primitive) : -1;
+}
 
-                uint32_t indexx = materials[primitive.m_materialIndex].baseColorTextureIndex;
-                glTFModel::Texture texture = textures[materials[primitive.m_materialIndex].baseColorTextureIndex];
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, images[texture.imageIndex].texture);
+void glTFModel::resetCulling() {
+    if (m_visible.size() != m_culler.size() || std::find(m_visible.begin(), m_visible.end(), 0) != m_visible.end()) {
+        ++m_drawSetVersion;
+    }
+    m_visible.assign(m_culler.size(), 1);
+    m_cullStats.visible = static_cast<uint32_t>(m_visible.size());
+    m_cullStats.culled = 0;
+}
 
-                primitive.draw();
-                
-            }
-        }
+void glTFModel::cullMeshlets(const glm::mat4& view, const glm::mat4& projection) {
+    const glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    m_previousMeshletVisible.swap(m_meshletVisible);
+    m_meshletCuller.cull(FrustumCuller::extractFrustum(projection * view), eye, m_meshletVisible);
+    if (m_meshletVisible != m_previousMeshletVisible) {
+        ++m_drawSetVersion;
     }
 
-    for (auto& child : node->children) {
-        drawNode(child, shader);
-    }
-}
-
-void glTFModel::loadImages(tinygltf::Model& input) {
-    // Images can be stored inside the glTF (which is the case for the sample model), so instead of directly
-    // loading them from disk, we fetch them from the glTF loader and upload the buffers
-    images.resize(input.images.size());
-    for (size_t i = 0; i < input.images.size(); i++) {
-        tinygltf::Image& glTFImage = input.images[i];
-        // Get the image data from the glTF loader
-        unsigned char* buffer = nullptr;
-        uint64_t bufferSize = 0;
-        bool deleteBuffer = false;
-        // We convert RGB-only images to RGBA, as most devices don't support RGB-formats in Vulkan
-        if (glTFImage.component == 3) {
-            bufferSize = glTFImage.width * glTFImage.height * 4;
-            buffer = new unsigned char[bufferSize];
-            unsigned char* rgba = buffer;
-            unsigned char* rgb = &glTFImage.image[0];
-            for (size_t i = 0; i < glTFImage.width * glTFImage.height; ++i) {
-                memcpy(rgba, rgb, sizeof(unsigned char) * 3);
-                rgba += 4;
-                rgb += 3;
+    m_meshletStats = MeshletStats();
+    for (uint32_t p = 0; p < m_visible.size(); ++p) {
+        const auto& primitive = getPrimitive(p);
+        if (!m_visible[p] || primitive.m_lod != 0) {
+            continue;
+        }
+        for (uint32_t m = primitive.m_firstMeshlet; m < primitive.m_firstMeshlet + primitive.m_meshletCount; ++m) {
+            if (m_meshletVisible[m]) {
+                ++m_meshletStats.visible;
+            }
+            else {
+                ++m_meshletStats.culled;
+                m_meshletStats.culledTriangles += m_meshlets[m].indexCount / 3;
             }
-            deleteBuffer = true;
         }
-        else {
-            buffer = &glTFImage.image[0];
-            bufferSize = glTFImage.image.size();
+    }
+}
+
+void glTFModel::resetMeshletCulling() {
+    if (m_meshletVisible.size() != m_meshlets.size() || std::find(m_meshletVisible.begin(), m_meshletVisible.end(), 0) != m_meshletVisible.end()) {
+        ++m_drawSetVersion;
+    }
+    m_meshletVisible.assign(m_meshlets.size(), 1);
+    m_meshletStats = MeshletStats();
+}
+
+void glTFModel::requestTextureLevels(const glm::mat4& view, const glm::mat4& projection, const float viewportHeight) const {
+    auto& streamer = GLTextureStreamer::getInstance();
+    if (!streamer.getMipResidency()) {
+        return;
+    }
+
+    const glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    // Pixels spanned by one world unit at distance 1
+    const float pixels_per_unit = 0.5f * projection[1][1] * viewportHeight;
+    for (uint32_t node = 0; node < m_meshes.size(); ++node) {
+        const auto& mesh = m_meshes[node];
+        if (mesh.primitives.empty()) {
+            continue;
         }
-        // Load texture from image buffer
-        images[i].texture = ResourceManager::getInstance().textureFromBuffer(
-            buffer,
-            glTFImage.name,
-            glTFImage.width,
-            glTFImage.height,
-            glTFImage.component,
-            true
-        );
-        if (deleteBuffer) {
-            delete[] buffer;
+        const auto& world = m_sceneGraph.getWorldMatrix(node);
+        const float scale = std::max({ glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])) });
+        for (uint32_t i = 0; i < mesh.primitives.size(); ++i) {
+            const auto& primitive = mesh.primitives[i];
+            if (!m_visible[mesh.firstPrimitive + i] || primitive.m_uvScale <= 0.0f) {
+                continue;
+            }
+            // Nothing to stream without a material or a base color texture
+            if (primitive.m_materialIndex < 0 || static_cast<size_t>(primitive.m_materialIndex) >= materials.size()) {
+                continue;
+            }
+            const unsigned int texture = getBaseColorTexture(materials[primitive.m_materialIndex]);
+            if (texture == 0) {
+                continue;
+            }
+
+            // The closest point of the bounds needs the finest level
+            const auto& box = m_bvh.getBox(mesh.firstPrimitive + i);
+            const float distance = std::max(glm::length(glm::clamp(eye, box.min, box.max) - eye), 1e-3f);
+            const float pixels_per_uv = primitive.m_uvScale * scale * pixels_per_unit / distance;
+            streamer.requestResolution(texture, pixels_per_uv);
         }
     }
 }
 
-void glTFModel::loadTextures(tinygltf::Model& input) {
-    textures.resize(input.textures.size());
-    for (size_t i = 0; i < input.textures.size(); ++i) {
-        textures[i].imageIndex = input.textures[i].source;
+unsigned int glTFModel::getBaseColorTexture(const Material& material) const {
+    if (material.baseColorTextureIndex >= textures.size()) {
+        return 0;
     }
+    const int32_t image_index = textures[material.baseColorTextureIndex].imageIndex;
+    return image_index >= 0 && static_cast<size_t>(image_index) < images.size() ? images[image_index].texture : 0;
 }
 
-void glTFModel::loadMaterials(tinygltf::Model& input) {
-    materials.resize(input.materials.size());
-    for (size_t i = 0; i < input.materials.size(); ++i) {
-        tinygltf::Material glTFMaterial = input.materials[i];
-        // Get base color texture index
-        if (glTFMaterial.values.find("baseColorTexture") != glTFMaterial.values.end()) {
-            materials[i].baseColorTextureIndex = glTFMaterial.values["baseColorTexture"].TextureIndex();
+const glTFModel::Material& glTFModel::getMaterial(const int32_t materialIndex) const {
+    return materialIndex >= 0 && static_cast<size_t>(materialIndex) < materials.size() ? materials[materialIndex] : m_defaultMaterial;
+}
+
+unsigned int glTFModel::getDrawTexture(const Material& material) const {
+    const unsigned int texture = getBaseColorTexture(material);
+    return texture != 0 || !m_whiteTexture ? texture : m_whiteTexture->id;
+}
+
+void glTFModel::selectLods(const glm::mat4& view, const glm::mat4& projection, const float viewportHeight, const float pixelError) {
+    m_lodStats = LodStats();
+    const glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+    // Pixels spanned by one world unit at distance 1
+    const float pixels_per_unit = 0.5f * projection[1][1] * viewportHeight;
+    for (uint32_t node = 0; node < m_meshes.size(); ++node) {
+        auto& mesh = m_meshes[node];
+        if (mesh.primitives.empty()) {
+            continue;
+        }
+        const auto& world = m_sceneGraph.getWorldMatrix(node);
+        const float scale = std::max({ glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2])) });
+        for (uint32_t i = 0; i < mesh.primitives.size(); ++i) {
+            auto& primitive = mesh.primitives[i];
+            if (!m_visible[mesh.firstPrimitive + i]) {
+                continue;
+            }
+            const uint32_t previous_lod = primitive.m_lod;
+            if (pixelError <= 0.0f) {
+                primitive.m_lod = 0;
+            }
+            else {
+                // The closest point of the bounds sees the largest error
+                const auto& box = m_bvh.getBox(mesh.firstPrimitive + i);
+                const float distance = std::max(glm::length(glm::clamp(eye, box.min, box.max) - eye), 1e-3f);
+                const float pixels_per_error = scale * pixels_per_unit / distance;
+                const auto& lods = primitive.m_lods;
+                uint32_t lod = std::min(primitive.m_lod, static_cast<uint32_t>(lods.size()) - 1);
+                // Refine as soon as the error shows, coarsen only once the coarser level is well below the threshold
+                while (lod > 0 && lods[lod].error * pixels_per_error > pixelError) {
+                    --lod;
+                }
+                while (lod + 1 < lods.size() && lods[lod + 1].error * pixels_per_error <= pixelError * LOD_HYSTERESIS) {
+                    ++lod;
+                }
+                primitive.m_lod = lod;
+            }
+            if (primitive.m_lod != previous_lod) {
+                ++m_drawSetVersion;
+            }
+            m_lodStats.triangles += primitive.getLod().indexCount / 3;
+            m_lodStats.fullTriangles += primitive.m_indexCount / 3;
         }
     }
 }
 
-void glTFModel::loadNode(const tinygltf::Node& input_node, const tinygltf::Model& input, glTFModel::Node* parent) {
-    glTFModel::Node* node = new glTFModel::Node();
-    node->matrix = glm::mat4(1.0f);
-    node->parent = parent;
+void glTFModel::draw(GLShaderProgram& shader, const glm::mat4& viewProjection, const bool transparentOnly) {
+    updateTransforms();
 
-    // Get the local node matrix
-    // It's either made up from translation, rotation, scale or a 4x4 matrix
-    if (input_node.translation.size() == 3) {
-        node->matrix = glm::translate(node->matrix, glm::vec3(glm::make_vec3(input_node.translation.data())));
-    }
-    if (input_node.rotation.size() == 4) {
-        glm::quat q = glm::make_quat(input_node.rotation.data());
-        node->matrix *= glm::mat4(q);
+    // View depth of the visible box centers, the clip w. The keys quantize it over the visible range.
+    const glm::vec4 w_row(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    m_depths.resize(m_visible.size());
+    float near_depth = std::numeric_limits<float>::max();
+    float far_depth = std::numeric_limits<float>::lowest();
+    for (uint32_t p = 0; p < m_visible.size(); ++p) {
+        if (!m_visible[p]) {
+            continue;
+        }
+        const auto& box = m_bvh.getBox(p);
+        m_depths[p] = glm::dot(w_row, glm::vec4(0.5f * (box.min + box.max), 1.0f));
+        near_depth = std::min(near_depth, m_depths[p]);
+        far_depth = std::max(far_depth, m_depths[p]);
     }
-    if (input_node.scale.size() == 3) {
-        node->matrix = glm::scale(node->matrix, glm::vec3(glm::make_vec3(input_node.scale.data())));
+    const float depth_scale = far_depth > near_depth ? 1.0f / (far_depth - near_depth) : 0.0f;
+
+    // One shader for the whole model, the key's texture is the GL name so images sharing a texture group together
+    m_renderQueue.clear();
+    for (uint32_t p = 0; p < m_visible.size(); ++p) {
+        if (!m_visible[p]) {
+            continue;
+        }
+        const uint32_t node = m_primitiveNodes[p];
+        const auto& primitive = m_meshes[node].primitives[p - m_meshes[node].firstPrimitive];
+        if (primitive.m_indexCount == 0) {
+            continue;
+        }
+        const auto& material = getMaterial(primitive.m_materialIndex);
+        const auto pass = material.alphaMode == glTFSceneData::alpha_blend ? RenderQueue::pass_transparent : RenderQueue::pass_opaque;
+        if (transparentOnly && pass != RenderQueue::pass_transparent) {
+            continue;
+        }
+        const auto texture = getDrawTexture(material);
+        const float depth = (m_depths[p] - near_depth) * depth_scale;
+        m_renderQueue.submit(RenderQueue::makeKey(pass, 0, texture, static_cast<uint32_t>(primitive.m_materialIndex), depth), p);
     }
-    if (input_node.matrix.size() == 16) {
-        node->matrix = glm::make_mat4x4(input_node.matrix.data());
-    };
+    m_renderQueue.sort();
+
+    // Every primitive lives in the shared arena, one VAO bind for the whole model. It stays bound,
+    // the next draw from the arena skips the bind.
+    GLMeshArena::getInstance().bind();
+    NodeUniforms uniforms;
+    uniforms.modelMatrix = shader.getUniform<glm::mat4>("modelMatrix");
+    uniforms.baseColorFactor = shader.getUniform<glm::vec4>("baseColorFactor");
+    uniforms.positionOffset = shader.getUniform<glm::vec3>("positionOffset");
+    uniforms.positionScale = shader.getUniform<glm::vec3>("positionScale");
+
+    // State only changes where the key does: the transform, the material or the pass
+    uint32_t current_node = std::numeric_limits<uint32_t>::max();
+    // -1 is the default material, so a separate flag makes the first item always apply its own
+    int32_t current_material = -1;
+    bool material_set = false;
+    const GLVertexLayout::Quantization* current_quantization = nullptr;
+    bool blending = false;
+    for (const auto& item : m_renderQueue.getItems()) {
+        const uint32_t p = item.payload;
+        const uint32_t node = m_primitiveNodes[p];
+        const auto& primitive = m_meshes[node].primitives[p - m_meshes[node].firstPrimitive];
 
-    // Load node's children
-    if (input_node.children.size() > 0) {
-        for (size_t i = 0; i < input_node.children.size(); i++) {
-            loadNode(input.nodes[input_node.children[i]], input, node);
+        if (!blending && RenderQueue::getPass(item.key) == RenderQueue::pass_transparent) {
+            // Blended surfaces are tested against the opaque depth but don't hide each other
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            blending = true;
         }
+        if (node != current_node) {
+            shader.setUniform(uniforms.modelMatrix, m_sceneGraph.getWorldMatrix(node));
+            current_node = node;
+        }
+        if (!material_set || primitive.m_materialIndex != current_material) {
+            const auto& material = getMaterial(primitive.m_materialIndex);
+            shader.setUniform(uniforms.baseColorFactor, material.baseColorFactor);
+            GLState::getInstance().bindTexture(0, GL_TEXTURE_2D, getDrawTexture(material));
+            current_material = primitive.m_materialIndex;
+            material_set = true;
+        }
+        // Every primitive has its own box under a quantized layout, float vertices set the identity once
+        const auto& quantization = primitive.m_quantization;
+        if (!current_quantization || quantization.offset != current_quantization->offset || quantization.scale != current_quantization->scale) {
+            shader.setUniform(uniforms.positionOffset, quantization.offset);
+            shader.setUniform(uniforms.positionScale, quantization.scale);
+            current_quantization = &quantization;
+        }
+
+        primitive.draw();
     }
 
-    // If the node contains mesh data, we load vertices and indices from the buffers
-    // In glTF this is done via accessors and buffer views
-    if (input_node.mesh > -1) {
-        const tinygltf::Mesh mesh = input.meshes[input_node.mesh];
+    if (blending) {
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+    }
+}
 
-        // Iterate through all primitives of this node's mesh
-        for (size_t i = 0; i < mesh.primitives.size(); ++i) {
-            const tinygltf::Primitive& glTFPrimitive = mesh.primitives[i];
+void glTFModel::loadImages(const std::shared_ptr<const glTFSceneData>& scene) {
+    auto& cache = ResourceManager::getInstance().getTextureCache();
 
-            std::vector<Vertex> vertices;
-            // Vertices
-            {
-                const float* positionBuffer = nullptr;
-                const float* normalsBuffer = nullptr;
-                const float* texCoordsBuffer = nullptr;
-                size_t vertexCount = 0;
+    // Identical images share a texture, within the model and with every other one loaded.
+    // The keys hash the decoded texels, which is worth spreading over the workers.
+    std::vector<uint64_t> keys(scene->images.size());
+    ThreadPool::getInstance().parallelFor(0, scene->images.size(), [&](const size_t i) {
+        const auto& image = scene->images[i];
+        const TextureCache::Parameters parameters{ image.compressed ? TextureCache::kind_compressed : TextureCache::kind_streamed,
+                                                   image.width, image.height, image.component, true, false };
+        keys[i] = TextureCache::makeKey(image.pixels, image.size, parameters);
+    });
 
-                // Get buffer data for vertex positions
-                if (glTFPrimitive.attributes.find("POSITION") != glTFPrimitive.attributes.end()) {
-                    const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.attributes.find("POSITION")->second];
-                    const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
-                    positionBuffer = reinterpret_cast<const float*>(&(input.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-                    vertexCount = accessor.count;
-                }
-                // Get buffer data for vertex normals
-                if (glTFPrimitive.attributes.find("NORMAL") != glTFPrimitive.attributes.end()) {
-                    const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.attributes.find("NORMAL")->second];
-                    const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
-                    normalsBuffer = reinterpret_cast<const float*>(&(input.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-                }
-                // Get buffer data for vertex texture coordinates
-                // glTF supports multiple sets, we only load the first one
-                if (glTFPrimitive.attributes.find("TEXCOORD_0") != glTFPrimitive.attributes.end()) {
-                    const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.attributes.find("TEXCOORD_0")->second];
-                    const tinygltf::BufferView& view = input.bufferViews[accessor.bufferView];
-                    texCoordsBuffer = reinterpret_cast<const float*>(&(input.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
-                }
+    // Look everything up before creating anything, so new textures can't evict resident ones this model uses
+    images.resize(scene->images.size());
+    for (size_t i = 0; i < scene->images.size(); i++) {
+        const auto duplicate = std::find(keys.begin(), keys.begin() + i, keys[i]);
+        if (duplicate == keys.begin() + i) {
+            images[i].handle = cache.find(keys[i]);
+        }
+    }
 
-                // Append data to model's vertex buffer
-                for (size_t v = 0; v < vertexCount; v++) {
-                    Vertex vert{};
-                    vert.Position = glm::vec4(glm::make_vec3(&positionBuffer[v * 3]), 1.0f);
-                    vert.Normal = glm::normalize(glm::vec3(normalsBuffer ? glm::make_vec3(&normalsBuffer[v * 3]) : glm::vec3(0.0f)));
-                    vert.TexCoords = texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[v * 2]) : glm::vec3(0.0f);
-                    vertices.push_back(vert);
-                }
+    // Textures start as a placeholder and are filled in over the next frames
+    for (size_t i = 0; i < scene->images.size(); i++) {
+        const auto& image = scene->images[i];
+        auto& handle = images[i].handle;
+        const auto duplicate = std::find(keys.begin(), keys.begin() + i, keys[i]);
+        if (duplicate != keys.begin() + i) {
+            handle = images[duplicate - keys.begin()].handle;
+        }
+        else if (!handle && image.compressed) {
+            // Block-compressed images are small and carry their mips, upload them right away
+            CompressedTexture texture;
+            const unsigned int id = texture.parse(image.pixels, image.size)
+                ? ResourceManager::getInstance().textureFromCompressed(texture, "image " + std::to_string(i))
+                : 0;
+            // mesh.frag uses the stored values like those of the streamed RGBA8 textures
+            if (id && texture.isSRGB()) {
+                GLState::getInstance().bindTexture(GL_TEXTURE_2D, id);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SRGB_DECODE_EXT, GL_SKIP_DECODE_EXT);
             }
-
-            std::vector<GLuint> indices;
-            // Indices
-            {
-                const tinygltf::Accessor& accessor = input.accessors[glTFPrimitive.indices];
-                const tinygltf::BufferView& bufferView = input.bufferViews[accessor.bufferView];
-                const tinygltf::Buffer& buffer = input.buffers[bufferView.buffer];
-
-                // glTF supports different component types of indices
-                switch (accessor.componentType) {
-                    case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-                        const uint32_t* buf = reinterpret_cast<const uint32_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-                        for (size_t index = 0; index < accessor.count; index++) {
-                            indices.push_back(buf[index]);
-                        }
-                        break;
-                    }
-                    case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-                        const uint16_t* buf = reinterpret_cast<const uint16_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-                        for (size_t index = 0; index < accessor.count; index++) {
-                            indices.push_back(buf[index]);
-                        }
-                        break;
-                    }
-                    case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-                        const uint8_t* buf = reinterpret_cast<const uint8_t*>(&buffer.data[accessor.byteOffset + bufferView.byteOffset]);
-                        for (size_t index = 0; index < accessor.count; index++) {
-                            indices.push_back(buf[index]);
-                        }
-                        break;
-                    }
-                    default:
-                        std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
-                        return;
-                }
+            if (id) {
+                handle = cache.insert(keys[i], id, texture.getDataSize());
+            }
+        }
+        else if (!handle) {
+            const unsigned int id = GLTextureStreamer::getInstance().createTexture(image.pixels, image.width, image.height, image.component, scene);
+            if (id) {
+                handle = cache.insert(keys[i], id, GLTextureStreamer::getTextureBytes(image.width, image.height));
             }
-
-            glTFMesh primitive(vertices, indices, glTFPrimitive.material);
-            node->mesh.primitives.push_back(primitive);
         }
+        if (!handle) {
+            std::cerr << "glTF Model: Could not create texture for image " << i << std::endl;
+        }
+        images[i].texture = handle ? handle->id : 0;
     }
 
-    if (parent) {
-        parent->children.push_back(node);
+    // Bound for primitives without a base color texture, shared by every model through the cache
+    unsigned char white[4] = { 255, 255, 255, 255 };
+    m_whiteTexture = ResourceManager::getInstance().textureFromBuffer(white, "white", 1, 1, 4, false);
+}
+
+void glTFModel::loadTextures(const glTFSceneData& scene) {
+    textures.resize(scene.textures.size());
+    for (size_t i = 0; i < scene.textures.size(); ++i) {
+        textures[i].imageIndex = scene.textures[i];
     }
-    else {
-        m_nodes.push_back(node);
+}
+
+void glTFModel::loadMaterials(const glTFSceneData& scene) {
+    materials.resize(scene.materials.size());
+    for (size_t i = 0; i < scene.materials.size(); ++i) {
+        materials[i].baseColorFactor = scene.materials[i].baseColorFactor;
+        materials[i].baseColorTextureIndex = static_cast<uint32_t>(scene.materials[i].baseColorTextureIndex);
+        materials[i].alphaMode = scene.materials[i].alphaMode;
+        materials[i].doubleSided = scene.materials[i].doubleSided;
     }
 }
+
+void glTFModel::loadNodes(const glTFSceneData& scene) {
+    // Grow the arena once for the whole model instead of once per primitive
+    size_t index_bytes = 0;
+    for (const auto& primitive : scene.primitives) {
+        index_bytes += uploadIndexCount(scene, primitive) * GLMeshArena::getIndexSize(primitive.vertexCount);
+    }
+    GLMeshArena::getInstance().reserve(scene.vertexCount, index_bytes);
+
+    // Nodes are stored parents first, which is the order the scene graph expects
+    m_sceneGraph.clear();
+    m_movedNodes.clear();
+    m_nodeMoved.clear();
+    m_meshes.resize(scene.nodes.size());
+    m_culler.resize(scene.primitives.size());
+    m_bvh.resize(scene.primitives.size());
+    m_primitiveNodes.resize(scene.primitives.size());
+    m_meshlets.assign(scene.meshlets.begin(), scene.meshlets.end());
+    m_meshletCuller.resize(scene.meshlets.size());
+    for (size_t i = 0; i < scene.nodes.size(); ++i) {
+        const auto& node_data = scene.nodes[i];
+        m_sceneGraph.addNode(node_data.parent, node_data.translation, node_data.rotation, node_data.scale);
+
+        // Upload the primitives straight from the scene's vertex and index buffers
+        auto& mesh = m_meshes[i];
+        mesh.firstPrimitive = node_data.firstPrimitive;
+        mesh.primitives.reserve(node_data.primitiveCount);
+        for (uint32_t p = node_data.firstPrimitive; p < node_data.firstPrimitive + node_data.primitiveCount; ++p) {
+            const auto& primitive = scene.primitives[p];
+            m_primitiveNodes[p] = static_cast<uint32_t>(i);
+            mesh.primitives.emplace_back(
+                scene.vertices + primitive.firstVertex,
+                primitive.vertexCount,
+                scene.indices + primitive.firstIndex,
+                uploadIndexCount(scene, primitive),
+                primitive.materialIndex
+            );
+            mesh.primitives.back().setLods(scene, primitive);
+            mesh.primitives.back().m_mode = primitive.mode;
+            // The allocation starts with the primitive's own indices
+            mesh.primitives.back().m_firstMeshlet = primitive.firstMeshlet;
+            mesh.primitives.back().m_meshletCount = primitive.meshletCount;
+            for (uint32_t m = primitive.firstMeshlet; m < primitive.firstMeshlet + primitive.meshletCount; ++m) {
+                m_meshlets[m].firstIndex -= primitive.firstIndex;
+            }
+            mesh.primitives.back().m_boundsMin = primitive.boundsMin;
+            mesh.primitives.back().m_boundsMax = primitive.boundsMax;
+            mesh.primitives.back().m_uvScale = primitive.mode == GL_TRIANGLES
+                ? uvScale(scene.vertices + primitive.firstVertex, scene.indices + primitive.firstIndex, primitive.indexCount) : 0.0f;
+        }
+    }
+    updateTransforms();
+    m_bvh.build();
+    resetCulling();
+    resetMeshletCulling();
+}
\ No newline at end of file
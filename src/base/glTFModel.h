@@ -1,26 +1,34 @@
 #ifndef GLTF_MODEL_H
 #define GLTF_MODEL_H
 
-#include "tiny_gltf.h"
-
+#include <memory>
 #include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "glTFMesh.h"
+#include "glTFImporter.h"
+#include "SceneGraph.h"
+#include "FrustumCuller.h"
+#include "MeshletCuller.h"
+#include "BVH.h"
+#include "RenderQueue.h"
 
 #include "../graphic/GLShaderProgram.h"
+#include "../utility/TextureCache.h"
 
 class glTFModel {
     public:
         // Contains the node's (optional) geometry and can be made up of an arbitrary number of primitives
         struct Mesh {
             std::vector<glTFMesh> primitives;
+            uint32_t firstPrimitive = 0;    // Index of primitives[0] in the model's per-primitive arrays
         };
 
         struct Image {
             unsigned int texture;
+            TextureCache::Handle handle;    // keeps the texture resident, it may be shared with other models
         };
 
         struct Texture {
@@ -29,33 +37,121 @@ class glTFModel {
 
         struct Material {
             glm::vec4 baseColorFactor = glm::vec4(1.0f);
-            uint32_t baseColorTextureIndex;
+            uint32_t baseColorTextureIndex = ~0u;   // Out of range for untextured materials
+            glTFSceneData::alpha_mode alphaMode = glTFSceneData::alpha_opaque;    // mesh.frag has no alpha test, masked draws as opaque
+            bool doubleSided = false;   // Back faces are seen, its meshlets are never cone culled
         };
 
-        struct Node {
-            Node* parent;
-            std::vector<Node*> children;
-            Mesh mesh;
-            glm::mat4 matrix;
-            ~Node() {
-                for (auto& child : children) {
-                    delete child;
-                }
-            }
+        // Uniforms set while replaying the render queue, resolved once per draw()
+        struct NodeUniforms {
+            GLUniform<glm::mat4> modelMatrix;
+            GLUniform<glm::vec4> baseColorFactor;
+            GLUniform<glm::vec3> positionOffset;
+            GLUniform<glm::vec3> positionScale;
         };
 
-        glTFModel(const std::string filePath);
+        enum cull_mode { cull_auto, cull_flat, cull_bvh };
+
+        // Primitive count from which cull_auto uses the BVH; below it the SIMD pass over every box is cheaper
+        // than the traversal, and it stays competitive for large scenes when most of them are in view
+        static constexpr size_t BVH_CULL_PRIMITIVES = 4096;
 
-        void draw(GLShaderProgram& shader);
+        struct CullStats {
+            uint32_t visible = 0;
+            uint32_t culled = 0;
+        };
 
-        void drawNode(glTFModel::Node* node, GLShaderProgram& shader);
+        // A coarser level of detail is only picked once its error is this fraction of the allowed one,
+        // so primitives near the switching distance do not pop back and forth
+        static constexpr float LOD_HYSTERESIS = 0.75f;
+
+        // Triangles of the visible primitives at their selected levels and at full detail
+        struct LodStats {
+            uint64_t triangles = 0;
+            uint64_t fullTriangles = 0;
+        };
+
+        // Meshlets of the visible primitives drawn at full detail, the only ones meshlet culling applies to
+        struct MeshletStats {
+            uint32_t visible = 0;
+            uint32_t culled = 0;
+            uint64_t culledTriangles = 0;
+        };
+
+        // Load-time breakdown in milliseconds
+        struct LoadStats {
+            double parseTime = 0.0;
+            double decodeTime = 0.0;
+            double optimizeTime = 0.0;
+            double uploadTime = 0.0;
+            bool fromCache = false;
+            MeshOptimizer::Stats meshStats;     // From the import, also when it was baked into the cache
+        };
 
+        glTFModel(const std::string filePath, const glTFImporter::load_mode mode = glTFImporter::load_mode::parallel, const bool useCache = true);
+        ~glTFModel();
+
+        // Owns ranges of the shared mesh arena, not copyable
+        glTFModel(const glTFModel&) = delete;
+        glTFModel& operator=(const glTFModel&) = delete;
+
+        // Updates the world matrices and bounds of nodes moved since the last call, draw() does this itself
+        size_t updateTransforms();
+        // Nodes moved by any updateTransforms() since the last clearMovedNodes(). cull() and draw() update the
+        // transforms too, so a renderer keeping its own copies reads these instead of the scene graph's last update.
+        const std::vector<uint32_t>& getMovedNodes() const { return m_movedNodes; }
+        void clearMovedNodes();
+        // Marks the primitives outside the view frustum, draw() skips them until the next cull.
+        // cull_auto tests every box with SIMD for small models and walks the BVH for large ones.
+        void cull(const glm::mat4& viewProjection, const cull_mode mode = cull_auto);
+        // Nearest primitive whose world bounds the ray hits, or -1
+        int32_t pick(const glm::vec3& origin, const glm::vec3& direction) const;
+        // Makes every primitive visible again
+        void resetCulling();
+        // Under mip residency, requests the texture resolution each visible primitive needs at its
+        // current screen size from GLTextureStreamer. Call after cull().
+        void requestTextureLevels(const glm::mat4& view, const glm::mat4& projection, const float viewportHeight) const;
+        // Picks the coarsest level of detail of each visible primitive whose error projects to at most
+        // pixelError pixels, with LOD_HYSTERESIS. 0 draws everything at full detail. Call after cull().
+        void selectLods(const glm::mat4& view, const glm::mat4& projection, const float viewportHeight, const float pixelError);
+        // Marks the meshlets outside the view frustum or facing away from the eye, glTFIndirectRenderer then
+        // draws the remaining runs of a full detail primitive. Call after cull() and selectLods().
+        void cullMeshlets(const glm::mat4& view, const glm::mat4& projection);
+        // Makes every meshlet visible again
+        void resetMeshletCulling();
+        // Submits the visible primitives to the render queue and replays it sorted: opaque ones grouped by
+        // texture and material, then blended ones back to front. viewProjection gives their depth.
+        // transparentOnly draws just the blended ones, after glTFIndirectRenderer drew the rest.
+        void draw(GLShaderProgram& shader, const glm::mat4& viewProjection, const bool transparentOnly = false);
 
         void loadglTFFile(const std::string filePath);
-        void loadImages(tinygltf::Model& input);
-        void loadTextures(tinygltf::Model& input);
-        void loadMaterials(tinygltf::Model& input);
-        void loadNode(const tinygltf::Node& input_node, const tinygltf::Model& input, glTFModel::Node* parent);
+        void loadImages(const std::shared_ptr<const glTFSceneData>& scene);
+        void loadTextures(const glTFSceneData& scene);
+        void loadMaterials(const glTFSceneData& scene);
+        void loadNodes(const glTFSceneData& scene);
+
+        const LoadStats& getLoadStats() const { return m_loadStats; }
+        const CullStats& getCullStats() const { return m_cullStats; }
+        const LodStats& getLodStats() const { return m_lodStats; }
+        const MeshletStats& getMeshletStats() const { return m_meshletStats; }
+        // Indexed by primitive, in node order
+        const std::vector<uint8_t>& getVisibility() const { return m_visible; }
+        // Changes whenever the visible primitives, their selected levels or the visible meshlets do
+        uint64_t getDrawSetVersion() const { return m_drawSetVersion; }
+        size_t getPrimitiveCount() const { return m_culler.size(); }
+        // Indexed by meshlet, see glTFMesh::m_firstMeshlet
+        const std::vector<uint8_t>& getMeshletVisibility() const { return m_meshletVisible; }
+        size_t getMeshletCount() const { return m_meshlets.size(); }
+        // The primitive's material, a white untextured one when the index is -1 or out of range
+        const Material& getMaterial(const int32_t materialIndex) const;
+        // GL texture of a material's base color, 0 when the material has no valid one
+        unsigned int getBaseColorTexture(const Material& material) const;
+        // Texture to bind for a material, the white one when it has no base color texture
+        unsigned int getDrawTexture(const Material& material) const;
+        const glTFMesh& getPrimitive(const uint32_t primitive) const {
+            const auto& mesh = m_meshes[m_primitiveNodes[primitive]];
+            return mesh.primitives[primitive - mesh.firstPrimitive];
+        }
 
         /*
             Model data
@@ -63,7 +159,35 @@ class glTFModel {
         std::vector<Image> images;
         std::vector<Texture> textures;
         std::vector<Material> materials;
-        std::vector<Node*> m_nodes;
+        Material m_defaultMaterial;
+        TextureCache::Handle m_whiteTexture;
+        // Node transforms, and the geometry of each node at the same index
+        SceneGraph m_sceneGraph;
+        std::vector<Mesh> m_meshes;
+        std::vector<uint32_t> m_movedNodes;
+        std::vector<uint8_t> m_nodeMoved;      // per node, whether it is in m_movedNodes
+        // World-space bounds and visibility of every primitive, in a flat array and a BVH
+        FrustumCuller m_culler;
+        BVH m_bvh;
+        std::vector<uint8_t> m_visible;
+        std::vector<uint8_t> m_previousVisible;    // last cull's result, to tell whether the draw set changed
+        uint64_t m_drawSetVersion { 0 };
+        CullStats m_cullStats;
+        LodStats m_lodStats;
+        // Meshlets of every primitive, firstIndex relative to the primitive's allocation, and their world-space bounds
+        std::vector<glTFSceneData::MeshletData> m_meshlets;
+        MeshletCuller m_meshletCuller;
+        std::vector<uint8_t> m_meshletVisible;
+        std::vector<uint8_t> m_previousMeshletVisible;
+        MeshletStats m_meshletStats;
+        // Node of every primitive, to find a queued primitive's transform
+        std::vector<uint32_t> m_primitiveNodes;
+        RenderQueue m_renderQueue;
+        std::vector<float> m_depths;    // per primitive, only valid for the visible ones during draw()
+
+        glTFImporter::load_mode m_loadMode;
+        bool m_useCache;
+        LoadStats m_loadStats;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef GLTF_SCENE_DATA_H
+#define GLTF_SCENE_DATA_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "Vertex.h"
+#include "../utility/MappedFile.h"
+
+// GPU-ready CPU representation of a glTF scene. It is either produced by glTFImporter or read
+// from a baked mesh cache, in which case all the pointers below reference the cache mapping.
+struct glTFSceneData {
+    struct NodeData {
+        int32_t parent;             // -1 for root nodes, parents always precede their children
+        glm::vec3 translation;      // Local transform
+        glm::quat rotation;
+        glm::vec3 scale;
+        uint32_t firstPrimitive;
+        uint32_t primitiveCount;
+    };
+
+    struct PrimitiveData {
+        uint32_t firstVertex;
+        uint32_t vertexCount;
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t materialIndex;
+        GLenum mode;                // GL_TRIANGLES, GL_LINES, ..., glTF uses the same values
+        glm::vec3 boundsMin;        // Local space, from the POSITION accessor or the decoded vertices
+        glm::vec3 boundsMax;
+        uint32_t firstLod;          // Coarser levels in lods, their indices directly follow the primitive's own
+        uint32_t lodCount;
+        uint32_t firstMeshlet;      // Clusters of the full level in meshlets, none for non-triangle primitives
+        uint32_t meshletCount;
+    };
+
+    // A simplified level of a primitive: indices over the primitive's vertices
+    struct LodData {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float error;                // Farthest the surface moved from the full primitive, in local space units
+    };
+
+    // A cluster of a primitive's full level, firstIndex is absolute like the primitive's
+    using MeshletData = MeshletBuilder::Meshlet;
+
+    // glTF alphaMode
+    enum alpha_mode : uint32_t { alpha_opaque, alpha_mask, alpha_blend };
+
+    struct MaterialData {
+        glm::vec4 baseColorFactor;
+        int32_t baseColorTextureIndex;
+        alpha_mode alphaMode;
+        bool doubleSided;
+    };
+
+    struct ImageData {
+        int32_t width;
+        int32_t height;
+        int32_t component;
+        const unsigned char* pixels;
+        size_t size;
+        bool compressed;    // pixels hold a KTX2 or DDS container instead of 8-bit texels
+    };
+
+    std::vector<NodeData> nodes;
+    std::vector<PrimitiveData> primitives;
+    std::vector<LodData> lods;
+    std::vector<MeshletData> meshlets;
+    std::vector<MaterialData> materials;
+    std::vector<int32_t> textures;  // Image index of every texture
+    std::vector<ImageData> images;
+
+    const Vertex* vertices { nullptr };
+    size_t vertexCount { 0 };
+    const GLuint* indices { nullptr };
+    size_t indexCount { 0 };
+
+    // Vertex cache statistics of the import's mesh optimization, kept in the mesh cache
+    MeshOptimizer::Stats meshStats;
+
+    // External files (buffers, images) the scene was imported from, relative to the source file
+    std::vector<std::string> dependencies;
+
+    // Backing storage: owned buffers after an import, or the mapped cache file
+    std::vector<Vertex> vertexStorage;
+    std::vector<GLuint> indexStorage;
+    std::vector<std::vector<unsigned char>> imageStorage;
+    MappedFile mapping;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "GLExtensions.h"
+
+#include <iostream>
+
+void GLExtensions::load(GLADloadproc loader) {
+    // GLSL 4.30 is needed for the shader storage blocks, so the extension alone on an older context is not enough
+    if (isVersionAtLeast(4, 3)) {
+        multiDrawElementsIndirect = reinterpret_cast<PFN_glMultiDrawElementsIndirect>(loader("glMultiDrawElementsIndirect"));
+    }
+    if (isVersionAtLeast(4, 4)) {
+        bufferStorage = reinterpret_cast<PFN_glBufferStorage>(loader("glBufferStorage"));
+    }
+
+    std::cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor << ", multi-draw indirect "
+              << (supportsMultiDrawIndirect() ? "available" : "unavailable") << ", persistent mapping "
+              << (supportsBufferStorage() ? "available" : "unavailable") << std::endl;
+}
+
+bool GLExtensions::isVersionAtLeast(const int major, const int minor) const {
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
@@ -0,0 +1,43 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// Enums and entry points newer than the generated GL 4.2 loader, resolved at runtime
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+typedef void (APIENTRYP PFN_glBufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP PFN_glMultiDrawElementsIndirect)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+class GLExtensions {
+    public:
+        static auto& getInstance() {
+            static GLExtensions instance;
+            return instance;
+        }
+
+        // Call after gladLoadGLLoader, with the same loader
+        void load(GLADloadproc loader);
+
+        bool isVersionAtLeast(const int major, const int minor) const;
+
+        // glMultiDrawElementsIndirect and shader storage buffers, core since GL 4.3
+        bool supportsMultiDrawIndirect() const { return multiDrawElementsIndirect != nullptr; }
+
+        // Immutable buffer storage, allows persistently mapped buffers; core since GL 4.4
+        bool supportsBufferStorage() const { return bufferStorage != nullptr; }
+
+        PFN_glMultiDrawElementsIndirect multiDrawElementsIndirect { nullptr };
+        PFN_glBufferStorage bufferStorage { nullptr };
+};
+
+#endif
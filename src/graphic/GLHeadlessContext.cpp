@@ -0,0 +1,110 @@
+#include "GLHeadlessContext.h"
+
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+    EGLDisplay getSurfacelessDisplay() {
+        const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (!extensions || !std::strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+            return EGL_NO_DISPLAY;
+        }
+
+        const auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (!get_platform_display) {
+            return EGL_NO_DISPLAY;
+        }
+        return get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+}
+
+GLHeadlessContext::~GLHeadlessContext() {
+    destroy();
+}
+
+bool GLHeadlessContext::create(const int majorVersion, const int minorVersion) {
+    EGLint major, minor;
+    bool surfaceless = true;
+    m_display = getSurfacelessDisplay();
+    if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor)) {
+        surfaceless = false;
+        m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, &major, &minor)) {
+            std::cerr << "Headless Context: No EGL display available" << std::endl;
+            m_display = EGL_NO_DISPLAY;
+            return false;
+        }
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "Headless Context: EGL has no desktop OpenGL support" << std::endl;
+        destroy();
+        return false;
+    }
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(m_display, config_attributes, &config, 1, &config_count) || config_count == 0) {
+        std::cerr << "Headless Context: No matching EGL config" << std::endl;
+        destroy();
+        return false;
+    }
+
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, context_attributes);
+    if (m_context == EGL_NO_CONTEXT) {
+        std::cerr << "Headless Context: Could not create an OpenGL " << majorVersion << "." << minorVersion << " core context" << std::endl;
+        destroy();
+        return false;
+    }
+
+    if (!surfaceless) {
+        const EGLint pbuffer_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        m_surface = eglCreatePbufferSurface(m_display, config, pbuffer_attributes);
+    }
+
+    if (!eglMakeCurrent(m_display, m_surface, m_surface, m_context)) {
+        std::cerr << "Headless Context: Could not make the context current" << std::endl;
+        destroy();
+        return false;
+    }
+    return true;
+}
+
+void GLHeadlessContext::destroy() {
+    if (m_display == EGL_NO_DISPLAY) {
+        return;
+    }
+
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_surface != EGL_NO_SURFACE) {
+        eglDestroySurface(m_display, m_surface);
+    }
+    if (m_context != EGL_NO_CONTEXT) {
+        eglDestroyContext(m_display, m_context);
+    }
+    eglTerminate(m_display);
+
+    m_display = EGL_NO_DISPLAY;
+    m_context = EGL_NO_CONTEXT;
+    m_surface = EGL_NO_SURFACE;
+}
+
+void* GLHeadlessContext::getProcAddress(const char* name) {
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
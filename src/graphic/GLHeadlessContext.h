@@ -0,0 +1,25 @@
+#ifndef GL_HEADLESS_CONTEXT_H
+#define GL_HEADLESS_CONTEXT_H
+
+#include <EGL/egl.h>
+
+// OpenGL core context without a window, for the benchmark and GPU-less CI machines.
+// Prefers the Mesa surfaceless platform (llvmpipe works without X or a GPU) and falls back to
+// the default EGL display with a 1x1 pbuffer. Rendering goes to framebuffer objects.
+class GLHeadlessContext {
+    public:
+        ~GLHeadlessContext();
+
+        bool create(const int majorVersion, const int minorVersion);
+        void destroy();
+
+        // For gladLoadGLLoader and GLExtensions::load
+        static void* getProcAddress(const char* name);
+
+    private:
+        EGLDisplay m_display { EGL_NO_DISPLAY };
+        EGLContext m_context { EGL_NO_CONTEXT };
+        EGLSurface m_surface { EGL_NO_SURFACE };
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "GLMeshArena.h"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include "GLState.h"
+#include "GLStats.h"
+
+namespace {
+    // Initial capacities, 4 MB of vertices and 1 MB of indices
+    constexpr size_t MIN_VERTEX_BYTES = 4 << 20;
+    constexpr size_t MIN_INDEX_BYTES = 1 << 20;
+}
+
+void GLMeshArena::init() {
+    glGenVertexArrays(1, &m_vao);
+}
+
+bool GLMeshArena::setVertexLayout(const GLVertexLayout::Descriptor& layout) {
+    if (m_layout == &layout) {
+        return true;
+    }
+    if (m_allocationCount > 0) {
+        std::cerr << "Mesh arena: cannot switch to the " << layout.name << " vertex layout while meshes are allocated" << std::endl;
+        return false;
+    }
+
+    // The vertex space is counted in vertices of the old size, start over with empty buffers
+    if (m_vao != 0) {
+        destroy();
+    }
+    m_layout = &layout;
+    return true;
+}
+
+void GLMeshArena::reserve(const size_t vertexCount, const size_t indexBytes) {
+    const auto free_vertices = m_vertexAllocator.getSize() - m_vertexAllocator.getUsed();
+    if (vertexCount > free_vertices) {
+        growVertexBuffer(vertexCount - free_vertices);
+    }
+
+    const auto free_index_bytes = m_indexAllocator.getSize() - m_indexAllocator.getUsed();
+    if (indexBytes > free_index_bytes) {
+        growIndexBuffer(indexBytes - free_index_bytes);
+    }
+}
+
+bool GLMeshArena::allocate(const Vertex* vertices, const size_t vertexCount, const GLuint* indices, const size_t indexCount,
+                           const GLVertexLayout::Quantization& quantization, Allocation& allocation) {
+    allocation = Allocation();
+    if (vertexCount == 0 || indexCount == 0) {
+        return false;
+    }
+
+    const GLenum index_type = getIndexType(vertexCount);
+    const size_t index_size = getIndexSize(vertexCount);
+    const auto index_bytes = indexCount * index_size;
+
+    auto base_vertex = m_vertexAllocator.allocate(vertexCount);
+    if (base_vertex == OffsetAllocator::INVALID_OFFSET) {
+        growVertexBuffer(vertexCount);
+        base_vertex = m_vertexAllocator.allocate(vertexCount);
+    }
+
+    auto index_offset = m_indexAllocator.allocate(index_bytes, index_size);
+    if (index_offset == OffsetAllocator::INVALID_OFFSET) {
+        growIndexBuffer(index_bytes);
+        index_offset = m_indexAllocator.allocate(index_bytes, index_size);
+    }
+
+    if (base_vertex == OffsetAllocator::INVALID_OFFSET || index_offset == OffsetAllocator::INVALID_OFFSET) {
+        std::cerr << "Mesh arena out of space for " << vertexCount << " vertices and " << indexCount << " indices" << std::endl;
+        m_vertexAllocator.free(base_vertex, vertexCount);
+        m_indexAllocator.free(index_offset, index_bytes);
+        return false;
+    }
+
+    const size_t stride = m_layout->stride;
+    m_packedVertices.resize(vertexCount * stride);
+    m_layout->pack(vertices, vertexCount, quantization, m_packedVertices.data());
+
+    // Upload through the copy target so the element buffer binding of the current VAO is left alone
+    auto& state = GLState::getInstance();
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, m_vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, base_vertex * stride, vertexCount * stride, m_packedVertices.data());
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, m_ebo);
+    if (index_type == GL_UNSIGNED_SHORT) {
+        m_shortIndices.assign(indices, indices + indexCount);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset, index_bytes, m_shortIndices.data());
+    }
+    else {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset, index_bytes, indices);
+    }
+
+    allocation.baseVertex = static_cast<uint32_t>(base_vertex);
+    allocation.vertexCount = static_cast<uint32_t>(vertexCount);
+    allocation.firstIndex = static_cast<uint32_t>(index_offset / index_size);
+    allocation.indexCount = static_cast<uint32_t>(indexCount);
+    allocation.indexType = index_type;
+    ++m_allocationCount;
+    return true;
+}
+
+void GLMeshArena::free(Allocation& allocation) {
+    // Ranges handed out before destroy() are gone with the buffers
+    if (!allocation.isValid() || m_vao == 0) {
+        allocation = Allocation();
+        return;
+    }
+
+    m_vertexAllocator.free(allocation.baseVertex, allocation.vertexCount);
+    m_indexAllocator.free(allocation.firstIndex * allocation.getIndexSize(), allocation.indexCount * allocation.getIndexSize());
+    --m_allocationCount;
+    allocation = Allocation();
+}
+
+void GLMeshArena::reserveDrawIds(const size_t drawCount) {
+    if (drawCount <= m_drawIdCount) {
+        return;
+    }
+    if (m_vao == 0) {
+        init();
+    }
+
+    m_drawIdCount = std::max(drawCount, m_drawIdCount * 2);
+    std::vector<GLuint> draw_ids(m_drawIdCount);
+    std::iota(draw_ids.begin(), draw_ids.end(), 0);
+
+    if (m_drawIdBuffer == 0) {
+        glGenBuffers(1, &m_drawIdBuffer);
+    }
+    auto& state = GLState::getInstance();
+    state.bindVertexArray(m_vao);
+    state.bindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, draw_ids.size() * sizeof(GLuint), draw_ids.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+    glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+    glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+    state.bindVertexArray(0);
+}
+
+void GLMeshArena::bind() const {
+    GLState::getInstance().bindVertexArray(m_vao);
+}
+
+void GLMeshArena::unbind() const {
+    GLState::getInstance().bindVertexArray(0);
+}
+
+void GLMeshArena::destroy() {
+    auto& state = GLState::getInstance();
+    state.deleteVertexArrays(1, &m_vao);
+    const GLuint buffers[] = { m_vbo, m_ebo, m_drawIdBuffer };
+    state.deleteBuffers(3, buffers);
+    m_vao = m_vbo = m_ebo = m_drawIdBuffer = 0;
+    m_drawIdCount = 0;
+    std::vector<unsigned char>().swap(m_packedVertices);
+    std::vector<uint16_t>().swap(m_shortIndices);
+
+    m_vertexAllocator.reset(0);
+    m_indexAllocator.reset(0);
+    m_allocationCount = 0;
+}
+
+void GLMeshArena::growVertexBuffer(const size_t vertexCount) {
+    if (m_vao == 0) {
+        init();
+    }
+
+    const size_t stride = m_layout->stride;
+    const auto old_count = m_vertexAllocator.getSize();
+    const auto new_count = std::max({ old_count * 2, old_count + vertexCount, MIN_VERTEX_BYTES / stride });
+    m_vbo = resizeBuffer(m_vbo, old_count * stride, new_count * stride);
+    m_vertexAllocator.grow(new_count);
+
+    // The attribute pointers capture the buffer, point them at the new one
+    auto& state = GLState::getInstance();
+    state.bindVertexArray(m_vao);
+    state.bindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    m_layout->setupAttributes();
+    state.bindVertexArray(0);
+}
+
+void GLMeshArena::growIndexBuffer(const size_t indexBytes) {
+    if (m_vao == 0) {
+        init();
+    }
+
+    const auto old_size = m_indexAllocator.getSize();
+    const auto new_size = std::max({ old_size * 2, old_size + indexBytes, MIN_INDEX_BYTES });
+    m_ebo = resizeBuffer(m_ebo, old_size, new_size);
+    m_indexAllocator.grow(new_size);
+
+    // The element buffer binding is part of the VAO state
+    auto& state = GLState::getInstance();
+    state.bindVertexArray(m_vao);
+    state.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    state.bindVertexArray(0);
+}
+
+GLuint GLMeshArena::resizeBuffer(const GLuint buffer, const size_t oldSize, const size_t newSize) {
+    GLuint new_buffer;
+    glGenBuffers(1, &new_buffer);
+    auto& state = GLState::getInstance();
+    state.bindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+
+    if (buffer != 0) {
+        state.bindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+        state.deleteBuffers(1, &buffer);
+    }
+
+    GLStats::getInstance().countBufferGrowth(newSize);
+    return new_buffer;
+}
@@ -0,0 +1,100 @@
+#ifndef GL_MESH_ARENA_H
+#define GL_MESH_ARENA_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "GLVertexLayout.h"
+#include "../base/Vertex.h"
+#include "../utility/OffsetAllocator.h"
+
+// One vertex buffer, one index buffer and one vertex array shared by every mesh.
+// Meshes sub-allocate ranges and are drawn with glDrawElementsBaseVertex, so drawing a model
+// binds a single VAO instead of one per primitive.
+// Both buffers grow on demand; the old contents are copied on the GPU and allocations keep their offsets.
+// Vertices are packed into one GLVertexLayout on upload, GLVertexLayout::PACKED unless chosen otherwise.
+// Indices are stored in the narrowest type that addresses the allocation's vertices, see getIndexType().
+class GLMeshArena {
+    public:
+        struct Allocation {
+            uint32_t baseVertex { 0 };
+            uint32_t vertexCount { 0 };
+            uint32_t firstIndex { 0 };      // In indices of indexType
+            uint32_t indexCount { 0 };
+            GLenum indexType { GL_UNSIGNED_INT };
+
+            bool isValid() const { return indexCount > 0; }
+            size_t getIndexSize() const { return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(GLuint); }
+            // Byte offset in the index buffer of the allocation's index-th index, as glDrawElements* expects it
+            const void* getIndexOffset(const uint32_t index = 0) const {
+                return reinterpret_cast<const void*>(static_cast<uintptr_t>(firstIndex + index) * getIndexSize());
+            }
+        };
+
+        // GL_UNSIGNED_SHORT when 16 bits address every vertex of a mesh, GL_UNSIGNED_INT otherwise
+        static GLenum getIndexType(const size_t vertexCount) {
+            return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        }
+        static size_t getIndexSize(const size_t vertexCount) {
+            return getIndexType(vertexCount) == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(GLuint);
+        }
+
+        // Instanced attribute holding 0, 1, 2, ... so an indirect command's baseInstance selects its draw
+        static constexpr GLuint DRAW_ID_ATTRIBUTE = 3;
+
+        static auto& getInstance() {
+            static GLMeshArena instance;
+            return instance;
+        }
+
+        // Only while the arena holds no allocations, fails otherwise
+        bool setVertexLayout(const GLVertexLayout::Descriptor& layout);
+        const GLVertexLayout::Descriptor& getVertexLayout() const { return *m_layout; }
+
+        // Makes room for the given number of vertices and bytes of indices with at most one grow per buffer
+        void reserve(const size_t vertexCount, const size_t indexBytes);
+        // quantization maps the positions into the box a quantized layout stores them in, see
+        // GLVertexLayout::Quantization. The shader has to apply the same one.
+        bool allocate(const Vertex* vertices, const size_t vertexCount, const GLuint* indices, const size_t indexCount,
+                      const GLVertexLayout::Quantization& quantization, Allocation& allocation);
+        void free(Allocation& allocation);
+        // Makes draw ids 0 .. drawCount - 1 available through DRAW_ID_ATTRIBUTE
+        void reserveDrawIds(const size_t drawCount);
+
+        void bind() const;
+        void unbind() const;
+        void destroy();
+
+        size_t getVertexBytesUsed() const { return m_vertexAllocator.getUsed() * m_layout->stride; }
+        size_t getVertexBytesCapacity() const { return m_vertexAllocator.getSize() * m_layout->stride; }
+        size_t getIndexBytesUsed() const { return m_indexAllocator.getUsed(); }
+        size_t getIndexBytesCapacity() const { return m_indexAllocator.getSize(); }
+        size_t getAllocationCount() const { return m_allocationCount; }
+
+    private:
+        void init();
+        void growVertexBuffer(const size_t vertexCount);
+        void growIndexBuffer(const size_t indexBytes);
+        GLuint resizeBuffer(const GLuint buffer, const size_t oldSize, const size_t newSize);
+
+        GLuint m_vao { 0 };
+        GLuint m_vbo { 0 };
+        GLuint m_ebo { 0 };
+        GLuint m_drawIdBuffer { 0 };
+        size_t m_drawIdCount { 0 };
+
+        const GLVertexLayout::Descriptor* m_layout { &GLVertexLayout::PACKED };
+        // Packed vertices and narrowed indices of the allocation being uploaded, kept to avoid reallocating per mesh
+        std::vector<unsigned char> m_packedVertices;
+        std::vector<uint16_t> m_shortIndices;
+
+        // Vertex space is counted in vertices so offsets are valid base vertices, index space in bytes
+        OffsetAllocator m_vertexAllocator;
+        OffsetAllocator m_indexAllocator;
+        size_t m_allocationCount { 0 };
+};
+
+#endif
@@ -0,0 +1,125 @@
+#include "GLProgramCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "../utility/Hash.h"
+#include "../utility/MappedFile.h"
+#include "../utility/ResourceManager.h"
+
+bool GLProgramCache::enabled = true;
+
+namespace {
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t binaryFormat;
+        uint32_t binarySize;
+    };
+
+    uint64_t hashString(const char* value, const uint64_t seed) {
+        return Hash::hash64(std::string(value != nullptr ? value : ""), seed);
+    }
+}
+
+bool GLProgramCache::isSupported() {
+    GLint format_count = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+    return enabled && format_count > 0;
+}
+
+uint64_t GLProgramCache::computeKey(const std::vector<std::pair<GLenum, std::string>>& stages) {
+    // A binary is only valid for the exact driver that produced it
+    uint64_t key = hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), 0);
+    key = hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), key);
+    key = hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), key);
+
+    for (const auto& stage : stages) {
+        key = Hash::combine(key, stage.first);
+        key = Hash::hash64(stage.second.data(), stage.second.size(), key);
+    }
+    return key;
+}
+
+std::string GLProgramCache::getCachePath(const uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return ResourceManager::getInstance().getAssetsPath() + "cache/shaders/" + name + ".progbin";
+}
+
+GLuint GLProgramCache::load(const uint64_t key) {
+    MappedFile file;
+    if (!file.open(getCachePath(key)) || file.size() < sizeof(Header)) {
+        return 0;
+    }
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION || header.key != key ||
+        sizeof(Header) + header.binarySize > file.size()) {
+        return 0;
+    }
+
+    const auto program = glCreateProgram();
+    glProgramBinary(program, header.binaryFormat, file.data() + sizeof(Header), static_cast<GLsizei>(header.binarySize));
+
+    // Drivers may reject a binary they wrote themselves, e.g. after an update that kept the version string
+    GLint success { GL_FALSE };
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success == GL_FALSE) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool GLProgramCache::save(const uint64_t key, const GLuint program) {
+    GLint binary_size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+    if (binary_size <= 0) {
+        return false;
+    }
+
+    Header header{ MAGIC, VERSION, key, 0, 0 };
+    std::vector<char> binary(binary_size);
+    GLsizei length = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, binary_size, &length, &format, binary.data());
+    if (length <= 0) {
+        return false;
+    }
+    header.binaryFormat = format;
+    header.binarySize = static_cast<uint32_t>(length);
+
+    const auto cachePath = getCachePath(key);
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    // Write to a temporary file first so a concurrent start never reads a truncated binary
+    const auto temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "Program Cache: Could not create cache file: " << temporaryPath << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(binary.data(), length);
+        if (!out) {
+            std::cerr << "Program Cache: Failed writing cache file: " << temporaryPath << std::endl;
+            return false;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        std::cerr << "Program Cache: Could not move cache file into place: " << cachePath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
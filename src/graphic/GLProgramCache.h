@@ -0,0 +1,35 @@
+#ifndef GL_PROGRAM_CACHE_H
+#define GL_PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary).
+//
+// A program is keyed by the hash of its fully preprocessed stage sources and of the driver's
+// vendor, renderer and version strings, and stored as cache/shaders/<key>.progbin under the assets
+// path. Any source or driver change produces a new key, so a stale binary is never loaded.
+class GLProgramCache {
+    public:
+        static constexpr uint32_t MAGIC = 0x4E425047;   // "GPBN"
+        static constexpr uint32_t VERSION = 1;
+
+        // Turns the cache off, e.g. for tools that must always exercise the compiler
+        static bool enabled;
+
+        static bool isSupported();
+
+        // stages holds the GL stage type and preprocessed source of every stage
+        static uint64_t computeKey(const std::vector<std::pair<GLenum, std::string>>& stages);
+        static std::string getCachePath(const uint64_t key);
+
+        // Creates and returns a program from the cached binary, or 0 if there is no usable binary
+        static GLuint load(const uint64_t key);
+        // The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+        static bool save(const uint64_t key, const GLuint program);
+};
+
+#endif
@@ -1,9 +1,14 @@
 #include "GLShaderProgram.h"
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <unordered_map>
 
 #include "../utility/ResourceManager.h"
+#include "../utility/Hash.h"
+#include "GLProgramCache.h"
+#include "GLState.h"
 
 const std::unordered_map<std::string, int> GL_SHADER_TYPE_ENUM {
     { "vertex", GL_VERTEX_SHADER },
@@ -80,17 +85,32 @@ GLShaderProgram::GLShaderProgram(const std::string program_name, const std::vect
     std::cout << "Building shader program " << program_name << std::endl;
 #endif
 
+    // Preprocess every stage first, the result is also the key of the program binary cache
+    std::vector<std::pair<GLenum, std::string>> sources;
+    for (const auto& stage : stages) {
+        auto shader_code{ ResourceManager::getInstance().loadTextFile(stage.filePath) };
+        scanForIncludes(shader_code);
+        sources.emplace_back(GL_SHADER_TYPE_ENUM.at(stage.type), std::move(shader_code));
+    }
+
+    const bool use_cache = GLProgramCache::isSupported();
+    const auto cache_key = use_cache ? GLProgramCache::computeKey(sources) : 0;
+    if (use_cache) {
+        m_programId = GLProgramCache::load(cache_key);
+        if (m_programId != 0) {
+            reflect();
+            return;
+        }
+    }
+
     std::vector<GLuint> shader_ids;
 
     bool success { true };
     for (auto i = 0; i < stages.size(); ++i) {
-        auto id{ glCreateShader(GL_SHADER_TYPE_ENUM.at(stages[i].type)) };
+        auto id{ glCreateShader(sources[i].first) };
         shader_ids.push_back(id);
 
-        auto shader_code{ ResourceManager::getInstance().loadTextFile(stages[i].filePath) };
-        scanForIncludes(shader_code);
-
-        if (!compileStage(id, stages[i], shader_code)) {
+        if (!compileStage(id, stages[i], sources[i].second)) {
             success = false;
             break;
         }
@@ -110,15 +130,30 @@ GLShaderProgram::GLShaderProgram(const std::string program_name, const std::vect
         glAttachShader(m_programId, id);
     }
 
-    if (!linkProgram(m_programId)) {
-        for (const auto id : shader_ids) {
-            glDetachShader(m_programId, id);
-            glDeleteShader(id);
-        }
+    if (use_cache) {
+        glProgramParameteri(m_programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    const bool linked = linkProgram(m_programId);
+
+    // The linked program keeps its own copy of the code
+    for (const auto id : shader_ids) {
+        glDetachShader(m_programId, id);
+        glDeleteShader(id);
+    }
+
+    if (!linked) {
         glDeleteProgram(m_programId);
+        m_programId = 0;
         std::cout << "Create shader program failed!" << std::endl;
         return;
     }
+
+    if (use_cache) {
+        GLProgramCache::save(cache_key, m_programId);
+    }
+
+    reflect();
 }
 
 GLShaderProgram::~GLShaderProgram() {
@@ -128,16 +163,17 @@ GLShaderProgram::~GLShaderProgram() {
 void GLShaderProgram::bind() const {
     assert(m_programId != 0);
 
-    glUseProgram(m_programId);
+    GLState::getInstance().useProgram(m_programId);
 }
 
-void GLShaderProgram::deleteProgram() const {
+void GLShaderProgram::deleteProgram() {
     if (m_programId != 0) {
 
 #ifdef _DEBUG
     std::cout << "Deleting program: " << m_programName << '\n';
 #endif
-        glDeleteProgram(m_programId);
+        GLState::getInstance().deleteProgram(m_programId);
+        m_programId = 0;
     }
 }
 
@@ -173,6 +209,128 @@ void GLShaderProgram::setUniform(const std::string& uniform_name, const glm::mat
     glUniformMatrix4fv(getUniformLocation(uniform_name), 1, GL_FALSE, value_ptr(value));
 }
 
-GLuint GLShaderProgram::getUniformLocation(const std::string& uniform_name) {
-    return glGetUniformLocation(m_programId, uniform_name.c_str());
+void GLShaderProgram::setUniform(const GLUniform<int>& uniform, const int value) const {
+    glUniform1i(uniform.location, value);
+}
+
+void GLShaderProgram::setUniform(const GLUniform<float>& uniform, const float value) const {
+    glUniform1f(uniform.location, value);
+}
+
+void GLShaderProgram::setUniform(const GLUniform<glm::ivec2>& uniform, const glm::ivec2& value) const {
+    glUniform2iv(uniform.location, 1, &value[0]);
+}
+
+void GLShaderProgram::setUniform(const GLUniform<glm::vec2>& uniform, const glm::vec2& value) const {
+    glUniform2f(uniform.location, value.x, value.y);
+}
+
+void GLShaderProgram::setUniform(const GLUniform<glm::vec3>& uniform, const glm::vec3& value) const {
+    glUniform3f(uniform.location, value.x, value.y, value.z);
+}
+
+void GLShaderProgram::setUniform(const GLUniform<glm::vec4>& uniform, const glm::vec4& value) const {
+    glUniform4f(uniform.location, value.x, value.y, value.z, value.w);
+}
+
+void GLShaderProgram::setUniform(const GLUniform<glm::mat3x3>& uniform, const glm::mat3x3& value) const {
+    glUniformMatrix3fv(uniform.location, 1, GL_FALSE, value_ptr(value));
+}
+
+void GLShaderProgram::setUniform(const GLUniform<glm::mat4x4>& uniform, const glm::mat4x4& value) const {
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, value_ptr(value));
+}
+
+GLint GLShaderProgram::getUniformLocation(const std::string& uniform_name) const {
+    return m_uniforms.find(uniform_name);
+}
+
+GLint GLShaderProgram::getUniformBlockIndex(const std::string& block_name) const {
+    const auto index = m_uniformBlocks.find(block_name);
+    return index >= 0 ? index : static_cast<GLint>(GL_INVALID_INDEX);
+}
+
+void GLShaderProgram::reflect() {
+    GLint count = 0;
+    GLint max_length = 0;
+
+    // Uniforms of the default block, block members have no location
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    std::vector<GLchar> name(std::max(max_length, 1));
+    for (GLint i = 0; i < count; ++i) {
+        GLint size = 0;
+        GLenum type = 0;
+        GLsizei length = 0;
+        glGetActiveUniform(m_programId, static_cast<GLuint>(i), max_length, &length, &size, &type, name.data());
+
+        const std::string uniform_name(name.data(), length);
+        const auto location = glGetUniformLocation(m_programId, uniform_name.c_str());
+        if (location < 0) {
+            continue;
+        }
+        m_uniforms.insert(uniform_name, location);
+
+        // Arrays are reported as "name[0]", make them reachable as "name" and "name[i]"
+        const auto bracket = uniform_name.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == uniform_name.size()) {
+            const auto base_name = uniform_name.substr(0, bracket);
+            m_uniforms.insert(base_name, location);
+            for (GLint element = 1; element < size; ++element) {
+                const auto element_name = base_name + "[" + std::to_string(element) + "]";
+                m_uniforms.insert(element_name, glGetUniformLocation(m_programId, element_name.c_str()));
+            }
+        }
+    }
+
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(m_programId, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+    name.resize(std::max(max_length, 1));
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(m_programId, static_cast<GLuint>(i), max_length, &length, name.data());
+        m_uniformBlocks.insert(std::string(name.data(), length), i);
+    }
+
+    m_uniforms.build();
+    m_uniformBlocks.build();
+}
+
+void GLShaderProgram::NameTable::insert(const std::string& name, const GLint value) {
+    entries.push_back({ name, Hash::hash64(name), value });
+}
+
+void GLShaderProgram::NameTable::build() {
+    // Power of two with at least half the slots empty keeps the probe sequences short
+    size_t slot_count = 1;
+    while (slot_count < entries.size() * 2) {
+        slot_count <<= 1;
+    }
+    slots.assign(slot_count, -1);
+
+    const auto mask = slot_count - 1;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        auto slot = entries[i].hash & mask;
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = static_cast<int32_t>(i);
+    }
+}
+
+GLint GLShaderProgram::NameTable::find(const std::string& name) const {
+    if (entries.empty()) {
+        return -1;
+    }
+
+    const auto hash = Hash::hash64(name);
+    const auto mask = slots.size() - 1;
+    for (auto slot = hash & mask; slots[slot] >= 0; slot = (slot + 1) & mask) {
+        const auto& entry = entries[slots[slot]];
+        if (entry.hash == hash && entry.name == name) {
+            return entry.value;
+        }
+    }
+
+    return -1;
 }
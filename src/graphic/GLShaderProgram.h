@@ -6,18 +6,27 @@
 
 #include <glad/glad.h>
 
-#include <unordered_map>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "ShaderCreateInfo.h"
 
+// Uniform location resolved once, typed so a handle is only set with values of its type
+template <typename T>
+struct GLUniform {
+    GLint location { -1 };
+
+    bool isValid() const { return location >= 0; }
+};
+
 class GLShaderProgram {
     public:
         GLShaderProgram(const std::string program_name, const std::vector<ShaderCreateInfo> stages);
         ~GLShaderProgram();
 
         void bind() const;
-        void deleteProgram() const;
+        void deleteProgram();
 
         void setUniformi(const std::string& uniform_name, const int value);
         void setUniformf(const std::string& uniform_name, const float value);
@@ -28,11 +37,49 @@ class GLShaderProgram {
         void setUniform(const std::string& uniform_name, const glm::mat3x3& value);
         void setUniform(const std::string& uniform_name, const glm::mat4x4& value);
 
+        // Hot paths resolve a handle once and set it without any name lookup
+        template <typename T>
+        GLUniform<T> getUniform(const std::string& uniform_name) const {
+            return { getUniformLocation(uniform_name) };
+        }
+
+        void setUniform(const GLUniform<int>& uniform, const int value) const;
+        void setUniform(const GLUniform<float>& uniform, const float value) const;
+        void setUniform(const GLUniform<glm::ivec2>& uniform, const glm::ivec2& value) const;
+        void setUniform(const GLUniform<glm::vec2>& uniform, const glm::vec2& value) const;
+        void setUniform(const GLUniform<glm::vec3>& uniform, const glm::vec3& value) const;
+        void setUniform(const GLUniform<glm::vec4>& uniform, const glm::vec4& value) const;
+        void setUniform(const GLUniform<glm::mat3x3>& uniform, const glm::mat3x3& value) const;
+        void setUniform(const GLUniform<glm::mat4x4>& uniform, const glm::mat4x4& value) const;
+
+        GLint getUniformLocation(const std::string& uniform_name) const;
+        GLint getUniformBlockIndex(const std::string& block_name) const;
+
     private:
-        GLuint getUniformLocation(const std::string& uniform_name);
+        // Active uniform or uniform block found by the reflection pass
+        struct ReflectedName {
+            std::string name;
+            uint64_t hash;
+            GLint value;    // location, or block index for uniform blocks
+        };
+
+        // Open addressing table over the reflected names, slots hold indices into the entries
+        struct NameTable {
+            std::vector<ReflectedName> entries;
+            std::vector<int32_t> slots;
+
+            void insert(const std::string& name, const GLint value);
+            void build();
+            GLint find(const std::string& name) const;
+        };
+
+        void reflect();
 
         GLuint m_programId { 0 };
         std::string m_programName;
+
+        NameTable m_uniforms;
+        NameTable m_uniformBlocks;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,265 @@
+#include "GLState.h"
+
+#include "GLExtensions.h"
+#include "GLStats.h"
+
+void GLState::useProgram(const GLuint program) {
+    auto& stats = GLStats::getInstance();
+    if (m_program == program) {
+        stats.countSkippedBind();
+        return;
+    }
+    glUseProgram(program);
+    m_program = program;
+    stats.countProgramBind();
+}
+
+void GLState::bindVertexArray(const GLuint vertexArray) {
+    auto& stats = GLStats::getInstance();
+    if (m_vertexArray == vertexArray) {
+        stats.countSkippedBind();
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    m_vertexArray = vertexArray;
+    // The element array binding belongs to the vertex array
+    m_buffers[buffer_element_array] = UNKNOWN;
+    stats.countVertexArrayBind();
+}
+
+void GLState::activeTexture(const GLuint unit) {
+    auto& stats = GLStats::getInstance();
+    if (m_activeTexture == unit) {
+        stats.countSkippedBind();
+        return;
+    }
+    glActiveTexture(GL_TEXTURE0 + unit);
+    m_activeTexture = unit;
+    stats.countTextureBind();
+}
+
+void GLState::bindTexture(const GLenum target, const GLuint texture) {
+    auto& stats = GLStats::getInstance();
+    const int slot = textureSlot(target);
+    if (slot < 0 || m_activeTexture >= TEXTURE_UNITS) {
+        glBindTexture(target, texture);
+        stats.countTextureBind();
+        return;
+    }
+
+    GLuint& bound = m_textures[m_activeTexture][slot];
+    if (bound == texture) {
+        stats.countSkippedBind();
+        return;
+    }
+    glBindTexture(target, texture);
+    bound = texture;
+    stats.countTextureBind();
+}
+
+void GLState::bindTexture(const GLuint unit, const GLenum target, const GLuint texture) {
+    // Only switch units for a bind that is actually issued
+    const int slot = textureSlot(target);
+    if (slot >= 0 && unit < TEXTURE_UNITS && m_textures[unit][slot] == texture) {
+        GLStats::getInstance().countSkippedBind();
+        return;
+    }
+    activeTexture(unit);
+    bindTexture(target, texture);
+}
+
+void GLState::bindBuffer(const GLenum target, const GLuint buffer) {
+    auto& stats = GLStats::getInstance();
+    const int slot = bufferSlot(target);
+    if (slot >= 0 && m_buffers[slot] == buffer) {
+        stats.countSkippedBind();
+        return;
+    }
+    glBindBuffer(target, buffer);
+    if (slot >= 0) {
+        m_buffers[slot] = buffer;
+    }
+    stats.countBufferBind();
+}
+
+void GLState::bindBufferBase(const GLenum target, const GLuint index, const GLuint buffer) {
+    if (recordIndexed(target, index, { buffer, 0, 0 })) {
+        glBindBufferBase(target, index, buffer);
+    }
+}
+
+void GLState::bindBufferRange(const GLenum target, const GLuint index, const GLuint buffer, const GLintptr offset, const GLsizeiptr size) {
+    if (recordIndexed(target, index, { buffer, offset, size })) {
+        glBindBufferRange(target, index, buffer, offset, size);
+    }
+}
+
+void GLState::bindFramebuffer(const GLenum target, const GLuint framebuffer) {
+    auto& stats = GLStats::getInstance();
+    const bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    const bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    if ((!draw || m_drawFramebuffer == framebuffer) && (!read || m_readFramebuffer == framebuffer)) {
+        stats.countSkippedBind();
+        return;
+    }
+    glBindFramebuffer(target, framebuffer);
+    if (draw) {
+        m_drawFramebuffer = framebuffer;
+    }
+    if (read) {
+        m_readFramebuffer = framebuffer;
+    }
+    stats.countFramebufferBind();
+}
+
+void GLState::deleteProgram(const GLuint program) {
+    glDeleteProgram(program);
+    // A program in use is only deleted once another one replaces it, the name must not be trusted anymore
+    if (m_program == program) {
+        m_program = UNKNOWN;
+    }
+}
+
+void GLState::deleteVertexArrays(const GLsizei count, const GLuint* vertexArrays) {
+    glDeleteVertexArrays(count, vertexArrays);
+    for (GLsizei i = 0; i < count; ++i) {
+        if (vertexArrays[i] != 0 && m_vertexArray == vertexArrays[i]) {
+            m_vertexArray = 0;
+            m_buffers[buffer_element_array] = UNKNOWN;
+        }
+    }
+}
+
+void GLState::deleteTextures(const GLsizei count, const GLuint* textures) {
+    glDeleteTextures(count, textures);
+    for (GLsizei i = 0; i < count; ++i) {
+        if (textures[i] == 0) {
+            continue;
+        }
+        for (auto& unit : m_textures) {
+            for (auto& bound : unit) {
+                if (bound == textures[i]) {
+                    bound = 0;
+                }
+            }
+        }
+    }
+}
+
+void GLState::deleteBuffers(const GLsizei count, const GLuint* buffers) {
+    glDeleteBuffers(count, buffers);
+    for (GLsizei i = 0; i < count; ++i) {
+        if (buffers[i] == 0) {
+            continue;
+        }
+        for (auto& bound : m_buffers) {
+            if (bound == buffers[i]) {
+                bound = 0;
+            }
+        }
+        // Whether indexed bindings revert to 0 is up to the driver, look them up again
+        for (auto* bindings : { &m_uniformBuffers, &m_storageBuffers }) {
+            for (auto& binding : *bindings) {
+                if (binding.buffer == buffers[i]) {
+                    binding = IndexedBinding();
+                }
+            }
+        }
+    }
+}
+
+void GLState::deleteFramebuffers(const GLsizei count, const GLuint* framebuffers) {
+    glDeleteFramebuffers(count, framebuffers);
+    for (GLsizei i = 0; i < count; ++i) {
+        if (framebuffers[i] == 0) {
+            continue;
+        }
+        if (m_drawFramebuffer == framebuffers[i]) {
+            m_drawFramebuffer = 0;
+        }
+        if (m_readFramebuffer == framebuffers[i]) {
+            m_readFramebuffer = 0;
+        }
+    }
+}
+
+void GLState::invalidate() {
+    m_program = UNKNOWN;
+    m_vertexArray = UNKNOWN;
+    m_activeTexture = UNKNOWN;
+    for (auto& unit : m_textures) {
+        unit.fill(UNKNOWN);
+    }
+    m_buffers.fill(UNKNOWN);
+    m_uniformBuffers.fill(IndexedBinding());
+    m_storageBuffers.fill(IndexedBinding());
+    m_drawFramebuffer = UNKNOWN;
+    m_readFramebuffer = UNKNOWN;
+}
+
+int GLState::textureSlot(const GLenum target) {
+    switch (target) {
+    case GL_TEXTURE_2D:
+        return texture_2d;
+    case GL_TEXTURE_CUBE_MAP:
+        return texture_cube_map;
+    default:
+        return -1;
+    }
+}
+
+int GLState::bufferSlot(const GLenum target) {
+    switch (target) {
+    case GL_ARRAY_BUFFER:
+        return buffer_array;
+    case GL_ELEMENT_ARRAY_BUFFER:
+        return buffer_element_array;
+    case GL_COPY_READ_BUFFER:
+        return buffer_copy_read;
+    case GL_COPY_WRITE_BUFFER:
+        return buffer_copy_write;
+    case GL_PIXEL_PACK_BUFFER:
+        return buffer_pixel_pack;
+    case GL_PIXEL_UNPACK_BUFFER:
+        return buffer_pixel_unpack;
+    case GL_DRAW_INDIRECT_BUFFER:
+        return buffer_draw_indirect;
+    case GL_UNIFORM_BUFFER:
+        return buffer_uniform;
+    case GL_SHADER_STORAGE_BUFFER:
+        return buffer_shader_storage;
+    default:
+        return -1;
+    }
+}
+
+GLState::IndexedBinding* GLState::indexedBindings(const GLenum target) {
+    switch (target) {
+    case GL_UNIFORM_BUFFER:
+        return m_uniformBuffers.data();
+    case GL_SHADER_STORAGE_BUFFER:
+        return m_storageBuffers.data();
+    default:
+        return nullptr;
+    }
+}
+
+bool GLState::recordIndexed(const GLenum target, const GLuint index, const IndexedBinding& binding) {
+    auto& stats = GLStats::getInstance();
+    auto* bindings = indexedBindings(target);
+    if (bindings && index < INDEXED_BINDINGS) {
+        auto& bound = bindings[index];
+        if (bound.buffer == binding.buffer && bound.offset == binding.offset && bound.size == binding.size) {
+            stats.countSkippedBind();
+            return false;
+        }
+        bound = binding;
+    }
+    // The GL call binds the generic binding point as well
+    const int slot = bufferSlot(target);
+    if (slot >= 0) {
+        m_buffers[slot] = binding.buffer;
+    }
+    stats.countBufferBind();
+    return true;
+}
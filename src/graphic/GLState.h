@@ -0,0 +1,95 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+
+// Shadow copy of the GL bindings: program, vertex array, textures per unit, buffers and framebuffers.
+// Every bind in the renderer goes through here, so calls that would not change anything never
+// reach the driver. Objects must be deleted through here too, the driver unbinds deleted objects
+// and their names are reused. Code binding behind its back (a library, raw GL calls) must restore
+// what it changed or call invalidate() afterwards.
+class GLState {
+    public:
+        // Units and indexed binding points tracked, others are always passed to the driver
+        static constexpr GLuint TEXTURE_UNITS = 16;
+        static constexpr GLuint INDEXED_BINDINGS = 16;
+
+        static auto& getInstance() {
+            static GLState instance;
+            return instance;
+        }
+
+        void useProgram(const GLuint program);
+        void bindVertexArray(const GLuint vertexArray);
+
+        // unit is an index, not GL_TEXTURE0 + index
+        void activeTexture(const GLuint unit);
+        // Binds to the active unit
+        void bindTexture(const GLenum target, const GLuint texture);
+        void bindTexture(const GLuint unit, const GLenum target, const GLuint texture);
+
+        void bindBuffer(const GLenum target, const GLuint buffer);
+        // When issued these also bind the generic binding point of target, like the GL calls.
+        // A skipped one leaves it alone, bind it with bindBuffer() before relying on it.
+        void bindBufferBase(const GLenum target, const GLuint index, const GLuint buffer);
+        void bindBufferRange(const GLenum target, const GLuint index, const GLuint buffer, const GLintptr offset, const GLsizeiptr size);
+
+        void bindFramebuffer(const GLenum target, const GLuint framebuffer);
+
+        void deleteProgram(const GLuint program);
+        void deleteVertexArrays(const GLsizei count, const GLuint* vertexArrays);
+        void deleteTextures(const GLsizei count, const GLuint* textures);
+        void deleteBuffers(const GLsizei count, const GLuint* buffers);
+        void deleteFramebuffers(const GLsizei count, const GLuint* framebuffers);
+
+        // Forgets every binding, the next bind of each is issued. Call when the context changes.
+        void invalidate();
+
+    private:
+        // Never a GL name, marks bindings the cache does not know
+        static constexpr GLuint UNKNOWN = ~0u;
+
+        enum texture_target { texture_2d, texture_cube_map, texture_target_count };
+        enum buffer_target {
+            buffer_array,
+            buffer_element_array,
+            buffer_copy_read,
+            buffer_copy_write,
+            buffer_pixel_pack,
+            buffer_pixel_unpack,
+            buffer_draw_indirect,
+            buffer_uniform,
+            buffer_shader_storage,
+            buffer_target_count
+        };
+
+        struct IndexedBinding {
+            GLuint buffer { UNKNOWN };
+            GLintptr offset { 0 };
+            GLsizeiptr size { 0 };      // 0 for the whole buffer
+        };
+
+        GLState() { invalidate(); }
+
+        static int textureSlot(const GLenum target);
+        static int bufferSlot(const GLenum target);
+        // Indexed bindings of target, null if not tracked
+        IndexedBinding* indexedBindings(const GLenum target);
+        // Records an indexed bind, false if it is already bound and the GL call can be skipped
+        bool recordIndexed(const GLenum target, const GLuint index, const IndexedBinding& binding);
+
+        GLuint m_program;
+        GLuint m_vertexArray;
+        GLuint m_activeTexture;
+        std::array<std::array<GLuint, texture_target_count>, TEXTURE_UNITS> m_textures;
+        std::array<GLuint, buffer_target_count> m_buffers;
+        std::array<IndexedBinding, INDEXED_BINDINGS> m_uniformBuffers;
+        std::array<IndexedBinding, INDEXED_BINDINGS> m_storageBuffers;
+        GLuint m_drawFramebuffer;
+        GLuint m_readFramebuffer;
+};
+
+#endif
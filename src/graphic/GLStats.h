@@ -0,0 +1,61 @@
+#ifndef GL_STATS_H
+#define GL_STATS_H
+
+#include <cstdint>
+
+// Counts of the draw and state-changing GL calls issued by the renderer.
+// The counters only ever grow; callers snapshot them around the work they want to measure.
+// Binds go through GLState, which counts the ones it issues here and the redundant ones it skips.
+class GLStats {
+    public:
+        static auto& getInstance() {
+            static GLStats instance;
+            return instance;
+        }
+
+        struct Counters {
+            uint64_t drawCalls { 0 };           // glDraw* calls, a multi-draw counts once
+            uint64_t drawCommands { 0 };        // primitives drawn, every command of a multi-draw counts
+            uint64_t programBinds { 0 };
+            uint64_t vertexArrayBinds { 0 };
+            uint64_t textureBinds { 0 };        // glBindTexture and the glActiveTexture unit switches it needs
+            uint64_t bufferBinds { 0 };
+            uint64_t framebufferBinds { 0 };
+            uint64_t skippedBinds { 0 };        // binds of what was already bound, never reached the driver
+            uint64_t bufferGrowths { 0 };       // buffers reallocated larger and copied over, see GLMeshArena
+            uint64_t bufferGrowthBytes { 0 };   // size of the new allocations
+
+            uint64_t getStateChanges() const { return programBinds + vertexArrayBinds + textureBinds + bufferBinds + framebufferBinds; }
+
+            Counters operator-(const Counters& other) const {
+                return {
+                    drawCalls - other.drawCalls,
+                    drawCommands - other.drawCommands,
+                    programBinds - other.programBinds,
+                    vertexArrayBinds - other.vertexArrayBinds,
+                    textureBinds - other.textureBinds,
+                    bufferBinds - other.bufferBinds,
+                    framebufferBinds - other.framebufferBinds,
+                    skippedBinds - other.skippedBinds,
+                    bufferGrowths - other.bufferGrowths,
+                    bufferGrowthBytes - other.bufferGrowthBytes
+                };
+            }
+        };
+
+        void countDraw(const uint64_t commands = 1) { ++m_counters.drawCalls; m_counters.drawCommands += commands; }
+        void countProgramBind() { ++m_counters.programBinds; }
+        void countVertexArrayBind() { ++m_counters.vertexArrayBinds; }
+        void countTextureBind(const uint64_t count = 1) { m_counters.textureBinds += count; }
+        void countBufferBind(const uint64_t count = 1) { m_counters.bufferBinds += count; }
+        void countFramebufferBind() { ++m_counters.framebufferBinds; }
+        void countSkippedBind() { ++m_counters.skippedBinds; }
+        void countBufferGrowth(const uint64_t bytes) { ++m_counters.bufferGrowths; m_counters.bufferGrowthBytes += bytes; }
+
+        const Counters& getCounters() const { return m_counters; }
+
+    private:
+        Counters m_counters;
+};
+
+#endif
@@ -0,0 +1,450 @@
+#include "GLTextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "../utility/Profiler.h"
+#include "../utility/ThreadPool.h"
+
+namespace {
+    // A single upload never takes more than this share of the ring, so a full level can't block it
+    constexpr size_t MAX_CHUNK = GLTextureStreamer::RING_SIZE / 4;
+    constexpr GLuint64 FENCE_TIMEOUT = 1000000000;  // nanoseconds
+
+    int levelCount(const int width, const int height) {
+        int levels = 1;
+        for (int size = std::max(width, height); size > 1; size /= 2) {
+            ++levels;
+        }
+        return levels;
+    }
+
+    size_t levelBytes(const int width, const int height, const int level) {
+        return static_cast<size_t>(std::max(1, width >> level)) * std::max(1, height >> level) * 4;
+    }
+}
+
+GLuint GLTextureStreamer::createTexture(const unsigned char* pixels, const int width, const int height, const int components, std::shared_ptr<const void> owner) {
+    if (!pixels || width <= 0 || height <= 0 || components < 1 || components > 4) {
+        std::cerr << "Texture Streamer: Invalid image " << width << "x" << height << "x" << components << std::endl;
+        return 0;
+    }
+    init();
+
+    const int levels = levelCount(width, height);
+    GLuint texture;
+    glGenTextures(1, &texture);
+    // Unit 0 is where the model textures are drawn from, the others keep the lighting bound
+    GLState::getInstance().bindTexture(0, GL_TEXTURE_2D, texture);
+    // Under mip residency levels come and go, which needs mutable storage
+    if (!m_mipResidency) {
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, width, height);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Placeholder: only the 1x1 level is sampled until finer levels are complete
+    const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+    if (m_mipResidency) {
+        glTexImage2D(GL_TEXTURE_2D, levels - 1, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, levels - 1, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    auto job = std::make_shared<Job>();
+    job->texture = texture;
+    job->pixels = pixels;
+    job->width = width;
+    job->height = height;
+    job->components = components;
+    job->owner = std::move(owner);
+    job->residentLevel = levels - 1;
+    if (m_mipResidency) {
+        job->managed = true;
+        job->targetLevel = tailLevel(*job);
+        m_managed[texture] = job;
+        m_residentBytes += levelBytes(width, height, levels - 1);
+        m_fullChainBytes += getTextureBytes(width, height);
+    }
+
+    m_decoding.push_back(job);
+    ThreadPool::getInstance().submit([this, job]() {
+        Profiler::CpuZone zone("Texture mips");
+        buildLevels(*job);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoded.push_back(job);
+        }
+        m_decodedCondition.notify_one();
+    });
+    return texture;
+}
+
+size_t GLTextureStreamer::getTextureBytes(const int width, const int height) {
+    size_t bytes = 0;
+    for (int level = 0; level < levelCount(width, height); ++level) {
+        bytes += levelBytes(width, height, level);
+    }
+    return bytes;
+}
+
+int GLTextureStreamer::tailLevel(const Job& job) {
+    int level = 0;
+    while (std::max(job.width >> level, job.height >> level) > RESIDENT_TAIL_SIZE) {
+        ++level;
+    }
+    return level;
+}
+
+int GLTextureStreamer::requiredLevel(const Job& job, const float pixelsPerUV) {
+    // One texel per pixel: every level halves the texels per unit of texture coordinates
+    const float texels_per_uv = std::sqrt(static_cast<float>(job.width) * static_cast<float>(job.height));
+    const float ratio = texels_per_uv / pixelsPerUV;
+    if (!(ratio > 1.0f)) {
+        return 0;
+    }
+    return std::min(static_cast<int>(std::floor(std::log2(ratio))), levelCount(job.width, job.height) - 1);
+}
+
+void GLTextureStreamer::requestResolution(const GLuint texture, const float pixelsPerUV) {
+    const auto it = m_managed.find(texture);
+    if (it != m_managed.end()) {
+        it->second->requested = std::max(it->second->requested, pixelsPerUV);
+    }
+}
+
+void GLTextureStreamer::buildLevels(Job& job) {
+    job.levels.resize(levelCount(job.width, job.height));
+
+    // Level 0 is uploaded straight from the caller's pixels when they already are RGBA
+    Level& base = job.levels[0];
+    base.width = job.width;
+    base.height = job.height;
+    if (job.components == 4) {
+        base.pixels = job.pixels;
+    }
+    else {
+        const size_t texel_count = static_cast<size_t>(job.width) * job.height;
+        base.storage.resize(texel_count * 4);
+        for (size_t i = 0; i < texel_count; ++i) {
+            const unsigned char* source = job.pixels + i * job.components;
+            unsigned char* target = &base.storage[i * 4];
+            // Grey (and grey-alpha) images replicate their first channel like GL_LUMINANCE did
+            target[0] = source[0];
+            target[1] = job.components >= 3 ? source[1] : source[0];
+            target[2] = job.components >= 3 ? source[2] : source[0];
+            target[3] = job.components == 2 ? source[1] : job.components == 4 ? source[3] : 255;
+        }
+        base.pixels = base.storage.data();
+    }
+
+    // 2x2 box filter, the last row or column is repeated for odd sizes
+    for (size_t l = 1; l < job.levels.size(); ++l) {
+        const Level& source = job.levels[l - 1];
+        Level& level = job.levels[l];
+        level.width = std::max(1, source.width / 2);
+        level.height = std::max(1, source.height / 2);
+        level.storage.resize(static_cast<size_t>(level.width) * level.height * 4);
+        for (int y = 0; y < level.height; ++y) {
+            const int y0 = std::min(y * 2, source.height - 1);
+            const int y1 = std::min(y * 2 + 1, source.height - 1);
+            for (int x = 0; x < level.width; ++x) {
+                const int x0 = std::min(x * 2, source.width - 1);
+                const int x1 = std::min(x * 2 + 1, source.width - 1);
+                const unsigned char* texels[4] = {
+                    source.pixels + (static_cast<size_t>(y0) * source.width + x0) * 4,
+                    source.pixels + (static_cast<size_t>(y0) * source.width + x1) * 4,
+                    source.pixels + (static_cast<size_t>(y1) * source.width + x0) * 4,
+                    source.pixels + (static_cast<size_t>(y1) * source.width + x1) * 4
+                };
+                unsigned char* target = &level.storage[(static_cast<size_t>(y) * level.width + x) * 4];
+                for (int c = 0; c < 4; ++c) {
+                    target[c] = static_cast<unsigned char>((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                }
+            }
+        }
+        level.pixels = level.storage.data();
+    }
+}
+
+void GLTextureStreamer::init() {
+    if (m_ring) {
+        return;
+    }
+
+    glGenBuffers(1, &m_ring);
+    auto& state = GLState::getInstance();
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ring);
+    const auto& extensions = GLExtensions::getInstance();
+    if (extensions.supportsBufferStorage()) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        extensions.bufferStorage(GL_PIXEL_UNPACK_BUFFER, RING_SIZE, nullptr, flags);
+        m_ringData = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, RING_SIZE, flags));
+        if (!m_ringData) {
+            std::cerr << "Texture Streamer: Could not map the staging ring persistently" << std::endl;
+        }
+    }
+    if (!m_ringData) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, RING_SIZE, nullptr, GL_STREAM_DRAW);
+    }
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_ringHead = 0;
+}
+
+void GLTextureStreamer::update() {
+    if (m_decoding.empty() && m_uploads.empty() && m_managed.empty()) {
+        return;
+    }
+
+    Profiler::CpuZone zone("Texture streaming");
+    retireFences(false);
+    collectDecoded(false);
+    updateResidency();
+    upload(m_frameBudget, false);
+}
+
+void GLTextureStreamer::updateResidency() {
+    for (auto& entry : m_managed) {
+        const auto& job_pointer = entry.second;
+        Job& job = *job_pointer;
+        const float requested = job.requested;
+        job.requested = 0.0f;
+        if (!job.decoded) {
+            continue;
+        }
+
+        const int tail = tailLevel(job);
+        const int wanted = requested > 0.0f ? std::min(requiredLevel(job, requested), tail) : tail;
+        if (wanted < job.residentLevel) {
+            job.idleFrames = 0;
+            job.targetLevel = wanted;
+            if (!job.queued) {
+                job.queued = true;
+                job.nextLevel = job.residentLevel - 1;
+                job.nextRow = 0;
+                m_uploads.push_back(job_pointer);
+            }
+        }
+        else if (wanted > job.residentLevel) {
+            // Finer levels still in the queue are skipped, the ones resident go after a grace period
+            job.targetLevel = wanted;
+            if (!job.queued && ++job.idleFrames >= DROP_FRAMES) {
+                releaseLevels(job, wanted);
+            }
+        }
+        else {
+            job.idleFrames = 0;
+        }
+    }
+}
+
+void GLTextureStreamer::releaseLevels(Job& job, const int level) {
+    GLState::getInstance().bindTexture(0, GL_TEXTURE_2D, job.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    for (int l = job.residentLevel; l < level; ++l) {
+        // An empty image frees the level, the levels below the base level are not sampled
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        m_residentBytes -= levelBytes(job.width, job.height, l);
+    }
+    job.residentLevel = level;
+    job.idleFrames = 0;
+}
+
+void GLTextureStreamer::finish() {
+    while (getPendingCount() > 0) {
+        retireFences(false);
+        collectDecoded(true);
+        upload(std::numeric_limits<size_t>::max(), true);
+    }
+}
+
+void GLTextureStreamer::cancel(const GLuint texture) {
+    // Jobs still on a worker are dropped when they come back
+    for (auto& job : m_decoding) {
+        if (job->texture == texture) {
+            job->cancelled = true;
+        }
+    }
+    m_uploads.erase(std::remove_if(m_uploads.begin(), m_uploads.end(), [texture](const std::shared_ptr<Job>& job) {
+        return job->texture == texture;
+    }), m_uploads.end());
+
+    const auto it = m_managed.find(texture);
+    if (it != m_managed.end()) {
+        const Job& job = *it->second;
+        for (int level = job.residentLevel; level < levelCount(job.width, job.height); ++level) {
+            m_residentBytes -= levelBytes(job.width, job.height, level);
+        }
+        // A level being uploaded is allocated too
+        if (job.queued && job.nextRow > 0) {
+            m_residentBytes -= levelBytes(job.width, job.height, job.nextLevel);
+        }
+        m_fullChainBytes -= getTextureBytes(job.width, job.height);
+        m_managed.erase(it);
+    }
+}
+
+void GLTextureStreamer::destroy() {
+    for (auto& fence : m_fences) {
+        glDeleteSync(fence.sync);
+    }
+    m_fences.clear();
+    if (m_ring) {
+        auto& state = GLState::getInstance();
+        if (m_ringData) {
+            state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ring);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        state.deleteBuffers(1, &m_ring);
+    }
+    m_ring = 0;
+    m_ringData = nullptr;
+    m_uploads.clear();
+    m_managed.clear();
+    m_residentBytes = 0;
+    m_fullChainBytes = 0;
+}
+
+void GLTextureStreamer::collectDecoded(const bool wait) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (wait && m_uploads.empty()) {
+        m_decodedCondition.wait(lock, [this]() { return !m_decoded.empty() || m_decoding.empty(); });
+    }
+    for (auto& job : m_decoded) {
+        m_decoding.erase(std::find(m_decoding.begin(), m_decoding.end(), job));
+        if (job->cancelled) {
+            continue;
+        }
+        job->decoded = true;
+        job->queued = true;
+        job->nextLevel = static_cast<int>(job->levels.size()) - 1;
+        job->nextRow = 0;
+        m_uploads.push_back(std::move(job));
+    }
+    m_decoded.clear();
+}
+
+void GLTextureStreamer::retireFences(const bool wait) {
+    while (!m_fences.empty()) {
+        const GLenum status = glClientWaitSync(m_fences.front().sync, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? FENCE_TIMEOUT : 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return;
+        }
+        glDeleteSync(m_fences.front().sync);
+        m_fences.pop_front();
+        if (wait) {
+            return;
+        }
+    }
+}
+
+bool GLTextureStreamer::allocateStaging(const size_t size, const bool wait, size_t& offset) {
+    while (true) {
+        offset = m_ringHead + size <= RING_SIZE ? m_ringHead : 0;
+        const bool overlaps = std::any_of(m_fences.begin(), m_fences.end(), [&](const Fence& fence) {
+            return offset < fence.end && fence.begin < offset + size;
+        });
+        if (!overlaps) {
+            return true;
+        }
+        if (!wait) {
+            return false;
+        }
+        retireFences(true);
+    }
+}
+
+bool GLTextureStreamer::upload(size_t budget, const bool wait) {
+    if (m_uploads.empty()) {
+        return true;
+    }
+
+    auto& state = GLState::getInstance();
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ring);
+    size_t spent = 0;
+    bool has_space = true;
+    while (!m_uploads.empty() && spent < budget) {
+        Job& job = *m_uploads.front();
+        if (job.nextRow == 0 && job.nextLevel < job.targetLevel) {
+            // No longer wanted, mip residency lowered the target
+            job.queued = false;
+            m_uploads.pop_front();
+            continue;
+        }
+        const Level& level = job.levels[job.nextLevel];
+        const size_t row_bytes = static_cast<size_t>(level.width) * 4;
+        const size_t max_bytes = std::min(budget - spent, MAX_CHUNK);
+        int rows = std::min(level.height - job.nextRow, static_cast<int>(std::min<size_t>(max_bytes / row_bytes, std::numeric_limits<int>::max())));
+        if (rows == 0) {
+            // Always make progress, even with a budget below one row
+            if (spent > 0) {
+                break;
+            }
+            rows = 1;
+        }
+
+        const size_t size = rows * row_bytes;
+        size_t offset = 0;
+        if (!allocateStaging(size, wait, offset)) {
+            has_space = false;
+            break;
+        }
+
+        const unsigned char* source = level.pixels + job.nextRow * row_bytes;
+        if (m_ringData) {
+            std::memcpy(m_ringData + offset, source, size);
+        }
+        else {
+            void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (!mapped) {
+                std::cerr << "Texture Streamer: Could not map the staging ring" << std::endl;
+                has_space = false;
+                break;
+            }
+            std::memcpy(mapped, source, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        state.bindTexture(0, GL_TEXTURE_2D, job.texture);
+        if (job.managed && job.nextRow == 0 && job.nextLevel < job.residentLevel) {
+            // Allocate the level before its first rows arrive, from the unpack buffer's null offset
+            state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glTexImage2D(GL_TEXTURE_2D, job.nextLevel, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_ring);
+            m_residentBytes += levelBytes(job.width, job.height, job.nextLevel);
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, job.nextLevel, 0, job.nextRow, level.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<void*>(offset));
+        m_fences.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), offset, offset + size });
+        m_ringHead = offset + size;
+        spent += size;
+        m_uploadedBytes += size;
+
+        job.nextRow += rows;
+        if (job.nextRow == level.height) {
+            // The level is complete, sample from it on
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, job.nextLevel);
+            job.residentLevel = std::min(job.residentLevel, job.nextLevel);
+            job.nextRow = 0;
+            if (job.nextLevel <= job.targetLevel) {
+                job.queued = false;
+                m_uploads.pop_front();
+            }
+            else {
+                --job.nextLevel;
+            }
+        }
+    }
+    // Uploads from client memory elsewhere would read from the ring otherwise
+    state.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return has_space;
+}
@@ -0,0 +1,151 @@
+#ifndef GL_TEXTURE_STREAMER_H
+#define GL_TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Uploads textures in the background without stalling the frame.
+// createTexture() allocates the full mip chain right away and fills only its 1x1 level with a grey
+// placeholder, so the texture can be bound immediately. A worker converts the pixels to RGBA and
+// builds the mip chain, then update() streams the levels coarsest first through a ring of pixel
+// unpack buffers, a bounded number of bytes per frame. GL_TEXTURE_BASE_LEVEL follows the finest
+// complete level, so the texture sharpens as data arrives. The ring is persistently mapped when the
+// driver supports buffer storage (GL 4.4) and mapped unsynchronized per upload otherwise; fences
+// keep the CPU from overwriting staging memory the GPU has not consumed yet.
+//
+// With mip residency on, textures keep only the levels the view needs in video memory. They use mutable
+// storage so levels can be allocated and released one at a time. Only the mip tail is uploaded up front.
+// Finer levels are streamed in when requestResolution() asks for them and released again once nothing
+// has needed them for a while. The decoded levels stay in system memory to be streamed again.
+class GLTextureStreamer {
+    public:
+        static constexpr size_t RING_SIZE = 32 * 1024 * 1024;
+        static constexpr size_t DEFAULT_FRAME_BUDGET = 8 * 1024 * 1024;
+        // Levels up to this size stay resident under mip residency
+        static constexpr int RESIDENT_TAIL_SIZE = 64;
+        // Frames a level stays resident after the last request that needed it
+        static constexpr uint32_t DROP_FRAMES = 60;
+
+        static auto& getInstance() {
+            static GLTextureStreamer instance;
+            return instance;
+        }
+
+        // pixels are 8-bit with 1 to 4 components and must stay valid until the texture is resident;
+        // owner is held until then, pass whatever keeps them alive
+        GLuint createTexture(const unsigned char* pixels, const int width, const int height, const int components, std::shared_ptr<const void> owner);
+
+        // Uploads up to the frame budget, call once per frame on the GL thread
+        void update();
+        // Blocks until every queued texture is resident
+        void finish();
+        // Drops the remaining uploads of a texture, call before deleting one that may still be streaming
+        void cancel(const GLuint texture);
+        // Releases the staging ring, call before the GL context goes away
+        void destroy();
+
+        // Applies to textures created afterwards
+        void setMipResidency(const bool enabled) { m_mipResidency = enabled; }
+        bool getMipResidency() const { return m_mipResidency; }
+        // pixelsPerUV is the size on screen, in pixels, of one unit of texture coordinates where the texture
+        // is drawn this frame. The largest request of a frame sets the finest level to keep.
+        // Only affects textures created with mip residency.
+        void requestResolution(const GLuint texture, const float pixelsPerUV);
+
+        void setFrameBudget(const size_t bytes) { m_frameBudget = bytes; }
+        size_t getFrameBudget() const { return m_frameBudget; }
+
+        // Textures still showing the placeholder or a coarser level than their finest
+        size_t getPendingCount() const { return m_decoding.size() + m_uploads.size(); }
+        uint64_t getUploadedBytes() const { return m_uploadedBytes; }
+        // Video memory of the textures under mip residency: allocated levels, and their full mip chains
+        size_t getResidentBytes() const { return m_residentBytes; }
+        size_t getFullChainBytes() const { return m_fullChainBytes; }
+
+        // Video memory of a texture made by createTexture(), RGBA8 with every level
+        static size_t getTextureBytes(const int width, const int height);
+
+    private:
+        struct Level {
+            std::vector<unsigned char> storage;
+            const unsigned char* pixels { nullptr };    // into storage, or the caller's pixels for level 0
+            int width { 0 };
+            int height { 0 };
+        };
+
+        struct Job {
+            GLuint texture { 0 };
+            const unsigned char* pixels { nullptr };
+            int width { 0 };
+            int height { 0 };
+            int components { 0 };
+            std::shared_ptr<const void> owner;
+
+            std::vector<Level> levels;      // filled by the worker
+            int nextLevel { 0 };            // uploaded from levels.size() - 1 down to 0
+            int nextRow { 0 };
+            bool cancelled { false };       // GL thread only
+
+            // GL thread only, mip residency keeps managed jobs after their upload
+            bool managed { false };
+            bool decoded { false };
+            bool queued { false };          // in m_uploads
+            int targetLevel { 0 };          // finest level to upload
+            int residentLevel { 0 };        // finest complete level, the base level
+            float requested { 0.0f };       // largest pixels per UV unit asked for this frame
+            uint32_t idleFrames { 0 };      // frames without a request for the finest resident level
+        };
+
+        // Staging range in flight, reusable once its fence signals
+        struct Fence {
+            GLsync sync;
+            size_t begin;
+            size_t end;
+        };
+
+        static void buildLevels(Job& job);
+
+        static int tailLevel(const Job& job);
+        // Finest level worth sampling at pixelsPerUV
+        static int requiredLevel(const Job& job, const float pixelsPerUV);
+
+        void init();
+        void collectDecoded(const bool wait);
+        // Queues the levels requested this frame and releases the ones not needed anymore
+        void updateResidency();
+        void releaseLevels(Job& job, const int level);
+        // Uploads up to budget bytes, returns false if the ring had no free space left
+        bool upload(size_t budget, const bool wait);
+        bool allocateStaging(const size_t size, const bool wait, size_t& offset);
+        void retireFences(const bool wait);
+
+        size_t m_frameBudget { DEFAULT_FRAME_BUDGET };
+        bool m_mipResidency { false };
+
+        // Handed over from the workers
+        std::mutex m_mutex;
+        std::condition_variable m_decodedCondition;
+        std::vector<std::shared_ptr<Job>> m_decoded;
+
+        // GL thread only
+        std::vector<std::shared_ptr<Job>> m_decoding;
+        std::deque<std::shared_ptr<Job>> m_uploads;
+        GLuint m_ring { 0 };
+        unsigned char* m_ringData { nullptr };      // persistent mapping, null without buffer storage
+        size_t m_ringHead { 0 };
+        std::deque<Fence> m_fences;
+        uint64_t m_uploadedBytes { 0 };
+        std::unordered_map<GLuint, std::shared_ptr<Job>> m_managed;
+        size_t m_residentBytes { 0 };
+        size_t m_fullChainBytes { 0 };
+};
+
+#endif
@@ -1,23 +1,28 @@
 #include "GLVertexArray.h"
 
+#include "GLState.h"
+
 void GLVertexArray::init() {
     glGenVertexArrays(1, &m_vao);
 }
 
-void GLVertexArray::attachBuffer(const buffer_type type, const size_t size, const draw_mode mode, const void* data) {
+GLuint GLVertexArray::attachBuffer(const buffer_type type, const size_t size, const draw_mode mode, const void* data) {
     GLuint buffer;
     glGenBuffers(1, &buffer);
 
-    glBindBuffer(type, buffer);
+    GLState::getInstance().bindBuffer(type, buffer);
     glBufferData(type, size, data, mode);
+
+    m_buffers.push_back(buffer);
+    return buffer;
 }
 
 void GLVertexArray::bind() const {
-    glBindVertexArray(m_vao);
+    GLState::getInstance().bindVertexArray(m_vao);
 }
 
 void GLVertexArray::unbind() const {
-    glBindVertexArray(0);
+    GLState::getInstance().bindVertexArray(0);
 }
 
 void GLVertexArray::enableAttribute(const GLuint index, const int size, const GLuint offset, const void* data) {
@@ -26,5 +31,12 @@ void GLVertexArray::enableAttribute(const GLuint index, const int size, const GL
 }
 
 void GLVertexArray::destroy() {
-    glDeleteVertexArrays(1, &m_vao);
+    auto& state = GLState::getInstance();
+    state.deleteVertexArrays(1, &m_vao);
+    m_vao = 0;
+
+    if (!m_buffers.empty()) {
+        state.deleteBuffers(static_cast<GLsizei>(m_buffers.size()), m_buffers.data());
+        m_buffers.clear();
+    }
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <glad/glad.h>
 
+#include <cstddef>
+#include <vector>
+
 class GLVertexArray {
     public:
         enum buffer_type : int {
@@ -17,7 +20,8 @@ class GLVertexArray {
         };
 
         void init();
-        void attachBuffer(const buffer_type type, const size_t size, const draw_mode mode, const void* data);
+        // The vertex array owns the buffer and deletes it in destroy()
+        GLuint attachBuffer(const buffer_type type, const size_t size, const draw_mode mode, const void* data);
         void bind() const;
         void unbind() const;
         void enableAttribute(const GLuint index, const int size, const GLuint offset, const void* data);
@@ -25,6 +29,7 @@ class GLVertexArray {
 
     private:
         GLuint m_vao { 0 };
+        std::vector<GLuint> m_buffers;
 };
 
 #endif
\ No newline at end of file
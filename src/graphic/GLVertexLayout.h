@@ -0,0 +1,177 @@
+#ifndef GL_VERTEX_LAYOUT_H
+#define GL_VERTEX_LAYOUT_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "../base/Vertex.h"
+
+// GPU vertex formats described at compile time. A layout is a list of attributes, each a shader
+// location, the Vertex member it is packed from and a format. The offsets and the stride, the loop
+// packing Vertex data and the attribute pointer setup are all generated from that one list, so the
+// CPU and GL sides of a layout always agree.
+//
+// Every format reads as the same GLSL type as the float one it replaces (vec3 positions and normals,
+// vec2 texture coordinates), so mesh.vert works with any layout. Quantized positions are the one
+// exception: they arrive in [0, 1] and the shader maps them back with offset + position * scale.
+namespace GLVertexLayout {
+    // Per mesh packing parameters. Positions of a quantized layout are stored relative to this box.
+    struct Quantization {
+        glm::vec3 offset { 0.0f };
+        glm::vec3 scale { 1.0f };
+    };
+
+    // Attribute formats: their GL description, their size including padding to 4 bytes, and how to pack one value
+
+    struct Float3 {
+        static constexpr GLint COMPONENTS = 3;
+        static constexpr GLenum TYPE = GL_FLOAT;
+        static constexpr GLboolean NORMALIZED = GL_FALSE;
+        static constexpr GLuint SIZE = 12;
+        static constexpr bool QUANTIZED = false;
+
+        static void pack(const glm::vec3& value, const Quantization&, unsigned char* out) {
+            std::memcpy(out, &value[0], SIZE);
+        }
+    };
+
+    struct Float2 {
+        static constexpr GLint COMPONENTS = 2;
+        static constexpr GLenum TYPE = GL_FLOAT;
+        static constexpr GLboolean NORMALIZED = GL_FALSE;
+        static constexpr GLuint SIZE = 8;
+        static constexpr bool QUANTIZED = false;
+
+        static void pack(const glm::vec2& value, const Quantization&, unsigned char* out) {
+            std::memcpy(out, &value[0], SIZE);
+        }
+    };
+
+    // 16-bit unsigned normalized position in the quantization box, 1/65535 of its extent per step.
+    // The fourth component is padding.
+    struct Unorm16Position {
+        static constexpr GLint COMPONENTS = 3;
+        static constexpr GLenum TYPE = GL_UNSIGNED_SHORT;
+        static constexpr GLboolean NORMALIZED = GL_TRUE;
+        static constexpr GLuint SIZE = 8;
+        static constexpr bool QUANTIZED = true;
+
+        static void pack(const glm::vec3& value, const Quantization& quantization, unsigned char* out) {
+            const glm::vec3 inverse_scale = glm::vec3(
+                quantization.scale.x != 0.0f ? 1.0f / quantization.scale.x : 0.0f,
+                quantization.scale.y != 0.0f ? 1.0f / quantization.scale.y : 0.0f,
+                quantization.scale.z != 0.0f ? 1.0f / quantization.scale.z : 0.0f);
+            const uint64_t packed = glm::packUnorm4x16(glm::vec4((value - quantization.offset) * inverse_scale, 0.0f));
+            std::memcpy(out, &packed, SIZE);
+        }
+    };
+
+    // Unit vector as signed normalized 10:10:10:2, about 0.1 degree of error. The 2-bit w is left
+    // for the handedness of a tangent.
+    struct Snorm10Direction {
+        static constexpr GLint COMPONENTS = 4;     // Packed types are always read as four components
+        static constexpr GLenum TYPE = GL_INT_2_10_10_10_REV;
+        static constexpr GLboolean NORMALIZED = GL_TRUE;
+        static constexpr GLuint SIZE = 4;
+        static constexpr bool QUANTIZED = false;
+
+        static void pack(const glm::vec3& value, const Quantization&, unsigned char* out) {
+            const uint32_t packed = glm::packSnorm3x10_1x2(glm::vec4(value, 0.0f));
+            std::memcpy(out, &packed, SIZE);
+        }
+    };
+
+    // Half floats: exact steps of 1/2048 in [0, 1], coarser for coordinates that repeat far outside it
+    struct Half2 {
+        static constexpr GLint COMPONENTS = 2;
+        static constexpr GLenum TYPE = GL_HALF_FLOAT;
+        static constexpr GLboolean NORMALIZED = GL_FALSE;
+        static constexpr GLuint SIZE = 4;
+        static constexpr bool QUANTIZED = false;
+
+        static void pack(const glm::vec2& value, const Quantization&, unsigned char* out) {
+            const uint32_t packed = glm::packHalf2x16(value);
+            std::memcpy(out, &packed, SIZE);
+        }
+    };
+
+    // Field is a pointer to the Vertex member the attribute is packed from, e.g. &Vertex::Normal
+    template <GLuint Location, auto Field, typename Format>
+    struct Attribute {
+        static constexpr GLuint LOCATION = Location;
+        using AttributeFormat = Format;
+
+        static void pack(const Vertex& vertex, const Quantization& quantization, unsigned char* out) {
+            Format::pack(vertex.*Field, quantization, out);
+        }
+    };
+
+    template <typename... Attributes>
+    struct Layout {
+        static constexpr GLuint STRIDE = (Attributes::AttributeFormat::SIZE + ...);
+        static constexpr bool QUANTIZED_POSITION = (Attributes::AttributeFormat::QUANTIZED || ...);
+
+        // Writes count vertices of STRIDE bytes each to out
+        static void pack(const Vertex* vertices, const size_t count, const Quantization& quantization, void* out) {
+            auto* vertex_out = static_cast<unsigned char*>(out);
+            for (size_t v = 0; v < count; ++v, vertex_out += STRIDE) {
+                unsigned char* attribute_out = vertex_out;
+                ((Attributes::pack(vertices[v], quantization, attribute_out), attribute_out += Attributes::AttributeFormat::SIZE), ...);
+            }
+        }
+
+        // Points the attributes of the bound vertex array at the buffer bound to GL_ARRAY_BUFFER
+        static void setupAttributes() {
+            size_t offset = 0;
+            ((setupAttribute<Attributes>(offset), offset += Attributes::AttributeFormat::SIZE), ...);
+        }
+
+    private:
+        template <typename A>
+        static void setupAttribute(const size_t offset) {
+            using F = typename A::AttributeFormat;
+            glEnableVertexAttribArray(A::LOCATION);
+            glVertexAttribPointer(A::LOCATION, F::COMPONENTS, F::TYPE, F::NORMALIZED, STRIDE, reinterpret_cast<void*>(offset));
+        }
+    };
+
+    // A layout for code choosing one at run time
+    struct Descriptor {
+        const char* name;
+        GLuint stride;
+        bool quantizedPosition;
+        void (*pack)(const Vertex* vertices, const size_t count, const Quantization& quantization, void* out);
+        void (*setupAttributes)();
+    };
+
+    template <typename L>
+    constexpr Descriptor describe(const char* name) {
+        return { name, L::STRIDE, L::QUANTIZED_POSITION, &L::pack, &L::setupAttributes };
+    }
+
+    // Vertex as it is, 32 bytes
+    using FloatLayout = Layout<
+        Attribute<0, &Vertex::Position, Float3>,
+        Attribute<1, &Vertex::Normal, Float3>,
+        Attribute<2, &Vertex::TexCoords, Float2>>;
+
+    // 16 bytes: positions quantized to the mesh bounds, 10-bit normals and half float texture coordinates
+    using PackedLayout = Layout<
+        Attribute<0, &Vertex::Position, Unorm16Position>,
+        Attribute<1, &Vertex::Normal, Snorm10Direction>,
+        Attribute<2, &Vertex::TexCoords, Half2>>;
+
+    static_assert(FloatLayout::STRIDE == sizeof(Vertex), "The float layout is Vertex unchanged");
+    static_assert(PackedLayout::STRIDE == 16, "Packed vertices are half the size of Vertex");
+
+    inline constexpr Descriptor FLOAT = describe<FloatLayout>("float");
+    inline constexpr Descriptor PACKED = describe<PackedLayout>("packed");
+}
+
+#endif
@@ -13,16 +13,23 @@
 
 #include <string>
 #include <iostream>
+#include <memory>
 
 #include "base/RenderCamera.hpp"
 #include "utility/ResourceManager.h"
 #include "graphic/GLShaderProgram.h"
+#include "graphic/GLExtensions.h"
+#include "graphic/GLState.h"
+#include "graphic/GLStats.h"
+#include "graphic/GLTextureStreamer.h"
 
 #include "base/Skybox.h"
 
 #include "utility/ImGuiRenderer.h"
+#include "utility/Profiler.h"
 
 #include "base/glTFModel.h"
+#include "base/glTFIndirectRenderer.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
@@ -58,6 +65,9 @@ struct MouseButtons {
     bool middle = false;
 } mouseButtons;
 
+// the cursor moved, pick the primitive under it in the next frame
+bool pick_pending = false;
+
 struct LightSource {
     glm::vec3 color = glm::vec3(1.0f);
     glm::vec3 rotation = glm::vec3(75.0f, 40.0f, 0.0f);
@@ -95,6 +105,8 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    // entry points newer than the glad loader
+    GLExtensions::getInstance().load((GLADloadproc)glfwGetProcAddress);
 
     // initial ImGui
     ImGuiRenderer::getInstance().setupImGui(window);
@@ -111,12 +123,12 @@ int main() {
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
     // Create uniform buffer object for projection and view matrices
+    // It stays bound, the per-frame updates skip the bind
+    auto& gl_state = GLState::getInstance();
     glGenBuffers(1, &m_uboMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
+    gl_state.bindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
     glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), nullptr, GL_STATIC_DRAW);
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, m_uboMatrices, 0, 2 * sizeof(glm::mat4));
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_uboMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    gl_state.bindBufferBase(GL_UNIFORM_BUFFER, 0, m_uboMatrices);
 
     // camera
     camera.type = RenderCamera::camera_type::lookat;
@@ -134,6 +146,24 @@ int main() {
     });
     gltf_shader.bind();
     gltf_shader.setUniformi("albedoMap", 0);
+    const auto gltf_wireframe = gltf_shader.getUniform<int>("render_wireframe");
+
+    // multi-draw indirect variant, per-draw data comes from storage buffers
+    std::unique_ptr<GLShaderProgram> gltf_indirect_shader;
+    GLUniform<int> gltf_indirect_wireframe;
+    if (glTFIndirectRenderer::isSupported()) {
+        gltf_indirect_shader = std::make_unique<GLShaderProgram>("glTF Indirect Shader", std::vector<ShaderCreateInfo>{
+            {"shaders/glsl/mesh_indirect.vert", "vertex"},
+            {"shaders/glsl/wireframe.geometry", "geometry"},
+            {"shaders/glsl/mesh.frag", "fragment"}
+        });
+        gltf_indirect_shader->bind();
+        gltf_indirect_shader->setUniformi("albedoMap", 0);
+        gltf_indirect_wireframe = gltf_indirect_shader->getUniform<int>("render_wireframe");
+    }
+    else {
+        ImGuiRenderer::render_indirect = false;
+    }
 
     GLShaderProgram skybox_shader{"Skybox Shader", {
         {"shaders/glsl/skybox.vert", "vertex"},
@@ -155,18 +185,26 @@ int main() {
     // model
     // model model_nanosuit("data/nanosuit/nanosuit.obj", "nanosuit");
 
+    // Only the mip levels the view needs stay in video memory
+    GLTextureStreamer::getInstance().setMipResidency(true);
     glTFModel g_m("models/DamagedHelmet/glTF-Embedded/DamagedHelmet.gltf");
 
+    glTFIndirectRenderer g_m_indirect;
+    if (gltf_indirect_shader) {
+        g_m_indirect.build(g_m);
+    }
+
     // Skybox
     Skybox env_skybox;
-    env_skybox.init("textures/hdr/hdriHaven4k.hdr", 512);
+    // Diffuse IBL from the irradiance cubemap. Skybox::irradiance_sh skips its bake, but no shader here
+    // evaluates sh_irradiance.glsl yet.
+    env_skybox.init("textures/hdr/hdriHaven4k.hdr", 512, 1024);
 
     // initialize static shader uniforms before rendering
     // --------------------------------------------------
     glm::mat4 projection = camera.matrices.perspective;
-    glBindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
+    gl_state.bindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
     glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
     // then before rendering, configure the viewport to the original framebuffer's screen dimensions
     int scr_width, scr_height;
@@ -186,6 +224,10 @@ int main() {
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window)) {
+        Profiler::getInstance().newFrame();
+        const auto frame_counters = GLStats::getInstance().getCounters();
+        GLTextureStreamer::getInstance().update();
+
         // per-frame time logic
         // --------------------
         float current_frame = static_cast<float>(glfwGetTime());
@@ -206,17 +248,15 @@ int main() {
         // render scene, supplying the convoluted irradiance map to the final shader.
         // ------------------------------------------------------------------------------------------
         glm::mat4 view = camera.matrices.view;
-        glBindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
+        gl_state.bindBuffer(GL_UNIFORM_BUFFER, m_uboMatrices);
         glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-        // bind pre-computed IBL data
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, env_skybox.getIrradianceMap());
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, env_skybox.getPrefilterMap());
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, env_skybox.getBRDFLUT());
+        // bind pre-computed IBL data, the SH irradiance block stays bound from Skybox::init
+        if (env_skybox.getIrradianceMode() == Skybox::irradiance_cubemap) {
+            gl_state.bindTexture(0, GL_TEXTURE_CUBE_MAP, env_skybox.getIrradianceMap());
+        }
+        gl_state.bindTexture(1, GL_TEXTURE_CUBE_MAP, env_skybox.getPrefilterMap());
+        gl_state.bindTexture(2, GL_TEXTURE_2D, env_skybox.getBRDFLUT());
 
        /* glm::vec3 camPos = glm::vec3(
             camera.position.z * sin(glm::radians(camera.rotation.y)) * cos(glm::radians(camera.rotation.x)),
@@ -233,27 +273,103 @@ int main() {
         // model_nanosuit.translate(glm::vec3(0.0f, -7.0f, 1.0f));
         // model_nanosuit.scale(glm::vec3(0.8f));
         // model_nanosuit.draw(pbr_shader);
-        gltf_shader.bind();
-        gltf_shader.setUniformi("render_wireframe", (int)ImGuiRenderer::render_wireframe);
-        g_m.draw(gltf_shader);
+        {
+            Profiler::CpuZone cpu_zone("Scene");
+            Profiler::GpuZone gpu_zone("Scene");
+            if (ImGuiRenderer::frustum_culling) {
+                g_m.cull(camera.matrices.perspective * view);
+            }
+            else {
+                g_m.resetCulling();
+            }
+            g_m.requestTextureLevels(view, camera.matrices.perspective, static_cast<float>(scr_height));
+            g_m.selectLods(view, camera.matrices.perspective, static_cast<float>(scr_height), ImGuiRenderer::lod_error);
+            if (ImGuiRenderer::meshlet_culling) {
+                g_m.cullMeshlets(view, camera.matrices.perspective);
+            }
+            else {
+                g_m.resetMeshletCulling();
+            }
+            ImGuiRenderer::visible_primitives = g_m.getCullStats().visible;
+            ImGuiRenderer::culled_primitives = g_m.getCullStats().culled;
+            ImGuiRenderer::lod_triangles = g_m.getLodStats().triangles;
+            ImGuiRenderer::full_triangles = g_m.getLodStats().fullTriangles;
+            ImGuiRenderer::visible_meshlets = g_m.getMeshletStats().visible;
+            ImGuiRenderer::culled_meshlets = g_m.getMeshletStats().culled;
+
+            if (pick_pending) {
+                // Unproject the cursor onto the near and far planes, cursor coordinates are in window units
+                int window_width = 0, window_height = 0;
+                glfwGetWindowSize(window, &window_width, &window_height);
+                if (window_width > 0 && window_height > 0) {
+                    const glm::mat4 inverse_view_projection = glm::inverse(camera.matrices.perspective * view);
+                    const float ndc_x = 2.0f * last_x / window_width - 1.0f;
+                    const float ndc_y = 1.0f - 2.0f * last_y / window_height;
+                    glm::vec4 near_point = inverse_view_projection * glm::vec4(ndc_x, ndc_y, -1.0f, 1.0f);
+                    glm::vec4 far_point = inverse_view_projection * glm::vec4(ndc_x, ndc_y, 1.0f, 1.0f);
+                    near_point /= near_point.w;
+                    far_point /= far_point.w;
+                    ImGuiRenderer::hovered_primitive = g_m.pick(glm::vec3(near_point), glm::normalize(glm::vec3(far_point - near_point)));
+                }
+                pick_pending = false;
+            }
+
+            if (ImGuiRenderer::render_indirect && gltf_indirect_shader) {
+                gltf_indirect_shader->bind();
+                gltf_indirect_shader->setUniform(gltf_indirect_wireframe, (int)ImGuiRenderer::render_wireframe);
+                g_m_indirect.updateTransforms(g_m);
+                g_m_indirect.updateVisibility(g_m);
+                g_m_indirect.draw();
+                // Blended primitives are sorted and drawn by the model, over the indirect ones
+                if (g_m_indirect.hasTransparentDraws()) {
+                    gltf_shader.bind();
+                    gltf_shader.setUniform(gltf_wireframe, (int)ImGuiRenderer::render_wireframe);
+                    g_m.draw(gltf_shader, camera.matrices.perspective * view, true);
+                }
+            }
+            else {
+                gltf_shader.bind();
+                gltf_shader.setUniform(gltf_wireframe, (int)ImGuiRenderer::render_wireframe);
+                g_m.draw(gltf_shader, camera.matrices.perspective * view);
+            }
+        }
 
         // render Skybox (render as last to prevent overdraw)
-        skybox_shader.bind();
-        // skybox_shader.setUniform("view", view);
-        env_skybox.draw();
-
-        // render ImGui
-        ImGuiRenderer::getInstance().renderImGui();
+        {
+            Profiler::CpuZone cpu_zone("Skybox");
+            Profiler::GpuZone gpu_zone("Skybox");
+            skybox_shader.bind();
+            // skybox_shader.setUniform("view", view);
+            env_skybox.draw();
+        }
+
+        // render ImGui, the backend restores the GL state it changes
+        ImGuiRenderer::frame_counters = GLStats::getInstance().getCounters() - frame_counters;
+        {
+            Profiler::CpuZone cpu_zone("ImGui");
+            Profiler::GpuZone gpu_zone("ImGui");
+            ImGuiRenderer::getInstance().renderImGui();
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
+        {
+            Profiler::CpuZone zone("Swap buffers");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
     }
 
     // ImGui Cleanup
     ImGuiRenderer::getInstance().destroyImGui();
 
+    // Shared mesh buffers
+    g_m_indirect.destroy();
+    GLMeshArena::getInstance().destroy();
+    ResourceManager::getInstance().getTextureCache().clear();
+    GLTextureStreamer::getInstance().destroy();
+    Profiler::getInstance().destroy();
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
@@ -320,6 +436,8 @@ void cursor_position_callback(GLFWwindow* window, double x, double y) {
     if (mouseButtons.middle) {
         camera.translate(glm::vec3(dx * 0.005f, -dy * 0.005f, 0.0f));
     }
+
+    pick_pending = true;
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
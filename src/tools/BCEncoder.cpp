@@ -0,0 +1,370 @@
+#include "BCEncoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace {
+    // Interpolation weights of 4-bit indices, shared by BC6H and BC7
+    constexpr int WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // Little-endian bit stream over a 16 byte block
+    class BitWriter {
+        public:
+            explicit BitWriter(uint8_t* block) : m_block(block) {
+                std::memset(m_block, 0, 16);
+            }
+
+            void write(const uint32_t value, const int bits) {
+                for (int i = 0; i < bits; ++i, ++m_position) {
+                    if (value & (1u << i)) {
+                        m_block[m_position >> 3] |= static_cast<uint8_t>(1u << (m_position & 7));
+                    }
+                }
+            }
+
+        private:
+            uint8_t* m_block;
+            int m_position { 0 };
+    };
+
+    // Principal axis of the texels around their mean, by power iteration from the bounding box diagonal
+    template<int N>
+    glm::vec<N, float> principalAxis(const glm::vec<N, float>* texels, const glm::vec<N, float>& mean) {
+        float covariance[N][N] = {};
+        glm::vec<N, float> low = texels[0], high = texels[0];
+        for (int t = 0; t < 16; ++t) {
+            const auto d = texels[t] - mean;
+            for (int i = 0; i < N; ++i) {
+                for (int j = 0; j < N; ++j) {
+                    covariance[i][j] += d[i] * d[j];
+                }
+            }
+            low = glm::min(low, texels[t]);
+            high = glm::max(high, texels[t]);
+        }
+
+        auto axis = high - low;
+        for (int iteration = 0; iteration < 8; ++iteration) {
+            glm::vec<N, float> next(0.0f);
+            for (int i = 0; i < N; ++i) {
+                for (int j = 0; j < N; ++j) {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+            }
+            const float length = glm::length(next);
+            if (length < 1e-12f) {
+                break;
+            }
+            axis = next / length;
+        }
+        const float length = glm::length(axis);
+        return length > 0.0f ? axis / length : glm::vec<N, float>(0.0f);
+    }
+
+    // Endpoints spanning the texels projected onto their principal axis
+    template<int N>
+    void fitEndpoints(const glm::vec<N, float>* texels, glm::vec<N, float>& e0, glm::vec<N, float>& e1) {
+        glm::vec<N, float> mean(0.0f);
+        for (int t = 0; t < 16; ++t) {
+            mean += texels[t];
+        }
+        mean /= 16.0f;
+
+        const auto axis = principalAxis<N>(texels, mean);
+        float low = std::numeric_limits<float>::max(), high = std::numeric_limits<float>::lowest();
+        for (int t = 0; t < 16; ++t) {
+            const float projection = glm::dot(texels[t] - mean, axis);
+            low = std::min(low, projection);
+            high = std::max(high, projection);
+        }
+        e0 = mean + axis * low;
+        e1 = mean + axis * high;
+    }
+
+    // Least squares endpoints for fixed indices, returns false if every texel uses the same weight
+    template<int N>
+    bool refineEndpoints(const glm::vec<N, float>* texels, const int indices[16], glm::vec<N, float>& e0, glm::vec<N, float>& e1) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        glm::vec<N, float> ax(0.0f), bx(0.0f);
+        for (int t = 0; t < 16; ++t) {
+            const float b = WEIGHTS[indices[t]] / 64.0f;
+            const float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            ax += a * texels[t];
+            bx += b * texels[t];
+        }
+        const float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f) {
+            return false;
+        }
+        e0 = (ax * bb - bx * ab) / determinant;
+        e1 = (bx * aa - ax * ab) / determinant;
+        return true;
+    }
+
+    // BC7 mode 6 endpoint: 7 bits per channel plus a p-bit shared by the channels
+    struct BC7Endpoint {
+        glm::ivec4 quantized;
+        int pbit;
+        glm::ivec4 value;   // Unquantized 8-bit channels
+    };
+
+    BC7Endpoint quantizeBC7(const glm::vec4& endpoint) {
+        BC7Endpoint best{};
+        float best_error = std::numeric_limits<float>::max();
+        for (int pbit = 0; pbit < 2; ++pbit) {
+            BC7Endpoint candidate{};
+            candidate.pbit = pbit;
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                const float target = glm::clamp(endpoint[c], 0.0f, 255.0f);
+                candidate.quantized[c] = glm::clamp(static_cast<int>(std::lround((target - pbit) / 2.0f)), 0, 127);
+                candidate.value[c] = (candidate.quantized[c] << 1) | pbit;
+                error += (candidate.value[c] - target) * (candidate.value[c] - target);
+            }
+            if (error < best_error) {
+                best_error = error;
+                best = candidate;
+            }
+        }
+        return best;
+    }
+
+    // Chooses the closest of the 16 interpolated colors per texel, returns the summed squared error
+    float selectBC7Indices(const glm::vec4* texels, const BC7Endpoint& e0, const BC7Endpoint& e1, int indices[16]) {
+        glm::vec4 palette[16];
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 4; ++c) {
+                palette[i][c] = static_cast<float>((e0.value[c] * (64 - WEIGHTS[i]) + e1.value[c] * WEIGHTS[i] + 32) >> 6);
+            }
+        }
+
+        float total = 0.0f;
+        for (int t = 0; t < 16; ++t) {
+            float best_error = std::numeric_limits<float>::max();
+            for (int i = 0; i < 16; ++i) {
+                const auto d = palette[i] - texels[t];
+                const float error = glm::dot(d, d);
+                if (error < best_error) {
+                    best_error = error;
+                    indices[t] = i;
+                }
+            }
+            total += best_error;
+        }
+        return total;
+    }
+
+    // BC6H works on the bit patterns of half floats, which is roughly logarithmic in the value
+    int toHalfBits(const float value) {
+        if (!(value > 0.0f)) {
+            return 0;
+        }
+        return std::min(static_cast<int>(glm::packHalf1x16(std::min(value, 65504.0f))), 0x7BFF);
+    }
+
+    // Mode 11 keeps 10 bits of the 16-bit unquantized endpoints
+    int unquantizeBC6H(const int quantized) {
+        if (quantized == 0) {
+            return 0;
+        }
+        if (quantized == 1023) {
+            return 0xFFFF;
+        }
+        return ((quantized << 16) + 0x8000) >> 10;
+    }
+
+    // Half bits of an interpolated value, like the decoder's final unquantization
+    int finishBC6H(const int interpolated) {
+        return (interpolated * 31) >> 6;
+    }
+
+    glm::ivec3 quantizeBC6H(const glm::vec3& endpoint) {
+        glm::ivec3 quantized;
+        for (int c = 0; c < 3; ++c) {
+            // endpoint is in half bits, the decoder scales the unquantized value by 31/64
+            const float target = glm::clamp(endpoint[c], 0.0f, static_cast<float>(0x7BFF)) * 64.0f / 31.0f;
+            int best = 0;
+            float best_error = std::numeric_limits<float>::max();
+            const int guess = glm::clamp(static_cast<int>(std::lround((target - 32.0f) / 64.0f)), 0, 1023);
+            for (int q = std::max(0, guess - 1); q <= std::min(1023, guess + 1); ++q) {
+                const float error = std::abs(unquantizeBC6H(q) - target);
+                if (error < best_error) {
+                    best_error = error;
+                    best = q;
+                }
+            }
+            quantized[c] = best;
+        }
+        return quantized;
+    }
+
+    float selectBC6HIndices(const glm::vec3* texels, const glm::ivec3& q0, const glm::ivec3& q1, int indices[16]) {
+        glm::vec3 palette[16];
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                const int interpolated = (unquantizeBC6H(q0[c]) * (64 - WEIGHTS[i]) + unquantizeBC6H(q1[c]) * WEIGHTS[i] + 32) >> 6;
+                palette[i][c] = static_cast<float>(finishBC6H(interpolated));
+            }
+        }
+
+        float total = 0.0f;
+        for (int t = 0; t < 16; ++t) {
+            float best_error = std::numeric_limits<float>::max();
+            for (int i = 0; i < 16; ++i) {
+                const auto d = palette[i] - texels[t];
+                const float error = glm::dot(d, d);
+                if (error < best_error) {
+                    best_error = error;
+                    indices[t] = i;
+                }
+            }
+            total += best_error;
+        }
+        return total;
+    }
+
+    // The first index is stored without its top bit, so it must be below 8: swap the endpoints otherwise
+    template<typename Endpoint>
+    void fixAnchor(Endpoint& e0, Endpoint& e1, int indices[16]) {
+        if (indices[0] < 8) {
+            return;
+        }
+        std::swap(e0, e1);
+        for (int t = 0; t < 16; ++t) {
+            indices[t] = 15 - indices[t];
+        }
+    }
+
+    void writeIndices(BitWriter& writer, const int indices[16]) {
+        writer.write(indices[0], 3);
+        for (int t = 1; t < 16; ++t) {
+            writer.write(indices[t], 4);
+        }
+    }
+}
+
+void BCEncoder::encodeBC4(const uint8_t values[16], uint8_t block[8]) {
+    const int high = *std::max_element(values, values + 16);
+    const int low = *std::min_element(values, values + 16);
+
+    // Eight-value mode: red0 > red1, six interpolated values in between
+    int palette[8] = { high, low };
+    for (int i = 1; i < 7; ++i) {
+        palette[i + 1] = ((7 - i) * high + i * low) / 7;
+    }
+
+    uint64_t bits = 0;
+    for (int t = 0; t < 16; ++t) {
+        int best = 0;
+        for (int i = 1; i < 8; ++i) {
+            if (std::abs(palette[i] - values[t]) < std::abs(palette[best] - values[t])) {
+                best = i;
+            }
+        }
+        bits |= static_cast<uint64_t>(best) << (3 * t);
+    }
+
+    block[0] = static_cast<uint8_t>(high);
+    block[1] = static_cast<uint8_t>(low);
+    for (int i = 0; i < 6; ++i) {
+        block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+}
+
+void BCEncoder::encodeBC5(const uint8_t red[16], const uint8_t green[16], uint8_t block[16]) {
+    encodeBC4(red, block);
+    encodeBC4(green, block + 8);
+}
+
+void BCEncoder::encodeBC7(const uint8_t rgba[16][4], uint8_t block[16]) {
+    glm::vec4 texels[16];
+    for (int t = 0; t < 16; ++t) {
+        texels[t] = glm::vec4(rgba[t][0], rgba[t][1], rgba[t][2], rgba[t][3]);
+    }
+
+    glm::vec4 f0, f1;
+    fitEndpoints<4>(texels, f0, f1);
+    auto e0 = quantizeBC7(f0);
+    auto e1 = quantizeBC7(f1);
+    int indices[16];
+    float error = selectBC7Indices(texels, e0, e1, indices);
+
+    // A couple of least squares passes usually pull the endpoints past the outermost texels
+    for (int iteration = 0; iteration < 2 && error > 0.0f; ++iteration) {
+        if (!refineEndpoints<4>(texels, indices, f0, f1)) {
+            break;
+        }
+        const auto r0 = quantizeBC7(f0);
+        const auto r1 = quantizeBC7(f1);
+        int refined[16];
+        const float refined_error = selectBC7Indices(texels, r0, r1, refined);
+        if (refined_error >= error) {
+            break;
+        }
+        e0 = r0;
+        e1 = r1;
+        error = refined_error;
+        std::memcpy(indices, refined, sizeof(indices));
+    }
+    fixAnchor(e0, e1, indices);
+
+    BitWriter writer(block);
+    writer.write(1u << 6, 7);   // mode 6
+    for (int c = 0; c < 4; ++c) {
+        writer.write(e0.quantized[c], 7);
+        writer.write(e1.quantized[c], 7);
+    }
+    writer.write(e0.pbit, 1);
+    writer.write(e1.pbit, 1);
+    writeIndices(writer, indices);
+}
+
+void BCEncoder::encodeBC6H(const float rgb[16][3], uint8_t block[16]) {
+    glm::vec3 texels[16];
+    for (int t = 0; t < 16; ++t) {
+        texels[t] = glm::vec3(toHalfBits(rgb[t][0]), toHalfBits(rgb[t][1]), toHalfBits(rgb[t][2]));
+    }
+
+    glm::vec3 f0, f1;
+    fitEndpoints<3>(texels, f0, f1);
+    auto q0 = quantizeBC6H(f0);
+    auto q1 = quantizeBC6H(f1);
+    int indices[16];
+    float error = selectBC6HIndices(texels, q0, q1, indices);
+
+    for (int iteration = 0; iteration < 2 && error > 0.0f; ++iteration) {
+        if (!refineEndpoints<3>(texels, indices, f0, f1)) {
+            break;
+        }
+        const auto r0 = quantizeBC6H(f0);
+        const auto r1 = quantizeBC6H(f1);
+        int refined[16];
+        const float refined_error = selectBC6HIndices(texels, r0, r1, refined);
+        if (refined_error >= error) {
+            break;
+        }
+        q0 = r0;
+        q1 = r1;
+        error = refined_error;
+        std::memcpy(indices, refined, sizeof(indices));
+    }
+    fixAnchor(q0, q1, indices);
+
+    BitWriter writer(block);
+    writer.write(0x03, 5);      // mode 11
+    for (int c = 0; c < 3; ++c) {
+        writer.write(q0[c], 10);
+    }
+    for (int c = 0; c < 3; ++c) {
+        writer.write(q1[c], 10);
+    }
+    writeIndices(writer, indices);
+}
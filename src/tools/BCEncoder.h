@@ -0,0 +1,19 @@
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include <cstdint>
+
+// Single-block BCn encoders for the offline texture converter. Quality over speed, but each block
+// only tries one partitioning: BC7 always uses mode 6 (one subset, RGBA, 4-bit indices) and BC6H
+// mode 11 (one region, 10-bit endpoints), which suits the smooth material and environment maps here.
+// Blocks are 4x4 texels in row order.
+class BCEncoder {
+    public:
+        static void encodeBC4(const uint8_t values[16], uint8_t block[8]);
+        static void encodeBC5(const uint8_t red[16], const uint8_t green[16], uint8_t block[16]);
+        static void encodeBC7(const uint8_t rgba[16][4], uint8_t block[16]);
+        // Unsigned half floats, negative and non-finite texels are clamped
+        static void encodeBC6H(const float rgb[16][3], uint8_t block[16]);
+};
+
+#endif
@@ -0,0 +1,98 @@
+// Offline baker for the split-sum BRDF lookup table (the same integral as shaders/glsl/brdf.frag).
+// The LUT does not depend on the environment, so it ships as textures/brdf_lut.ibl instead of
+// being rendered at every start.
+//
+// Usage: BRDF-LUT-Baker [<output.ibl>]
+
+#include <cmath>
+#include <iostream>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "base/IBLCache.h"
+#include "utility/ThreadPool.h"
+
+namespace {
+    constexpr float PI = 3.14159265359f;
+
+    float radicalInverseVdC(uint32_t bits) {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+
+    glm::vec3 importanceSampleGGX(const glm::vec2& xi, const float roughness) {
+        // Tangent space with N = +Z
+        const float a = roughness * roughness;
+        const float phi = 2.0f * PI * xi.x;
+        const float cos_theta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+        const float sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+        return glm::normalize(glm::vec3(std::cos(phi) * sin_theta, std::sin(phi) * sin_theta, cos_theta));
+    }
+
+    float geometrySchlickGGX(const float n_dot_v, const float roughness) {
+        // IBL uses k = a^2 / 2
+        const float k = (roughness * roughness) / 2.0f;
+        return n_dot_v / (n_dot_v * (1.0f - k) + k);
+    }
+
+    glm::vec2 integrateBRDF(const float n_dot_v, const float roughness, const uint32_t sample_count) {
+        const glm::vec3 v(std::sqrt(1.0f - n_dot_v * n_dot_v), 0.0f, n_dot_v);
+
+        float a = 0.0f;
+        float b = 0.0f;
+        for (uint32_t i = 0; i < sample_count; ++i) {
+            const glm::vec2 xi(static_cast<float>(i) / static_cast<float>(sample_count), radicalInverseVdC(i));
+            const auto h = importanceSampleGGX(xi, roughness);
+            const auto l = glm::normalize(2.0f * glm::dot(v, h) * h - v);
+
+            const float n_dot_l = std::max(l.z, 0.0f);
+            const float n_dot_h = std::max(h.z, 0.0f);
+            const float v_dot_h = std::max(glm::dot(v, h), 0.0f);
+            if (n_dot_l > 0.0f) {
+                const float g = geometrySchlickGGX(n_dot_v, roughness) * geometrySchlickGGX(n_dot_l, roughness);
+                const float g_vis = (g * v_dot_h) / (n_dot_h * n_dot_v);
+                const float fc = std::pow(1.0f - v_dot_h, 5.0f);
+                a += (1.0f - fc) * g_vis;
+                b += fc * g_vis;
+            }
+        }
+        return glm::vec2(a, b) / static_cast<float>(sample_count);
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::string output_path = argc > 1 ? argv[1] : IBLCache::getBRDFLUTPath();
+    const uint32_t size = IBLCache::BRDF_LUT_SIZE;
+    const uint32_t sample_count = IBLCache::BRDF_LUT_SAMPLES;
+
+    IBLCache::Texture lut;
+    lut.type = IBLCache::texture_2d;
+    lut.size = size;
+    lut.channels = 2;
+    lut.levels = 1;
+    lut.data.resize(lut.getHalfCount());
+
+    // Rows are roughness, columns N.V, sampled at texel centers like the full-screen quad does
+    ThreadPool::getInstance().parallelFor(0, size, [&](const size_t y) {
+        const float roughness = (static_cast<float>(y) + 0.5f) / static_cast<float>(size);
+        for (uint32_t x = 0; x < size; ++x) {
+            const float n_dot_v = (static_cast<float>(x) + 0.5f) / static_cast<float>(size);
+            const auto value = integrateBRDF(n_dot_v, roughness, sample_count);
+            lut.data[(y * size + x) * 2 + 0] = glm::packHalf1x16(value.x);
+            lut.data[(y * size + x) * 2 + 1] = glm::packHalf1x16(value.y);
+        }
+    });
+
+    if (!IBLCache::write(output_path, IBLCache::getBRDFLUTKey(), { lut })) {
+        std::cerr << "Failed to write " << output_path << std::endl;
+        return 1;
+    }
+
+    std::cout << "Baked " << size << "x" << size << " BRDF LUT (" << sample_count << " samples) -> " << output_path << std::endl;
+    return 0;
+}
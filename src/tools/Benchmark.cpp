@@ -0,0 +1,673 @@
+// Headless benchmark: renders a scene offscreen along a scripted camera path and writes a JSON report
+// with load times, per-phase CPU and GPU frame times and GL call counts.
+// Runs on an EGL surfaceless context, so it works on CI machines with Mesa llvmpipe and no display.
+// Like the renderer it resolves assets against ResourceManager::getAssetsPath().
+//
+// Usage: Renderer-Benchmark [options]
+//   --scene <path>       glTF file (default models/DamagedHelmet/glTF-Embedded/DamagedHelmet.gltf)
+//   --hdr <path|none>    environment map, none disables the skybox (default textures/hdr/hdriHaven4k.hdr)
+//   --irradiance <m>     diffuse IBL source the skybox prepares: cubemap or sh (default cubemap)
+//   --path <name|file>   orbit, dolly or a keyframe file, see CameraPath::load (default orbit)
+//   --frames <n>         measured frames (default 300)
+//   --warmup <n>         unmeasured frames before them (default 10)
+//   --size <w>x<h>       render target size (default 1280x720)
+//   --indirect           draw the scene with glTFIndirectRenderer
+//   --cull <mode>        frustum culling: auto, flat (SIMD over every box), bvh or none (default auto)
+//   --mip-residency      keep only the texture mips the view needs, the scene phase then includes their uploads
+//   --vertex-layout <l>  packed (16 bytes, see GLVertexLayout) or float (32 bytes) vertices (default packed)
+//   --lod-error <px>     screen-space error in pixels up to which primitives draw a simplified level, 0 for full detail (default 0)
+//   --meshlets           cull the meshlets of full detail primitives by bounding sphere and normal cone,
+//                        only the --indirect path draws the remaining ones
+//   --output <file|->    report destination, - for stdout (default benchmark.json)
+//   --trace <file>       also write a Chrome trace of the loading and the last frames (see Profiler)
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/CameraPath.h"
+#include "base/RenderCamera.hpp"
+#include "base/Skybox.h"
+#include "base/glTFIndirectRenderer.h"
+#include "base/glTFModel.h"
+#include "graphic/GLExtensions.h"
+#include "graphic/GLHeadlessContext.h"
+#include "graphic/GLMeshArena.h"
+#include "graphic/GLShaderProgram.h"
+#include "graphic/GLState.h"
+#include "graphic/GLStats.h"
+#include "graphic/GLTextureStreamer.h"
+#include "utility/Hash.h"
+#include "utility/Profiler.h"
+#include "utility/ResourceManager.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::string scene { "models/DamagedHelmet/glTF-Embedded/DamagedHelmet.gltf" };
+        std::string hdr { "textures/hdr/hdriHaven4k.hdr" };
+        std::string irradiance { "cubemap" };
+        std::string path { "orbit" };
+        int frames { 300 };
+        int warmup { 10 };
+        int width { 1280 };
+        int height { 720 };
+        bool indirect { false };
+        bool mipResidency { false };
+        std::string cull { "auto" };
+        std::string vertexLayout { "packed" };
+        float lodError { 0.0f };
+        bool meshlets { false };
+        std::string output { "benchmark.json" };
+        std::string trace;
+    };
+
+    // Timed parts of a frame, in the order they run
+    enum phase { phase_camera, phase_scene, phase_skybox, phase_finish, phase_count };
+    const char* const PHASE_NAMES[phase_count] = { "camera", "scene", "skybox", "finish" };
+
+    double millisecondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    bool parseOptions(const int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const bool has_value = i + 1 < argc;
+            if (arg == "--indirect") {
+                options.indirect = true;
+            }
+            else if (arg == "--meshlets") {
+                options.meshlets = true;
+            }
+            else if (arg == "--mip-residency") {
+                options.mipResidency = true;
+            }
+            else if (arg == "--scene" && has_value) {
+                options.scene = argv[++i];
+            }
+            else if (arg == "--hdr" && has_value) {
+                options.hdr = argv[++i];
+            }
+            else if (arg == "--irradiance" && has_value) {
+                options.irradiance = argv[++i];
+                if (options.irradiance != "cubemap" && options.irradiance != "sh") {
+                    std::cerr << "Invalid irradiance mode " << options.irradiance << ", expected cubemap or sh" << std::endl;
+                    return false;
+                }
+            }
+            else if (arg == "--path" && has_value) {
+                options.path = argv[++i];
+            }
+            else if (arg == "--frames" && has_value) {
+                options.frames = std::max(1, std::atoi(argv[++i]));
+            }
+            else if (arg == "--warmup" && has_value) {
+                options.warmup = std::max(0, std::atoi(argv[++i]));
+            }
+            else if (arg == "--size" && has_value) {
+                if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0) {
+                    std::cerr << "Invalid size " << argv[i] << ", expected <width>x<height>" << std::endl;
+                    return false;
+                }
+            }
+            else if (arg == "--output" && has_value) {
+                options.output = argv[++i];
+            }
+            else if (arg == "--trace" && has_value) {
+                options.trace = argv[++i];
+            }
+            else if (arg == "--cull" && has_value) {
+                options.cull = argv[++i];
+                if (options.cull != "auto" && options.cull != "flat" && options.cull != "bvh" && options.cull != "none") {
+                    std::cerr << "Invalid cull mode " << options.cull << ", expected auto, flat, bvh or none" << std::endl;
+                    return false;
+                }
+            }
+            else if (arg == "--lod-error" && has_value) {
+                options.lodError = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+            }
+            else if (arg == "--vertex-layout" && has_value) {
+                options.vertexLayout = argv[++i];
+                if (options.vertexLayout != "packed" && options.vertexLayout != "float") {
+                    std::cerr << "Invalid vertex layout " << options.vertexLayout << ", expected packed or float" << std::endl;
+                    return false;
+                }
+            }
+            else {
+                std::cerr << "Unknown or incomplete option " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Offscreen color and depth target
+    struct RenderTarget {
+        GLuint fbo { 0 };
+        GLuint color { 0 };
+        GLuint depth { 0 };
+
+        bool create(const int width, const int height) {
+            glGenRenderbuffers(1, &color);
+            glBindRenderbuffer(GL_RENDERBUFFER, color);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            glGenRenderbuffers(1, &depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, depth);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+            glGenFramebuffers(1, &fbo);
+            GLState::getInstance().bindFramebuffer(GL_FRAMEBUFFER, fbo);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+            return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        }
+
+        void destroy() {
+            GLState::getInstance().deleteFramebuffers(1, &fbo);
+            glDeleteRenderbuffers(1, &color);
+            glDeleteRenderbuffers(1, &depth);
+        }
+    };
+
+    // Minimal JSON emitter, values are written in call order
+    class JsonWriter {
+        public:
+            explicit JsonWriter(std::ostream& out) : m_out(out) {}
+
+            void beginObject(const char* key = nullptr) { open(key, '{'); }
+            void endObject() { close('}'); }
+            void beginArray(const char* key = nullptr) { open(key, '['); }
+            void endArray() { close(']'); }
+
+            void value(const char* key, const std::string& text) { writeKey(key); writeString(text); }
+            void value(const char* key, const char* text) { value(key, std::string(text)); }
+            void value(const char* key, const bool flag) { writeKey(key); m_out << (flag ? "true" : "false"); }
+            void value(const char* key, const double number) { writeKey(key); m_out << number; }
+            void value(const char* key, const uint64_t number) { writeKey(key); m_out << number; }
+            void value(const char* key, const int number) { writeKey(key); m_out << number; }
+            void null(const char* key) { writeKey(key); m_out << "null"; }
+
+        private:
+            void open(const char* key, const char bracket) {
+                writeKey(key);
+                m_out << bracket;
+                m_first.push_back(true);
+            }
+
+            void close(const char bracket) {
+                m_first.pop_back();
+                m_out << "\n" << std::string(m_first.size() * 2, ' ') << bracket;
+            }
+
+            void writeKey(const char* key) {
+                if (!m_first.empty()) {
+                    if (!m_first.back()) {
+                        m_out << ",";
+                    }
+                    m_first.back() = false;
+                    m_out << "\n" << std::string(m_first.size() * 2, ' ');
+                }
+                if (key) {
+                    writeString(key);
+                    m_out << ": ";
+                }
+            }
+
+            void writeString(const std::string& text) {
+                m_out << '"';
+                for (const char c : text) {
+                    if (c == '"' || c == '\\') {
+                        m_out << '\\' << c;
+                    }
+                    else if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        m_out << escaped;
+                    }
+                    else {
+                        m_out << c;
+                    }
+                }
+                m_out << '"';
+            }
+
+            std::ostream& m_out;
+            std::vector<bool> m_first;
+    };
+
+    // mean, median, p95, min and max of a series of milliseconds
+    void writeSummary(JsonWriter& json, const char* key, std::vector<double> samples) {
+        json.beginObject(key);
+        if (!samples.empty()) {
+            std::sort(samples.begin(), samples.end());
+            double sum = 0.0;
+            for (const auto sample : samples) {
+                sum += sample;
+            }
+            json.value("mean", sum / samples.size());
+            json.value("median", samples[samples.size() / 2]);
+            json.value("p95", samples[std::min(samples.size() - 1, samples.size() * 95 / 100)]);
+            json.value("min", samples.front());
+            json.value("max", samples.back());
+        }
+        json.endObject();
+    }
+
+    std::string glString(const GLenum name) {
+        const auto* text = reinterpret_cast<const char*>(glGetString(name));
+        return text ? text : "";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    CameraPath camera_path;
+    if (options.path == "orbit") {
+        camera_path = CameraPath::orbit(3.0f, -15.0f);
+    }
+    else if (options.path == "dolly") {
+        camera_path = CameraPath::dolly(6.0f, 1.5f);
+    }
+    else if (!camera_path.load(options.path)) {
+        return 1;
+    }
+
+    const auto total_start = Clock::now();
+
+    GLHeadlessContext context;
+    if (!context.create(4, 2)) {
+        return 1;
+    }
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(GLHeadlessContext::getProcAddress))) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        return 1;
+    }
+    GLExtensions::getInstance().load(reinterpret_cast<GLADloadproc>(GLHeadlessContext::getProcAddress));
+
+    RenderTarget target;
+    if (!target.create(options.width, options.height)) {
+        std::cerr << "Could not create a " << options.width << "x" << options.height << " render target" << std::endl;
+        return 1;
+    }
+
+    // Same global state as the renderer
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    auto& gl_state = GLState::getInstance();
+    GLuint ubo_matrices;
+    glGenBuffers(1, &ubo_matrices);
+    gl_state.bindBuffer(GL_UNIFORM_BUFFER, ubo_matrices);
+    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+    gl_state.bindBufferBase(GL_UNIFORM_BUFFER, 0, ubo_matrices);
+
+    // Loading
+    auto start = Clock::now();
+    GLShaderProgram gltf_shader("glTF Shader", {
+        {"shaders/glsl/mesh.vert", "vertex"},
+        {"shaders/glsl/wireframe.geometry", "geometry"},
+        {"shaders/glsl/mesh.frag", "fragment"}
+    });
+    gltf_shader.bind();
+    gltf_shader.setUniformi("albedoMap", 0);
+    gltf_shader.setUniformi("render_wireframe", 0);
+
+    const bool indirect = options.indirect && glTFIndirectRenderer::isSupported();
+    if (options.indirect && !indirect) {
+        std::cerr << "Multi-draw indirect is not supported, using the per-primitive path" << std::endl;
+    }
+    std::unique_ptr<GLShaderProgram> gltf_indirect_shader;
+    if (indirect) {
+        gltf_indirect_shader = std::make_unique<GLShaderProgram>("glTF Indirect Shader", std::vector<ShaderCreateInfo>{
+            {"shaders/glsl/mesh_indirect.vert", "vertex"},
+            {"shaders/glsl/wireframe.geometry", "geometry"},
+            {"shaders/glsl/mesh.frag", "fragment"}
+        });
+        gltf_indirect_shader->bind();
+        gltf_indirect_shader->setUniformi("albedoMap", 0);
+        gltf_indirect_shader->setUniformi("render_wireframe", 0);
+    }
+
+    const bool use_skybox = options.hdr != "none";
+    GLShaderProgram skybox_shader{"Skybox Shader", {
+        {"shaders/glsl/skybox.vert", "vertex"},
+        {"shaders/glsl/skybox.frag", "fragment"}
+    }};
+    skybox_shader.bind();
+    skybox_shader.setUniformi("environmentMap", 0);
+    const double shader_time = millisecondsSince(start);
+
+    start = Clock::now();
+    GLTextureStreamer::getInstance().setMipResidency(options.mipResidency);
+    GLMeshArena::getInstance().setVertexLayout(options.vertexLayout == "float" ? GLVertexLayout::FLOAT : GLVertexLayout::PACKED);
+    glTFModel model(options.scene);
+    if (model.m_sceneGraph.empty()) {
+        std::cerr << "Scene " << options.scene << " has nothing to draw" << std::endl;
+        return 1;
+    }
+    glTFIndirectRenderer indirect_renderer;
+    if (indirect) {
+        indirect_renderer.build(model);
+    }
+    const double scene_time = millisecondsSince(start);
+
+    // Frames must not depend on how far streaming got, so wait for every texture up front
+    start = Clock::now();
+    GLTextureStreamer::getInstance().finish();
+    glFinish();
+    const double texture_time = millisecondsSince(start);
+
+    start = Clock::now();
+    Skybox skybox;
+    if (use_skybox) {
+        skybox.init(options.hdr, 512, 1024, options.irradiance == "sh" ? Skybox::irradiance_sh : Skybox::irradiance_cubemap);
+    }
+    glFinish();
+    const double skybox_time = millisecondsSince(start);
+
+    // GPU timings, one query per phase; every frame ends with glFinish so results are ready right away
+    GLint timer_bits = 0;
+    glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &timer_bits);
+    const bool gpu_timing = timer_bits > 0;
+    std::array<GLuint, phase_count> queries{};
+    if (gpu_timing) {
+        glGenQueries(phase_count, queries.data());
+    }
+
+    RenderCamera camera;
+    camera.type = RenderCamera::camera_type::lookat;
+    camera.setPerspective(45.0f, static_cast<float>(options.width) / static_cast<float>(options.height), 0.1f, 256.0f);
+
+    std::array<std::vector<double>, phase_count> cpu_times;
+    std::array<std::vector<double>, phase_count> gpu_times;
+    std::vector<double> frame_times;
+    GLStats::Counters counters_start;
+    const auto cull_mode = options.cull == "flat" ? glTFModel::cull_flat : options.cull == "bvh" ? glTFModel::cull_bvh : glTFModel::cull_auto;
+    uint64_t visible_primitives = 0;
+    uint64_t culled_primitives = 0;
+    // Of the visible primitives, at their level of detail and at full detail
+    uint64_t triangles = 0;
+    uint64_t full_triangles = 0;
+    uint64_t visible_meshlets = 0;
+    uint64_t culled_meshlets = 0;
+    uint64_t meshlet_culled_triangles = 0;
+
+    gl_state.bindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glViewport(0, 0, options.width, options.height);
+
+    for (int frame = -options.warmup; frame < options.frames; ++frame) {
+        const bool measured = frame >= 0;
+        if (frame == 0) {
+            counters_start = GLStats::getInstance().getCounters();
+        }
+        Profiler::getInstance().newFrame();
+        const auto frame_start = Clock::now();
+        std::array<double, phase_count> cpu_time{};
+
+        for (int phase = 0; phase < phase_count; ++phase) {
+            const auto phase_start = Clock::now();
+            if (gpu_timing && measured) {
+                glBeginQuery(GL_TIME_ELAPSED, queries[phase]);
+            }
+
+            switch (phase) {
+                case phase_camera: {
+                    // Warmup frames hold the first pose
+                    const float t = options.frames > 1 ? static_cast<float>(std::max(frame, 0)) / (options.frames - 1) : 0.0f;
+                    camera_path.apply(camera, t);
+                    gl_state.bindBuffer(GL_UNIFORM_BUFFER, ubo_matrices);
+                    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(camera.matrices.perspective));
+                    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(camera.matrices.view));
+                    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    break;
+                }
+                case phase_scene: {
+                    Profiler::CpuZone cpu_zone("Scene");
+                    Profiler::GpuZone gpu_zone("Scene");
+                    if (options.cull != "none") {
+                        model.cull(camera.matrices.perspective * camera.matrices.view, cull_mode);
+                    }
+                    model.selectLods(camera.matrices.view, camera.matrices.perspective, static_cast<float>(options.height), options.lodError);
+                    if (options.meshlets) {
+                        model.cullMeshlets(camera.matrices.view, camera.matrices.perspective);
+                    }
+                    if (options.mipResidency) {
+                        // Frames must not depend on streaming progress either, wait for the levels this view needs
+                        model.requestTextureLevels(camera.matrices.view, camera.matrices.perspective, static_cast<float>(options.height));
+                        GLTextureStreamer::getInstance().update();
+                        GLTextureStreamer::getInstance().finish();
+                    }
+                    if (measured) {
+                        visible_primitives += model.getCullStats().visible;
+                        culled_primitives += model.getCullStats().culled;
+                        triangles += model.getLodStats().triangles;
+                        full_triangles += model.getLodStats().fullTriangles;
+                        visible_meshlets += model.getMeshletStats().visible;
+                        culled_meshlets += model.getMeshletStats().culled;
+                        meshlet_culled_triangles += model.getMeshletStats().culledTriangles;
+                    }
+                    if (indirect) {
+                        gltf_indirect_shader->bind();
+                        indirect_renderer.updateTransforms(model);
+                        indirect_renderer.updateVisibility(model);
+                        indirect_renderer.draw();
+                        if (indirect_renderer.hasTransparentDraws()) {
+                            gltf_shader.bind();
+                            model.draw(gltf_shader, camera.matrices.perspective * camera.matrices.view, true);
+                        }
+                    }
+                    else {
+                        gltf_shader.bind();
+                        model.draw(gltf_shader, camera.matrices.perspective * camera.matrices.view);
+                    }
+                    break;
+                }
+                case phase_skybox:
+                    if (use_skybox) {
+                        Profiler::CpuZone cpu_zone("Skybox");
+                        Profiler::GpuZone gpu_zone("Skybox");
+                        skybox_shader.bind();
+                        skybox.draw();
+                    }
+                    break;
+                case phase_finish:
+                    glFinish();
+                    break;
+            }
+
+            if (gpu_timing && measured) {
+                glEndQuery(GL_TIME_ELAPSED);
+            }
+            cpu_time[phase] = millisecondsSince(phase_start);
+        }
+
+        if (!measured) {
+            continue;
+        }
+        frame_times.push_back(millisecondsSince(frame_start));
+        for (int phase = 0; phase < phase_count; ++phase) {
+            cpu_times[phase].push_back(cpu_time[phase]);
+            if (gpu_timing) {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(queries[phase], GL_QUERY_RESULT, &elapsed);
+                gpu_times[phase].push_back(elapsed / 1.0e6);
+            }
+        }
+    }
+    const auto counters = GLStats::getInstance().getCounters() - counters_start;
+
+    // Hash of the last frame, to spot rendering changes between runs
+    std::vector<unsigned char> pixels(static_cast<size_t>(options.width) * options.height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, options.width, options.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    char image_hash[32];
+    std::snprintf(image_hash, sizeof(image_hash), "%016llx", static_cast<unsigned long long>(Hash::hash64(pixels.data(), pixels.size())));
+    const GLenum gl_error = glGetError();
+
+    // Report
+    std::ofstream file;
+    if (options.output != "-") {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "Could not write " << options.output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = options.output == "-" ? std::cout : file;
+    JsonWriter json(out);
+    const double frame_count = static_cast<double>(options.frames);
+
+    json.beginObject();
+    json.beginObject("device");
+    json.value("vendor", glString(GL_VENDOR));
+    json.value("renderer", glString(GL_RENDERER));
+    json.value("version", glString(GL_VERSION));
+    json.endObject();
+
+    json.beginObject("config");
+    json.value("scene", options.scene);
+    json.value("hdr", options.hdr);
+    json.value("irradiance", options.irradiance);
+    json.value("path", options.path);
+    json.value("frames", options.frames);
+    json.value("warmup", options.warmup);
+    json.value("width", options.width);
+    json.value("height", options.height);
+    json.value("indirect", indirect);
+    json.value("cull", options.cull);
+    json.value("mip_residency", options.mipResidency);
+    json.value("vertex_layout", options.vertexLayout);
+    json.value("lod_error", options.lodError);
+    json.value("meshlets", options.meshlets);
+    json.endObject();
+
+    const auto& load_stats = model.getLoadStats();
+    json.beginObject("load_ms");
+    json.value("shaders", shader_time);
+    json.value("scene", scene_time);
+    json.value("scene_parse", load_stats.parseTime);
+    json.value("scene_decode", load_stats.decodeTime);
+    json.value("scene_optimize", load_stats.optimizeTime);
+    json.value("scene_upload", load_stats.uploadTime);
+    json.value("scene_from_cache", load_stats.fromCache);
+    json.value("textures", texture_time);
+    json.value("skybox", skybox_time);
+    json.endObject();
+
+    // Post-transform vertex cache before and after the import's mesh optimization, see MeshOptimizer
+    const auto& mesh_stats = load_stats.meshStats;
+    json.beginObject("mesh");
+    json.value("triangles", mesh_stats.triangles);
+    json.value("vertices_before", mesh_stats.verticesBefore);
+    json.value("vertices_after", mesh_stats.verticesAfter);
+    json.value("acmr_before", mesh_stats.getACMRBefore());
+    json.value("acmr_after", mesh_stats.getACMRAfter());
+    json.value("atvr_before", mesh_stats.getATVRBefore());
+    json.value("atvr_after", mesh_stats.getATVRAfter());
+    json.value("vertex_stride", static_cast<uint64_t>(GLMeshArena::getInstance().getVertexLayout().stride));
+    json.value("vertex_bytes", static_cast<uint64_t>(GLMeshArena::getInstance().getVertexBytesUsed()));
+    json.value("index_bytes", static_cast<uint64_t>(GLMeshArena::getInstance().getIndexBytesUsed()));
+    // Since startup, so the load's growths count too
+    json.value("arena_growths", GLStats::getInstance().getCounters().bufferGrowths);
+    json.value("arena_growth_bytes", GLStats::getInstance().getCounters().bufferGrowthBytes);
+    json.endObject();
+
+    json.beginObject("cpu_ms");
+    writeSummary(json, "frame", frame_times);
+    for (int phase = 0; phase < phase_count; ++phase) {
+        writeSummary(json, PHASE_NAMES[phase], cpu_times[phase]);
+    }
+    json.endObject();
+
+    if (gpu_timing) {
+        json.beginObject("gpu_ms");
+        for (int phase = 0; phase < phase_count; ++phase) {
+            writeSummary(json, PHASE_NAMES[phase], gpu_times[phase]);
+        }
+        json.endObject();
+    }
+    else {
+        json.null("gpu_ms");
+    }
+
+    json.beginObject("per_frame");
+    json.value("draw_calls", counters.drawCalls / frame_count);
+    json.value("draw_commands", counters.drawCommands / frame_count);
+    json.value("program_binds", counters.programBinds / frame_count);
+    json.value("vertex_array_binds", counters.vertexArrayBinds / frame_count);
+    json.value("texture_binds", counters.textureBinds / frame_count);
+    json.value("buffer_binds", counters.bufferBinds / frame_count);
+    json.value("framebuffer_binds", counters.framebufferBinds / frame_count);
+    json.value("state_changes", counters.getStateChanges() / frame_count);
+    json.value("skipped_binds", counters.skippedBinds / frame_count);
+    json.value("visible_primitives", visible_primitives / frame_count);
+    json.value("culled_primitives", culled_primitives / frame_count);
+    json.value("triangles", triangles / frame_count);
+    json.value("full_triangles", full_triangles / frame_count);
+    json.value("visible_meshlets", visible_meshlets / frame_count);
+    json.value("culled_meshlets", culled_meshlets / frame_count);
+    json.value("meshlet_culled_triangles", meshlet_culled_triangles / frame_count);
+    json.endObject();
+
+    const auto& texture_stats = ResourceManager::getInstance().getTextureCache().getStats();
+    json.beginObject("texture_cache");
+    json.value("textures", static_cast<uint64_t>(texture_stats.residentCount));
+    json.value("resident_bytes", static_cast<uint64_t>(texture_stats.residentBytes));
+    json.value("hits", texture_stats.hits);
+    json.value("misses", texture_stats.misses);
+    if (options.mipResidency) {
+        json.value("mip_resident_bytes", static_cast<uint64_t>(GLTextureStreamer::getInstance().getResidentBytes()));
+        json.value("mip_full_chain_bytes", static_cast<uint64_t>(GLTextureStreamer::getInstance().getFullChainBytes()));
+    }
+    json.endObject();
+
+    json.beginArray("frame_ms");
+    for (const auto time : frame_times) {
+        json.value(nullptr, time);
+    }
+    json.endArray();
+
+    json.value("image_hash", image_hash);
+    json.value("gl_error", static_cast<int>(gl_error));
+    json.value("total_ms", millisecondsSince(total_start));
+    json.endObject();
+    out << std::endl;
+
+    if (!options.trace.empty()) {
+        // Close the last frame; every frame ended with glFinish, so all GPU zones resolve
+        Profiler::getInstance().newFrame();
+        Profiler::getInstance().exportChromeTrace(options.trace);
+    }
+    Profiler::getInstance().destroy();
+
+    if (gpu_timing) {
+        glDeleteQueries(phase_count, queries.data());
+    }
+    gl_state.deleteBuffers(1, &ubo_matrices);
+    target.destroy();
+    indirect_renderer.destroy();
+    GLMeshArena::getInstance().destroy();
+    ResourceManager::getInstance().getTextureCache().clear();
+    GLTextureStreamer::getInstance().destroy();
+    return gl_error == GL_NO_ERROR ? 0 : 1;
+}
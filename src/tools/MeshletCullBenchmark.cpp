@@ -0,0 +1,164 @@
+// CPU benchmark of meshlet culling: imports a glTF file, places the meshlets glTFImporter built in world
+// space like glTFModel does, and culls them from views orbiting the scene. Every view runs both the SIMD
+// kernel and the scalar reference of MeshletCuller, checks that they agree and times them. No GL context
+// is created, so it runs anywhere the importer does.
+//
+// Usage: Meshlet-Cull-Benchmark [--views <n>] [--iterations <n>] <model.gltf>
+//   --views <n>          camera positions on the orbit (default 64)
+//   --iterations <n>     timed passes over all views (default 100)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "base/FrustumCuller.h"
+#include "base/MeshletCuller.h"
+#include "base/SceneGraph.h"
+#include "base/glTFImporter.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(const Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    struct View {
+        FrustumCuller::Frustum frustum;
+        glm::vec3 eye;
+    };
+}
+
+int main(int argc, char** argv) {
+    int view_count = 64;
+    int iterations = 100;
+    std::string source_path;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--views" && has_value) {
+            view_count = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--iterations" && has_value) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (source_path.empty() && arg.rfind("--", 0) != 0) {
+            source_path = arg;
+        }
+        else {
+            std::cerr << "Unknown or incomplete option " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (source_path.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--views <n>] [--iterations <n>] <model.gltf>" << std::endl;
+        return 1;
+    }
+
+    glTFSceneData scene;
+    glTFImporter importer;
+    if (!importer.importFile(source_path, scene)) {
+        return 1;
+    }
+    if (scene.meshlets.empty()) {
+        std::cerr << source_path << " has no triangle meshlets" << std::endl;
+        return 1;
+    }
+
+    // World-space bounds, the way glTFModel::updateTransforms sets them
+    SceneGraph scene_graph;
+    for (const auto& node : scene.nodes) {
+        scene_graph.addNode(node.parent, node.translation, node.rotation, node.scale);
+    }
+    scene_graph.update();
+
+    MeshletCuller culler;
+    culler.resize(scene.meshlets.size());
+    glm::vec3 scene_min(std::numeric_limits<float>::max());
+    glm::vec3 scene_max(-std::numeric_limits<float>::max());
+    size_t cone_meshlets = 0;
+    for (uint32_t n = 0; n < scene.nodes.size(); ++n) {
+        const auto& node = scene.nodes[n];
+        const auto& world = scene_graph.getWorldMatrix(n);
+        for (uint32_t p = node.firstPrimitive; p < node.firstPrimitive + node.primitiveCount; ++p) {
+            const auto& primitive = scene.primitives[p];
+            const bool double_sided = primitive.materialIndex >= 0 && scene.materials[primitive.materialIndex].doubleSided;
+            for (uint32_t m = primitive.firstMeshlet; m < primitive.firstMeshlet + primitive.meshletCount; ++m) {
+                const auto& bounds = scene.meshlets[m].bounds;
+                culler.setBounds(m, bounds, world, !double_sided);
+                const glm::vec3 center = glm::vec3(world * glm::vec4(bounds.center, 1.0f));
+                scene_min = glm::min(scene_min, center);
+                scene_max = glm::max(scene_max, center);
+                cone_meshlets += !double_sided && bounds.coneCutoff > 0.0f;
+            }
+        }
+    }
+
+    // Orbit at twice the scene's size, alternating above and below the equator
+    const glm::vec3 target = 0.5f * (scene_min + scene_max);
+    const float distance = std::max(glm::length(scene_max - scene_min), 1e-3f);
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.01f * distance, 10.0f * distance);
+    std::vector<View> views(view_count);
+    for (int v = 0; v < view_count; ++v) {
+        const float angle = glm::two_pi<float>() * v / view_count;
+        const float elevation = (v % 2 == 0 ? 0.35f : -0.35f);
+        const glm::vec3 direction = glm::normalize(glm::vec3(std::cos(angle), elevation, std::sin(angle)));
+        views[v].eye = target + direction * distance;
+        const glm::mat4 view = glm::lookAt(views[v].eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+        views[v].frustum = FrustumCuller::extractFrustum(projection * view);
+    }
+
+    // The SIMD kernel must match the reference meshlet for meshlet
+    std::vector<uint8_t> visible, reference;
+    size_t mismatches = 0;
+    size_t visible_total = 0;
+    for (const auto& view : views) {
+        visible_total += culler.cull(view.frustum, view.eye, visible);
+        culler.cullReference(view.frustum, view.eye, reference);
+        for (size_t m = 0; m < visible.size(); ++m) {
+            mismatches += visible[m] != reference[m];
+        }
+    }
+
+    const auto time = [&](const bool simd) {
+        size_t checksum = 0;
+        const auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            for (const auto& view : views) {
+                checksum += simd ? culler.cull(view.frustum, view.eye, visible) : culler.cullReference(view.frustum, view.eye, visible);
+            }
+        }
+        const double elapsed = millisecondsSince(start);
+        if (checksum != visible_total * iterations) {
+            ++mismatches;
+        }
+        return elapsed * 1.0e6 / (static_cast<double>(iterations) * view_count * scene.meshlets.size());
+    };
+    const double simd_ns = time(true);
+    const double reference_ns = time(false);
+
+    size_t triangles = 0;
+    for (const auto& meshlet : scene.meshlets) {
+        triangles += meshlet.indexCount / 3;
+    }
+    std::cout << source_path << ": " << scene.meshlets.size() << " meshlets, " << static_cast<double>(triangles) / scene.meshlets.size()
+              << " triangles each, " << cone_meshlets << " with a normal cone" << std::endl;
+    std::cout << "  " << view_count << " views: " << 100.0 * visible_total / (static_cast<double>(view_count) * scene.meshlets.size())
+              << "% of the meshlets visible" << std::endl;
+    std::cout << "  cull " << simd_ns << " ns per meshlet, reference " << reference_ns << " ns per meshlet ("
+              << reference_ns / simd_ns << "x)" << std::endl;
+    if (mismatches > 0) {
+        std::cerr << "  " << mismatches << " results differ from the reference" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,334 @@
+// Offline texture converter: transcodes PNG/JPG material maps and HDR environments into KTX2 files
+// with a block-compressed mip chain. Color maps become BC7, normal maps (file names containing
+// "normal") BC5 and HDR images BC6H, which cuts their VRAM and upload size by 4 to 8 times.
+// Every output is written next to its source with the .ktx2 extension, where the glTF importer
+// picks it up instead of the original image. An equirectangular HDR converted with --cubemap can be
+// passed to Skybox::init directly.
+//
+// Usage: Texture-Converter [--format bc7|bc5|bc4|bc6h] [--srgb] [--cubemap <size>] <image> [<image> ...]
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "stb_image.h"
+
+#include "tools/BCEncoder.h"
+#include "utility/CompressedTexture.h"
+#include "utility/ThreadPool.h"
+
+namespace {
+    constexpr float PI = 3.14159265359f;
+
+    // Linear float texels, top row first (bottom row first for HDR images, like ResourceManager::loadHDRIPixels)
+    struct Image {
+        int width { 0 };
+        int height { 0 };
+        std::vector<glm::vec4> texels;
+
+        const glm::vec4& at(const int x, const int y) const {
+            return texels[static_cast<size_t>(std::clamp(y, 0, height - 1)) * width + std::clamp(x, 0, width - 1)];
+        }
+    };
+
+    struct Options {
+        CompressedTexture::format format { CompressedTexture::format_unknown };    // unknown picks one per image
+        bool srgb { false };
+        int cubemapSize { 0 };
+    };
+
+    float srgbToLinear(const float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(const float value) {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    bool loadImage(const std::string& path, const bool srgb, Image& image, bool& hdr) {
+        hdr = stbi_is_hdr(path.c_str()) != 0;
+        int components = 0;
+        if (hdr) {
+            stbi_set_flip_vertically_on_load(true);
+            float* pixels = stbi_loadf(path.c_str(), &image.width, &image.height, &components, 4);
+            stbi_set_flip_vertically_on_load(false);
+            if (!pixels) {
+                return false;
+            }
+            image.texels.resize(static_cast<size_t>(image.width) * image.height);
+            std::memcpy(image.texels.data(), pixels, image.texels.size() * sizeof(glm::vec4));
+            stbi_image_free(pixels);
+            return true;
+        }
+
+        unsigned char* pixels = stbi_load(path.c_str(), &image.width, &image.height, &components, 4);
+        if (!pixels) {
+            return false;
+        }
+        image.texels.resize(static_cast<size_t>(image.width) * image.height);
+        for (size_t i = 0; i < image.texels.size(); ++i) {
+            for (int c = 0; c < 4; ++c) {
+                const float value = pixels[i * 4 + c] / 255.0f;
+                image.texels[i][c] = srgb && c < 3 ? srgbToLinear(value) : value;
+            }
+        }
+        stbi_image_free(pixels);
+        return true;
+    }
+
+    // 2x2 box filter, the last row or column is repeated for odd sizes
+    Image downsample(const Image& source, const bool normalMap) {
+        Image level;
+        level.width = std::max(1, source.width / 2);
+        level.height = std::max(1, source.height / 2);
+        level.texels.resize(static_cast<size_t>(level.width) * level.height);
+        for (int y = 0; y < level.height; ++y) {
+            for (int x = 0; x < level.width; ++x) {
+                auto texel = (source.at(x * 2, y * 2) + source.at(x * 2 + 1, y * 2) +
+                              source.at(x * 2, y * 2 + 1) + source.at(x * 2 + 1, y * 2 + 1)) * 0.25f;
+                if (normalMap) {
+                    // Averaged normals get shorter, keep them unit length
+                    const auto normal = glm::vec3(texel) * 2.0f - 1.0f;
+                    const float length = glm::length(normal);
+                    if (length > 0.0f) {
+                        texel = glm::vec4(normal / length * 0.5f + 0.5f, texel.a);
+                    }
+                }
+                level.texels[static_cast<size_t>(y) * level.width + x] = texel;
+            }
+        }
+        return level;
+    }
+
+    // Bilinear lookup with the mapping of shaders/glsl/cubemapConverter.frag
+    glm::vec4 sampleEquirectangular(const Image& image, const glm::vec3& direction) {
+        const float u = (std::atan2(direction.z, direction.x) / (2.0f * PI) + 0.5f) * image.width - 0.5f;
+        const float v = (std::asin(glm::clamp(direction.y, -1.0f, 1.0f)) / PI + 0.5f) * image.height - 0.5f;
+        const int x = static_cast<int>(std::floor(u));
+        const int y = static_cast<int>(std::floor(v));
+        const float fx = u - x;
+        const float fy = v - y;
+        // Wrap around horizontally, clamp at the poles
+        const auto wrap = [&](const int column) { return (column % image.width + image.width) % image.width; };
+        const auto top = glm::mix(image.at(wrap(x), y), image.at(wrap(x + 1), y), fx);
+        const auto bottom = glm::mix(image.at(wrap(x), y + 1), image.at(wrap(x + 1), y + 1), fx);
+        return glm::mix(top, bottom, fy);
+    }
+
+    // Faces in GL order, rows as GL expects them for glCompressedTexSubImage2D
+    std::vector<Image> equirectangularToCubemap(const Image& source, const int size) {
+        std::vector<Image> faces(6);
+        ThreadPool::getInstance().parallelFor(0, 6, [&](const size_t face) {
+            auto& image = faces[face];
+            image.width = size;
+            image.height = size;
+            image.texels.resize(static_cast<size_t>(size) * size);
+            for (int y = 0; y < size; ++y) {
+                const float t = (y + 0.5f) / size * 2.0f - 1.0f;
+                for (int x = 0; x < size; ++x) {
+                    const float s = (x + 0.5f) / size * 2.0f - 1.0f;
+                    glm::vec3 direction;
+                    switch (face) {
+                    case 0: direction = glm::vec3(1.0f, -t, -s); break;
+                    case 1: direction = glm::vec3(-1.0f, -t, s); break;
+                    case 2: direction = glm::vec3(s, 1.0f, t); break;
+                    case 3: direction = glm::vec3(s, -1.0f, -t); break;
+                    case 4: direction = glm::vec3(s, -t, 1.0f); break;
+                    default: direction = glm::vec3(-s, -t, -1.0f); break;
+                    }
+                    image.texels[static_cast<size_t>(y) * size + x] = sampleEquirectangular(source, glm::normalize(direction));
+                }
+            }
+        });
+        return faces;
+    }
+
+    uint8_t toUnorm8(const float value) {
+        return static_cast<uint8_t>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    std::vector<unsigned char> encode(const Image& image, const CompressedTexture::format format, const bool srgb) {
+        const int blocks_x = (image.width + 3) / 4;
+        const int blocks_y = (image.height + 3) / 4;
+        const size_t block_bytes = CompressedTexture::blockBytes(format);
+        std::vector<unsigned char> encoded(CompressedTexture::imageSize(format, image.width, image.height));
+
+        ThreadPool::getInstance().parallelFor(0, blocks_y, [&](const size_t by) {
+            for (int bx = 0; bx < blocks_x; ++bx) {
+                // Partial blocks at the edges repeat the last row and column
+                glm::vec4 texels[16];
+                for (int t = 0; t < 16; ++t) {
+                    texels[t] = image.at(bx * 4 + t % 4, static_cast<int>(by) * 4 + t / 4);
+                }
+
+                uint8_t* block = &encoded[(by * blocks_x + bx) * block_bytes];
+                if (format == CompressedTexture::format_bc6h) {
+                    float rgb[16][3];
+                    for (int t = 0; t < 16; ++t) {
+                        rgb[t][0] = texels[t].r;
+                        rgb[t][1] = texels[t].g;
+                        rgb[t][2] = texels[t].b;
+                    }
+                    BCEncoder::encodeBC6H(rgb, block);
+                }
+                else if (format == CompressedTexture::format_bc7) {
+                    uint8_t rgba[16][4];
+                    for (int t = 0; t < 16; ++t) {
+                        for (int c = 0; c < 4; ++c) {
+                            rgba[t][c] = toUnorm8(srgb && c < 3 ? linearToSrgb(texels[t][c]) : texels[t][c]);
+                        }
+                    }
+                    BCEncoder::encodeBC7(rgba, block);
+                }
+                else {
+                    uint8_t red[16], green[16];
+                    for (int t = 0; t < 16; ++t) {
+                        red[t] = toUnorm8(texels[t].r);
+                        green[t] = toUnorm8(texels[t].g);
+                    }
+                    if (format == CompressedTexture::format_bc5) {
+                        BCEncoder::encodeBC5(red, green, block);
+                    }
+                    else {
+                        BCEncoder::encodeBC4(red, block);
+                    }
+                }
+            }
+        });
+        return encoded;
+    }
+
+    std::string lowercase(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    std::string outputPathOf(const std::string& path) {
+        const auto dot = path.find_last_of('.');
+        const auto separator = path.find_last_of("/\\");
+        const bool has_extension = dot != std::string::npos && (separator == std::string::npos || dot > separator);
+        return (has_extension ? path.substr(0, dot) : path) + ".ktx2";
+    }
+
+    bool convert(const std::string& path, const Options& options) {
+        Image image;
+        bool hdr = false;
+        if (!loadImage(path, options.srgb, image, hdr)) {
+            std::cerr << "Failed to load " << path << ": " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+
+        const auto file_name = lowercase(path.substr(path.find_last_of("/\\") + 1));
+        const bool normal_map = !hdr && file_name.find("normal") != std::string::npos;
+        auto format = options.format;
+        if (format == CompressedTexture::format_unknown) {
+            format = hdr ? CompressedTexture::format_bc6h : normal_map ? CompressedTexture::format_bc5 : CompressedTexture::format_bc7;
+        }
+        if (hdr != (format == CompressedTexture::format_bc6h)) {
+            std::cerr << path << ": BC6H is for HDR images only" << std::endl;
+            return false;
+        }
+        if (options.cubemapSize > 0 && !hdr) {
+            std::cerr << path << ": Only HDR images can be converted to a cubemap" << std::endl;
+            return false;
+        }
+        const bool srgb = options.srgb && format == CompressedTexture::format_bc7;
+
+        std::vector<Image> faces;
+        if (options.cubemapSize > 0) {
+            faces = equirectangularToCubemap(image, options.cubemapSize);
+        }
+        else {
+            faces.push_back(std::move(image));
+        }
+
+        // Level-major like KTX2: every face of level 0, then every face of level 1, ...
+        const auto width = static_cast<uint32_t>(faces[0].width);
+        const auto height = static_cast<uint32_t>(faces[0].height);
+        std::vector<std::vector<unsigned char>> images;
+        size_t uncompressed_size = 0;
+        uint32_t levels = 0;
+        while (true) {
+            for (const auto& face : faces) {
+                images.push_back(encode(face, format, srgb));
+                // Against RGBA8, or RGB16F for HDR, which is what the renderer uploads otherwise
+                uncompressed_size += static_cast<size_t>(face.width) * face.height * (hdr ? 6 : 4);
+            }
+            ++levels;
+            if (faces[0].width == 1 && faces[0].height == 1) {
+                break;
+            }
+            for (auto& face : faces) {
+                face = downsample(face, normal_map && format == CompressedTexture::format_bc5);
+            }
+        }
+
+        const auto output_path = outputPathOf(path);
+        if (!CompressedTexture::writeKTX2(output_path, format, srgb, width, height, static_cast<uint32_t>(faces.size()), images)) {
+            return false;
+        }
+
+        size_t compressed_size = 0;
+        for (const auto& encoded : images) {
+            compressed_size += encoded.size();
+        }
+        const float mb = 1.0f / (1024.0f * 1024.0f);
+        std::cout << "Converted " << path << " -> " << output_path << " (" << CompressedTexture::formatName(format)
+                  << (srgb ? " sRGB" : "") << ", " << width << "x" << height << (faces.size() == 6 ? " cubemap" : "") << ", "
+                  << levels << " levels, " << uncompressed_size * mb << " MB -> " << compressed_size * mb << " MB)" << std::endl;
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if (argument == "--format" && i + 1 < argc) {
+            const auto name = lowercase(argv[++i]);
+            options.format = name == "bc7" ? CompressedTexture::format_bc7
+                : name == "bc5" ? CompressedTexture::format_bc5
+                : name == "bc4" ? CompressedTexture::format_bc4
+                : name == "bc6h" ? CompressedTexture::format_bc6h
+                : CompressedTexture::format_unknown;
+            if (options.format == CompressedTexture::format_unknown) {
+                std::cerr << "Unknown format " << name << std::endl;
+                return 1;
+            }
+        }
+        else if (argument == "--srgb") {
+            options.srgb = true;
+        }
+        else if (argument == "--cubemap" && i + 1 < argc) {
+            options.cubemapSize = std::atoi(argv[++i]);
+            if (options.cubemapSize <= 0) {
+                std::cerr << "Invalid cubemap size " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+        else {
+            inputs.push_back(argument);
+        }
+    }
+
+    if (inputs.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--format bc7|bc5|bc4|bc6h] [--srgb] [--cubemap <size>] <image> [<image> ...]" << std::endl;
+        return 1;
+    }
+
+    int failed = 0;
+    for (const auto& input : inputs) {
+        if (!convert(input, options)) {
+            ++failed;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,413 @@
+#include "CompressedTexture.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    struct FormatInfo {
+        CompressedTexture::format format;
+        const char* name;
+        size_t blockBytes;
+        uint32_t vkFormat;          // VK_FORMAT_BCn_*_UNORM_BLOCK (UFLOAT for BC6H)
+        uint32_t vkFormatSRGB;      // 0 without an sRGB variant
+        uint32_t dxgiFormat;
+        uint32_t dxgiFormatSRGB;
+        uint8_t colorModel;         // KHR_DF_MODEL_BC*
+    };
+
+    constexpr FormatInfo FORMATS[] = {
+        { CompressedTexture::format_bc1, "BC1", 8, 133, 134, 71, 72, 128 },
+        { CompressedTexture::format_bc3, "BC3", 16, 137, 138, 77, 78, 130 },
+        { CompressedTexture::format_bc4, "BC4", 8, 139, 0, 80, 0, 131 },
+        { CompressedTexture::format_bc5, "BC5", 16, 141, 0, 83, 0, 132 },
+        { CompressedTexture::format_bc6h, "BC6H", 16, 143, 0, 95, 0, 133 },
+        { CompressedTexture::format_bc7, "BC7", 16, 145, 146, 98, 99, 134 },
+    };
+
+    // VK_FORMAT_BC1_RGB_UNORM_BLOCK and its sRGB variant, read as BC1 with alpha
+    constexpr uint32_t VK_FORMAT_BC1_RGB = 131;
+    constexpr uint32_t VK_FORMAT_BC1_RGB_SRGB = 132;
+
+    const FormatInfo* findFormat(const CompressedTexture::format textureFormat) {
+        for (const auto& info : FORMATS) {
+            if (info.format == textureFormat) {
+                return &info;
+            }
+        }
+        return nullptr;
+    }
+
+    constexpr unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr size_t KTX2_HEADER_SIZE = 80;
+    constexpr size_t KTX2_LEVEL_SIZE = 24;
+
+    constexpr uint32_t DDS_MAGIC = 0x20534444;     // "DDS "
+    constexpr size_t DDS_HEADER_SIZE = 4 + 124;
+    constexpr size_t DDS_DX10_HEADER_SIZE = 20;
+    constexpr uint32_t DDPF_FOURCC = 0x4;
+    constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+    constexpr uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+    constexpr uint32_t fourCC(const char a, const char b, const char c, const char d) {
+        return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+    }
+
+    uint32_t readUint32(const unsigned char* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint64_t readUint64(const unsigned char* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    template<typename T>
+    void append(std::vector<unsigned char>& out, const T value) {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    void store(std::vector<unsigned char>& out, const size_t offset, const T value) {
+        std::memcpy(out.data() + offset, &value, sizeof(T));
+    }
+
+    // Khronos basic data format descriptor, which KTX2 requires even for block-compressed formats
+    std::vector<unsigned char> makeDataFormatDescriptor(const FormatInfo& info, const bool srgb) {
+        struct Sample {
+            uint16_t bitOffset;
+            uint8_t channel;
+            uint8_t qualifiers;
+            uint32_t lower;
+            uint32_t upper;
+        };
+        constexpr uint8_t CHANNEL_ALPHA = 15;
+        constexpr uint8_t QUALIFIER_FLOAT = 0x80;
+
+        std::vector<Sample> samples;
+        const uint16_t bits = static_cast<uint16_t>(info.blockBytes * 8);
+        switch (info.format) {
+        case CompressedTexture::format_bc3:
+            samples = { { 0, CHANNEL_ALPHA, 0, 0, 0xFFFFFFFF }, { 64, 0, 0, 0, 0xFFFFFFFF } };
+            break;
+        case CompressedTexture::format_bc5:
+            samples = { { 0, 0, 0, 0, 0xFFFFFFFF }, { 64, 1, 0, 0, 0xFFFFFFFF } };
+            break;
+        case CompressedTexture::format_bc6h:
+            samples = { { 0, 0, QUALIFIER_FLOAT, 0, 0x3F800000 } };     // 0.0f to 1.0f
+            break;
+        default:
+            samples = { { 0, 0, 0, 0, 0xFFFFFFFF } };
+            break;
+        }
+        const uint16_t sample_bits = static_cast<uint16_t>(bits / samples.size());
+
+        const uint16_t block_size = static_cast<uint16_t>(24 + 16 * samples.size());
+        std::vector<unsigned char> dfd;
+        append<uint32_t>(dfd, 4u + block_size);       // dfdTotalSize
+        append<uint32_t>(dfd, 0);                      // vendorId and descriptorType: Khronos basic
+        append<uint16_t>(dfd, 2);                      // versionNumber
+        append<uint16_t>(dfd, block_size);
+        dfd.push_back(info.colorModel);
+        dfd.push_back(1);                              // BT.709 primaries
+        dfd.push_back(srgb ? 2 : 1);                   // sRGB or linear transfer
+        dfd.push_back(0);                              // straight alpha
+        const unsigned char block_dimensions[4] = { 3, 3, 0, 0 };
+        dfd.insert(dfd.end(), block_dimensions, block_dimensions + 4);
+        unsigned char bytes_plane[8] = {};
+        bytes_plane[0] = static_cast<unsigned char>(info.blockBytes);
+        dfd.insert(dfd.end(), bytes_plane, bytes_plane + 8);
+        for (const auto& sample : samples) {
+            append<uint16_t>(dfd, sample.bitOffset);
+            dfd.push_back(static_cast<unsigned char>(sample_bits - 1));
+            dfd.push_back(sample.channel | sample.qualifiers);
+            append<uint32_t>(dfd, 0);                  // sample position
+            append<uint32_t>(dfd, sample.lower);
+            append<uint32_t>(dfd, sample.upper);
+        }
+        return dfd;
+    }
+}
+
+size_t CompressedTexture::blockBytes(const format textureFormat) {
+    const auto* info = findFormat(textureFormat);
+    return info ? info->blockBytes : 0;
+}
+
+size_t CompressedTexture::imageSize(const format textureFormat, const uint32_t width, const uint32_t height) {
+    const size_t blocks_x = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const size_t blocks_y = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    return blocks_x * blocks_y * blockBytes(textureFormat);
+}
+
+const char* CompressedTexture::formatName(const format textureFormat) {
+    const auto* info = findFormat(textureFormat);
+    return info ? info->name : "unknown";
+}
+
+bool CompressedTexture::isContainerPath(const std::string& path) {
+    const auto dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == "ktx2" || extension == "dds";
+}
+
+uint32_t CompressedTexture::getLevelWidth(const uint32_t level) const {
+    return std::max(1u, m_width >> level);
+}
+
+uint32_t CompressedTexture::getLevelHeight(const uint32_t level) const {
+    return std::max(1u, m_height >> level);
+}
+
+size_t CompressedTexture::getDataSize() const {
+    size_t size = 0;
+    for (const auto& image : m_images) {
+        size += image.size;
+    }
+    return size;
+}
+
+bool CompressedTexture::parse(const unsigned char* data, const size_t size) {
+    m_format = format_unknown;
+    m_images.clear();
+
+    const bool parsed = size >= sizeof(KTX2_IDENTIFIER) && std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0
+        ? parseKTX2(data, size)
+        : size >= 4 && readUint32(data) == DDS_MAGIC && parseDDS(data, size);
+    if (!parsed || !validate()) {
+        m_format = format_unknown;
+        m_images.clear();
+        return false;
+    }
+    return true;
+}
+
+bool CompressedTexture::parseKTX2(const unsigned char* data, const size_t size) {
+    if (size < KTX2_HEADER_SIZE) {
+        std::cerr << "Compressed Texture: Truncated KTX2 header" << std::endl;
+        return false;
+    }
+
+    const uint32_t vk_format = readUint32(data + 12);
+    m_width = readUint32(data + 20);
+    m_height = readUint32(data + 24);
+    const uint32_t depth = readUint32(data + 28);
+    const uint32_t layers = readUint32(data + 32);
+    m_faces = readUint32(data + 36);
+    m_levels = std::max(1u, readUint32(data + 40));
+    const uint32_t supercompression = readUint32(data + 44);
+
+    if (supercompression != 0) {
+        std::cerr << "Compressed Texture: Supercompressed KTX2 (scheme " << supercompression << ") is not supported" << std::endl;
+        return false;
+    }
+    if (depth > 1 || layers > 1) {
+        std::cerr << "Compressed Texture: Only 2D textures and cubemaps are supported" << std::endl;
+        return false;
+    }
+
+    for (const auto& info : FORMATS) {
+        if (vk_format == info.vkFormat || (info.vkFormatSRGB && vk_format == info.vkFormatSRGB)) {
+            m_format = info.format;
+            m_srgb = vk_format == info.vkFormatSRGB;
+        }
+    }
+    if (vk_format == VK_FORMAT_BC1_RGB || vk_format == VK_FORMAT_BC1_RGB_SRGB) {
+        m_format = format_bc1;
+        m_srgb = vk_format == VK_FORMAT_BC1_RGB_SRGB;
+    }
+    if (m_format == format_unknown) {
+        std::cerr << "Compressed Texture: Unsupported KTX2 format " << vk_format << std::endl;
+        return false;
+    }
+
+    if (KTX2_HEADER_SIZE + static_cast<size_t>(m_levels) * KTX2_LEVEL_SIZE > size || m_faces == 0) {
+        std::cerr << "Compressed Texture: Truncated KTX2 level index" << std::endl;
+        return false;
+    }
+    m_images.resize(static_cast<size_t>(m_levels) * m_faces);
+    for (uint32_t level = 0; level < m_levels; ++level) {
+        const unsigned char* entry = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE;
+        const uint64_t offset = readUint64(entry);
+        const uint64_t length = readUint64(entry + 8);
+        if (offset > size || length > size - offset) {
+            std::cerr << "Compressed Texture: KTX2 level " << level << " out of range" << std::endl;
+            return false;
+        }
+        // Faces are stored one after the other within a level
+        const size_t face_size = static_cast<size_t>(length / m_faces);
+        for (uint32_t face = 0; face < m_faces; ++face) {
+            m_images[level * m_faces + face] = { data + offset + face * face_size, face_size };
+        }
+    }
+    return true;
+}
+
+bool CompressedTexture::parseDDS(const unsigned char* data, const size_t size) {
+    if (size < DDS_HEADER_SIZE || readUint32(data + 4) != 124) {
+        std::cerr << "Compressed Texture: Invalid DDS header" << std::endl;
+        return false;
+    }
+
+    m_height = readUint32(data + 12);
+    m_width = readUint32(data + 16);
+    m_levels = std::max(1u, readUint32(data + 28));
+    const uint32_t pixel_flags = readUint32(data + 80);
+    const uint32_t four_cc = readUint32(data + 84);
+    const uint32_t caps2 = readUint32(data + 112);
+    m_faces = caps2 & DDSCAPS2_CUBEMAP ? 6 : 1;
+
+    if (!(pixel_flags & DDPF_FOURCC)) {
+        std::cerr << "Compressed Texture: Uncompressed DDS files are not supported" << std::endl;
+        return false;
+    }
+
+    size_t offset = DDS_HEADER_SIZE;
+    m_srgb = false;
+    if (four_cc == fourCC('D', 'X', '1', '0')) {
+        if (size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE) {
+            std::cerr << "Compressed Texture: Truncated DDS DX10 header" << std::endl;
+            return false;
+        }
+        const uint32_t dxgi_format = readUint32(data + DDS_HEADER_SIZE);
+        const uint32_t misc_flags = readUint32(data + DDS_HEADER_SIZE + 8);
+        const uint32_t array_size = readUint32(data + DDS_HEADER_SIZE + 12);
+        if (array_size > 1) {
+            std::cerr << "Compressed Texture: DDS texture arrays are not supported" << std::endl;
+            return false;
+        }
+        m_faces = misc_flags & DDS_RESOURCE_MISC_TEXTURECUBE ? 6 : 1;
+        offset += DDS_DX10_HEADER_SIZE;
+
+        for (const auto& info : FORMATS) {
+            if (dxgi_format == info.dxgiFormat || (info.dxgiFormatSRGB && dxgi_format == info.dxgiFormatSRGB)) {
+                m_format = info.format;
+                m_srgb = dxgi_format == info.dxgiFormatSRGB;
+            }
+        }
+        if (m_format == format_unknown) {
+            std::cerr << "Compressed Texture: Unsupported DXGI format " << dxgi_format << std::endl;
+            return false;
+        }
+    }
+    else if (four_cc == fourCC('D', 'X', 'T', '1')) {
+        m_format = format_bc1;
+    }
+    else if (four_cc == fourCC('D', 'X', 'T', '5')) {
+        m_format = format_bc3;
+    }
+    else if (four_cc == fourCC('A', 'T', 'I', '1') || four_cc == fourCC('B', 'C', '4', 'U')) {
+        m_format = format_bc4;
+    }
+    else if (four_cc == fourCC('A', 'T', 'I', '2') || four_cc == fourCC('B', 'C', '5', 'U')) {
+        m_format = format_bc5;
+    }
+    else {
+        std::cerr << "Compressed Texture: Unsupported DDS FourCC" << std::endl;
+        return false;
+    }
+
+    // The level count sizes the image table below, validate() only checks it afterwards
+    if (m_levels > 32) {
+        std::cerr << "Compressed Texture: Too many mip levels (" << m_levels << ")" << std::endl;
+        return false;
+    }
+
+    // DDS stores every face with its whole mip chain, one face after the other
+    m_images.resize(static_cast<size_t>(m_levels) * m_faces);
+    for (uint32_t face = 0; face < m_faces; ++face) {
+        for (uint32_t level = 0; level < m_levels; ++level) {
+            const size_t image_size = imageSize(m_format, getLevelWidth(level), getLevelHeight(level));
+            if (offset + image_size > size) {
+                std::cerr << "Compressed Texture: Truncated DDS data" << std::endl;
+                return false;
+            }
+            m_images[level * m_faces + face] = { data + offset, image_size };
+            offset += image_size;
+        }
+    }
+    return true;
+}
+
+bool CompressedTexture::validate() const {
+    if (m_width == 0 || m_height == 0 || (m_faces != 1 && m_faces != 6) || (m_faces == 6 && m_width != m_height)) {
+        std::cerr << "Compressed Texture: Invalid dimensions " << m_width << "x" << m_height << " with " << m_faces << " faces" << std::endl;
+        return false;
+    }
+    if (m_levels > 32 || (std::max(m_width, m_height) >> (m_levels - 1)) == 0) {
+        std::cerr << "Compressed Texture: Too many mip levels (" << m_levels << ")" << std::endl;
+        return false;
+    }
+    for (uint32_t level = 0; level < m_levels; ++level) {
+        const size_t expected = imageSize(m_format, getLevelWidth(level), getLevelHeight(level));
+        for (uint32_t face = 0; face < m_faces; ++face) {
+            if (getImage(level, face).size != expected) {
+                std::cerr << "Compressed Texture: Level " << level << " has " << getImage(level, face).size << " bytes, expected " << expected << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool CompressedTexture::writeKTX2(const std::string& path, const format textureFormat, const bool srgb, const uint32_t width,
+                                  const uint32_t height, const uint32_t faces, const std::vector<std::vector<unsigned char>>& images) {
+    const auto* info = findFormat(textureFormat);
+    if (!info || faces == 0 || images.empty() || images.size() % faces != 0 || (srgb && !info->vkFormatSRGB)) {
+        std::cerr << "Compressed Texture: Invalid KTX2 image set for " << path << std::endl;
+        return false;
+    }
+    const auto levels = static_cast<uint32_t>(images.size() / faces);
+
+    std::vector<unsigned char> out(sizeof(KTX2_IDENTIFIER));
+    std::memcpy(out.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    append<uint32_t>(out, srgb ? info->vkFormatSRGB : info->vkFormat);
+    append<uint32_t>(out, 1);          // typeSize
+    append<uint32_t>(out, width);
+    append<uint32_t>(out, height);
+    append<uint32_t>(out, 0);          // pixelDepth
+    append<uint32_t>(out, 0);          // layerCount
+    append<uint32_t>(out, faces);
+    append<uint32_t>(out, levels);
+    append<uint32_t>(out, 0);          // supercompressionScheme
+
+    // Index and level table are filled in once the offsets are known
+    out.resize(KTX2_HEADER_SIZE + levels * KTX2_LEVEL_SIZE);
+
+    const auto dfd = makeDataFormatDescriptor(*info, srgb);
+    const size_t dfd_offset = out.size();
+    out.insert(out.end(), dfd.begin(), dfd.end());
+    store<uint32_t>(out, 48, static_cast<uint32_t>(dfd_offset));
+    store<uint32_t>(out, 52, static_cast<uint32_t>(dfd.size()));
+
+    // Smallest level first, each one aligned to the block size
+    for (uint32_t level = levels; level-- > 0;) {
+        out.resize((out.size() + info->blockBytes - 1) / info->blockBytes * info->blockBytes);
+        const size_t level_offset = out.size();
+        for (uint32_t face = 0; face < faces; ++face) {
+            const auto& image = images[level * faces + face];
+            out.insert(out.end(), image.begin(), image.end());
+        }
+        const size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE;
+        store<uint64_t>(out, entry, level_offset);
+        store<uint64_t>(out, entry + 8, out.size() - level_offset);
+        store<uint64_t>(out, entry + 16, out.size() - level_offset);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file || !file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()))) {
+        std::cerr << "Compressed Texture: Could not write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef COMPRESSED_TEXTURE_H
+#define COMPRESSED_TEXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Block-compressed (BCn) 2D texture or cubemap with its mip chain, read from a KTX2 or DDS container.
+// parse() only indexes the container, the images point into the caller's bytes.
+class CompressedTexture {
+    public:
+        enum format { format_unknown, format_bc1, format_bc3, format_bc4, format_bc5, format_bc6h, format_bc7 };
+
+        struct Image {
+            const unsigned char* data;
+            size_t size;
+        };
+
+        static constexpr uint32_t BLOCK_SIZE = 4;
+
+        // Bytes per 4x4 block
+        static size_t blockBytes(const format textureFormat);
+        static size_t imageSize(const format textureFormat, const uint32_t width, const uint32_t height);
+        static const char* formatName(const format textureFormat);
+
+        // True for the .ktx2 and .dds extensions
+        static bool isContainerPath(const std::string& path);
+
+        bool parse(const unsigned char* data, const size_t size);
+
+        // images holds levels * faces images, face-major within a level like getImage()
+        static bool writeKTX2(const std::string& path, const format textureFormat, const bool srgb, const uint32_t width,
+                              const uint32_t height, const uint32_t faces, const std::vector<std::vector<unsigned char>>& images);
+
+        format getFormat() const { return m_format; }
+        bool isSRGB() const { return m_srgb; }
+        uint32_t getWidth() const { return m_width; }
+        uint32_t getHeight() const { return m_height; }
+        uint32_t getFaceCount() const { return m_faces; }
+        uint32_t getLevelCount() const { return m_levels; }
+        uint32_t getLevelWidth(const uint32_t level) const;
+        uint32_t getLevelHeight(const uint32_t level) const;
+        const Image& getImage(const uint32_t level, const uint32_t face) const { return m_images[level * m_faces + face]; }
+        // Bytes of every image, what the texture takes in video memory
+        size_t getDataSize() const;
+
+    private:
+        bool parseKTX2(const unsigned char* data, const size_t size);
+        bool parseDDS(const unsigned char* data, const size_t size);
+        // Checks the dimensions and that every image has the size its format implies
+        bool validate() const;
+
+        format m_format { format_unknown };
+        bool m_srgb { false };
+        uint32_t m_width { 0 };
+        uint32_t m_height { 0 };
+        uint32_t m_faces { 0 };
+        uint32_t m_levels { 0 };
+        std::vector<Image> m_images;
+};
+
+#endif
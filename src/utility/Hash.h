@@ -0,0 +1,111 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Non-cryptographic 64-bit hash used to key the on-disk caches.
+// Consumes 32 bytes per step in four independent lanes (xxHash64 layout), so hashing a mapped
+// source file costs about as much as reading it.
+namespace Hash {
+    namespace detail {
+        constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+        constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+        constexpr uint64_t PRIME3 = 0x165667B19E3779F9ull;
+        constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+        constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+        inline uint64_t rotl(const uint64_t x, const int r) {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        inline uint64_t read64(const unsigned char* p) {
+            uint64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline uint32_t read32(const unsigned char* p) {
+            uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline uint64_t round(uint64_t acc, const uint64_t input) {
+            acc += input * PRIME2;
+            acc = rotl(acc, 31);
+            return acc * PRIME1;
+        }
+
+        inline uint64_t mergeRound(uint64_t acc, const uint64_t value) {
+            acc ^= round(0, value);
+            return acc * PRIME1 + PRIME4;
+        }
+    }
+
+    inline uint64_t hash64(const void* data, const size_t size, const uint64_t seed = 0) {
+        using namespace detail;
+
+        const auto* p = static_cast<const unsigned char*>(data);
+        const auto* const end = p + size;
+        uint64_t h;
+
+        if (size >= 32) {
+            uint64_t v1 = seed + PRIME1 + PRIME2;
+            uint64_t v2 = seed + PRIME2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - PRIME1;
+
+            const auto* const limit = end - 32;
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        } else {
+            h = seed + PRIME5;
+        }
+
+        h += static_cast<uint64_t>(size);
+
+        for (; p + 8 <= end; p += 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * PRIME1 + PRIME4;
+        }
+        if (p + 4 <= end) {
+            h ^= static_cast<uint64_t>(read32(p)) * PRIME1;
+            h = rotl(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= (*p) * PRIME5;
+            h = rotl(h, 11) * PRIME1;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    inline uint64_t hash64(const std::string& value, const uint64_t seed = 0) {
+        return hash64(value.data(), value.size(), seed);
+    }
+
+    inline uint64_t combine(const uint64_t seed, const uint64_t value) {
+        return detail::mergeRound(seed, value);
+    }
+}
+
+#endif
@@ -1,6 +1,131 @@
 #include "ImGuiRenderer.h"
 
+#include <algorithm>
+#include <vector>
+
+#include "Profiler.h"
+#include "ResourceManager.h"
+#include "../graphic/GLMeshArena.h"
+#include "../graphic/GLTextureStreamer.h"
+
 bool ImGuiRenderer::render_wireframe = false;
+bool ImGuiRenderer::render_indirect = true;
+bool ImGuiRenderer::frustum_culling = true;
+float ImGuiRenderer::lod_error = 1.0f;
+bool ImGuiRenderer::meshlet_culling = true;
+uint32_t ImGuiRenderer::visible_primitives = 0;
+uint32_t ImGuiRenderer::culled_primitives = 0;
+uint64_t ImGuiRenderer::lod_triangles = 0;
+uint64_t ImGuiRenderer::full_triangles = 0;
+uint32_t ImGuiRenderer::visible_meshlets = 0;
+uint32_t ImGuiRenderer::culled_meshlets = 0;
+GLStats::Counters ImGuiRenderer::frame_counters;
+int32_t ImGuiRenderer::hovered_primitive = -1;
+
+namespace {
+    constexpr float TIMELINE_ROW_HEIGHT = 18.0f;
+
+    ImU32 zoneColor(const char* name) {
+        // Stable color per zone name
+        uint32_t hash = 2166136261u;
+        for (const char* c = name; *c; ++c) {
+            hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+        }
+        return ImColor::HSV((hash % 360) / 360.0f, 0.55f, 0.75f);
+    }
+
+    // One row per nesting depth, zones placed on the frame's time axis
+    void drawTimelineRows(const char* label, const std::vector<Profiler::Zone>& zones, const double frameStart, const double frameDuration) {
+        // Every thread gets as many rows as the deepest nesting, worker threads go below the first one
+        uint32_t depth_rows = 0, threads = 0;
+        for (const auto& zone : zones) {
+            depth_rows = std::max(depth_rows, zone.depth + 1);
+            threads = std::max(threads, zone.thread + 1);
+        }
+        const uint32_t rows = depth_rows * threads;
+        ImGui::Text("%s", label);
+        if (rows == 0) {
+            ImGui::TextDisabled("  no zones");
+            return;
+        }
+
+        auto* draw_list = ImGui::GetWindowDrawList();
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+        const float scale = width / static_cast<float>(std::max(frameDuration, 0.001));
+        const ImVec2 mouse = ImGui::GetIO().MousePos;
+
+        for (const auto& zone : zones) {
+            const float row = static_cast<float>(zone.thread * depth_rows + zone.depth);
+            const float x0 = origin.x + std::max(0.0f, static_cast<float>(zone.start - frameStart) * scale);
+            const float x1 = origin.x + std::min(width, static_cast<float>(zone.end - frameStart) * scale);
+            if (x1 < origin.x || x0 > origin.x + width) {
+                continue;
+            }
+            const ImVec2 min(x0, origin.y + row * TIMELINE_ROW_HEIGHT);
+            const ImVec2 max(std::max(x1, x0 + 1.0f), min.y + TIMELINE_ROW_HEIGHT - 1.0f);
+            draw_list->AddRectFilled(min, max, zoneColor(zone.name));
+
+            const ImVec2 text_size = ImGui::CalcTextSize(zone.name);
+            if (text_size.x + 4.0f < max.x - min.x) {
+                draw_list->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32_WHITE, zone.name);
+            }
+            if (mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+                ImGui::SetTooltip("%s\n%.3f ms", zone.name, zone.end - zone.start);
+            }
+        }
+        ImGui::Dummy(ImVec2(width, rows * TIMELINE_ROW_HEIGHT));
+    }
+
+    void drawProfiler() {
+        auto& profiler = Profiler::getInstance();
+        bool paused = profiler.isPaused();
+        if (ImGui::Checkbox("Pause", &paused)) {
+            profiler.setPaused(paused);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export Chrome trace")) {
+            profiler.exportChromeTrace("profile_trace.json");
+        }
+
+        const auto& history = profiler.getHistory();
+        if (history.empty()) {
+            ImGui::TextDisabled("Waiting for frames");
+            return;
+        }
+
+        // Rolling frame times, hovering a bar shows that frame below
+        std::vector<float> frame_times;
+        frame_times.reserve(history.size());
+        float max_time = 0.0f;
+        for (const auto& frame : history) {
+            frame_times.push_back(static_cast<float>(frame.getDuration()));
+            max_time = std::max(max_time, frame_times.back());
+        }
+        ImGui::PlotHistogram("##frame_times", frame_times.data(), static_cast<int>(frame_times.size()), 0, nullptr, 0.0f, max_time * 1.1f, ImVec2(-1.0f, 50.0f));
+
+        size_t selected = history.size() - 1;
+        if (ImGui::IsItemHovered()) {
+            const float t = (ImGui::GetIO().MousePos.x - ImGui::GetItemRectMin().x) / std::max(ImGui::GetItemRectSize().x, 1.0f);
+            selected = std::min(history.size() - 1, static_cast<size_t>(std::max(t, 0.0f) * history.size()));
+        }
+
+        const auto& frame = history[selected];
+        ImGui::Text("Frame %llu: %.3f ms", static_cast<unsigned long long>(frame.index), frame.getDuration());
+        if (profiler.getDroppedGpuZones() > 0) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("(%llu GPU zones dropped)", static_cast<unsigned long long>(profiler.getDroppedGpuZones()));
+        }
+        drawTimelineRows("CPU", frame.cpuZones, frame.start, frame.getDuration());
+
+        // The GPU runs behind the CPU, its rows start at the frame's first GPU zone on the same scale
+        double gpu_start = frame.gpuZones.empty() ? frame.start : frame.gpuZones.front().start;
+        for (const auto& zone : frame.gpuZones) {
+            gpu_start = std::min(gpu_start, zone.start);
+        }
+        drawTimelineRows("GPU", frame.gpuZones, gpu_start, frame.getDuration());
+    }
+}
 
 void ImGuiRenderer::setupImGui(GLFWwindow* window) {
     // Setup Dear ImGui content
@@ -27,6 +152,52 @@ void ImGuiRenderer::renderImGui() {
         if (ImGui::CollapsingHeader("Settings"))
         {
             ImGui::Checkbox("Wireframe", &render_wireframe);
+            ImGui::Checkbox("Multi-draw indirect", &render_indirect);
+            ImGui::Checkbox("Frustum culling", &frustum_culling);
+            ImGui::SliderFloat("LOD error (px)", &lod_error, 0.0f, 8.0f);
+            ImGui::Checkbox("Meshlet culling", &meshlet_culling);
+        }
+
+        if (ImGui::CollapsingHeader("Statistics"))
+        {
+            const auto& arena = GLMeshArena::getInstance();
+            const float mb = 1.0f / (1024.0f * 1024.0f);
+            ImGui::Text("Mesh arena: %d allocations", static_cast<int>(arena.getAllocationCount()));
+            ImGui::Text("  vertices %.2f / %.2f MB, %s %d bytes", arena.getVertexBytesUsed() * mb, arena.getVertexBytesCapacity() * mb,
+                        arena.getVertexLayout().name, static_cast<int>(arena.getVertexLayout().stride));
+            ImGui::Text("  indices  %.2f / %.2f MB", arena.getIndexBytesUsed() * mb, arena.getIndexBytesCapacity() * mb);
+            ImGui::Text("Primitives: %u visible, %u culled", visible_primitives, culled_primitives);
+            ImGui::Text("Triangles: %llu of %llu at full detail", static_cast<unsigned long long>(lod_triangles),
+                        static_cast<unsigned long long>(full_triangles));
+            ImGui::Text("Meshlets: %u visible, %u culled", visible_meshlets, culled_meshlets);
+            ImGui::Text("GL: %d draws, %d binds issued, %d skipped", static_cast<int>(frame_counters.drawCalls),
+                        static_cast<int>(frame_counters.getStateChanges()), static_cast<int>(frame_counters.skippedBinds));
+            const auto& streamer = GLTextureStreamer::getInstance();
+            ImGui::Text("Textures: %d streaming, %.2f MB uploaded", static_cast<int>(streamer.getPendingCount()), streamer.getUploadedBytes() * mb);
+            if (streamer.getMipResidency()) {
+                ImGui::Text("  mips resident %.2f / %.2f MB", streamer.getResidentBytes() * mb, streamer.getFullChainBytes() * mb);
+            }
+            auto& texture_cache = ResourceManager::getInstance().getTextureCache();
+            const auto& texture_stats = texture_cache.getStats();
+            ImGui::Text("Texture cache: %d resident (%d unused), %.2f MB", static_cast<int>(texture_stats.residentCount),
+                        static_cast<int>(texture_stats.unusedCount), texture_stats.residentBytes * mb);
+            ImGui::Text("  %llu hits, %llu misses, %llu evictions", static_cast<unsigned long long>(texture_stats.hits),
+                        static_cast<unsigned long long>(texture_stats.misses), static_cast<unsigned long long>(texture_stats.evictions));
+            int budget_mb = static_cast<int>(texture_cache.getBudget() / (1024 * 1024));
+            if (ImGui::SliderInt("Texture budget (MB)", &budget_mb, 0, 4096)) {
+                texture_cache.setBudget(static_cast<size_t>(budget_mb) * 1024 * 1024);
+            }
+            if (hovered_primitive >= 0) {
+                ImGui::Text("Hovered primitive: %d", hovered_primitive);
+            }
+            else {
+                ImGui::TextDisabled("Hovered primitive: none");
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Profiler"))
+        {
+            drawProfiler();
         }
 
         ImGui::End();
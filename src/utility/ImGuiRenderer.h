@@ -5,6 +5,10 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <cstdint>
+
+#include "../graphic/GLStats.h"
+
 class ImGuiRenderer {
     public:
         static auto& getInstance() {
@@ -17,6 +21,26 @@ class ImGuiRenderer {
         void destroyImGui();
 
         static bool render_wireframe;
+        static bool render_indirect;
+        static bool frustum_culling;
+        // Screen-space error in pixels allowed for levels of detail, 0 draws full detail
+        static float lod_error;
+        // Cull meshlets by bounding sphere and normal cone, only the indirect path draws the result
+        static bool meshlet_culling;
+
+        // Primitives drawn and skipped by frustum culling in the last frame
+        static uint32_t visible_primitives;
+        static uint32_t culled_primitives;
+        // Triangles of the visible primitives at their level of detail and at full detail
+        static uint64_t lod_triangles;
+        static uint64_t full_triangles;
+        // Meshlets of the full detail primitives drawn and skipped by meshlet culling
+        static uint32_t visible_meshlets;
+        static uint32_t culled_meshlets;
+        // GL calls of the last frame, ImGui's own excluded
+        static GLStats::Counters frame_counters;
+        // Primitive under the cursor, -1 for none
+        static int32_t hovered_primitive;
 };
 
 #endif
\ No newline at end of file
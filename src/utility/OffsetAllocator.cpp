@@ -0,0 +1,103 @@
+#include "OffsetAllocator.h"
+
+#include <cassert>
+
+OffsetAllocator::OffsetAllocator(size_t size) {
+    reset(size);
+}
+
+void OffsetAllocator::reset(size_t size) {
+    m_freeByOffset.clear();
+    m_freeBySize.clear();
+    m_size = size;
+    m_used = 0;
+    if (size > 0) {
+        insertFreeRange(0, size);
+    }
+}
+
+size_t OffsetAllocator::allocate(size_t size, size_t alignment) {
+    if (size == 0) {
+        return INVALID_OFFSET;
+    }
+
+    // Smallest free range that still fits the request once its start is aligned
+    for (auto it = m_freeBySize.lower_bound(size); it != m_freeBySize.end(); ++it) {
+        const auto range_offset = it->second;
+        const auto range_size = it->first;
+        const auto aligned = (range_offset + alignment - 1) / alignment * alignment;
+        const auto padding = aligned - range_offset;
+        if (padding + size > range_size) {
+            continue;
+        }
+
+        eraseFreeRange(m_freeByOffset.find(range_offset));
+        if (padding > 0) {
+            insertFreeRange(range_offset, padding);
+        }
+        if (padding + size < range_size) {
+            insertFreeRange(aligned + size, range_size - padding - size);
+        }
+
+        m_used += size;
+        return aligned;
+    }
+
+    return INVALID_OFFSET;
+}
+
+void OffsetAllocator::free(size_t offset, size_t size) {
+    if (size == 0 || offset == INVALID_OFFSET) {
+        return;
+    }
+    assert(offset + size <= m_size);
+    m_used -= size;
+
+    // Merge with the free neighbours on both sides
+    auto next = m_freeByOffset.lower_bound(offset);
+    if (next != m_freeByOffset.end() && next->first == offset + size) {
+        size += next->second;
+        eraseFreeRange(next);
+    }
+
+    auto previous = m_freeByOffset.lower_bound(offset);
+    if (previous != m_freeByOffset.begin()) {
+        --previous;
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            eraseFreeRange(previous);
+        }
+    }
+
+    insertFreeRange(offset, size);
+}
+
+void OffsetAllocator::grow(size_t new_size) {
+    if (new_size <= m_size) {
+        return;
+    }
+
+    const auto old_size = m_size;
+    const auto added = new_size - old_size;
+    m_size = new_size;
+    // Hand the new space out through free() so it merges with a free range at the old end
+    m_used += added;
+    free(old_size, added);
+}
+
+void OffsetAllocator::insertFreeRange(size_t offset, size_t size) {
+    m_freeByOffset.emplace(offset, size);
+    m_freeBySize.emplace(size, offset);
+}
+
+void OffsetAllocator::eraseFreeRange(std::map<size_t, size_t>::iterator range) {
+    auto sizes = m_freeBySize.equal_range(range->second);
+    for (auto it = sizes.first; it != sizes.second; ++it) {
+        if (it->second == range->first) {
+            m_freeBySize.erase(it);
+            break;
+        }
+    }
+    m_freeByOffset.erase(range);
+}
@@ -0,0 +1,35 @@
+#ifndef OFFSET_ALLOCATOR_H
+#define OFFSET_ALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+
+// Sub-allocates ranges of a linear address space (e.g. a GL buffer) without touching the memory itself.
+// Best fit over a size-ordered free list; neighbouring free ranges are merged on free.
+class OffsetAllocator {
+    public:
+        static constexpr size_t INVALID_OFFSET = ~size_t(0);
+
+        explicit OffsetAllocator(size_t size = 0);
+
+        size_t allocate(size_t size, size_t alignment = 1);
+        void free(size_t offset, size_t size);
+        // Appends free space at the end, existing allocations keep their offsets
+        void grow(size_t new_size);
+        void reset(size_t size);
+
+        size_t getSize() const { return m_size; }
+        size_t getUsed() const { return m_used; }
+        size_t getFreeRangeCount() const { return m_freeByOffset.size(); }
+
+    private:
+        void insertFreeRange(size_t offset, size_t size);
+        void eraseFreeRange(std::map<size_t, size_t>::iterator range);
+
+        std::map<size_t, size_t> m_freeByOffset;        // offset -> size
+        std::multimap<size_t, size_t> m_freeBySize;     // size -> offset
+        size_t m_size { 0 };
+        size_t m_used { 0 };
+};
+
+#endif
@@ -0,0 +1,229 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Frames whose GPU zones are still waiting for results; beyond this the oldest is dropped
+    constexpr size_t MAX_FRAMES_IN_FLIGHT = 16;
+
+    thread_local uint32_t cpu_depth = 0;
+
+    void writeEvent(std::ostream& out, bool& first, const Profiler::Zone& zone, const int process) {
+        char event[256];
+        std::snprintf(event, sizeof(event), "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                      first ? "" : ",", zone.name, process, zone.thread, zone.start * 1000.0, (zone.end - zone.start) * 1000.0);
+        out << event;
+        first = false;
+    }
+}
+
+Profiler::Profiler()
+: m_epoch(std::chrono::steady_clock::now()) {
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+Profiler::CpuZone::CpuZone(const char* name)
+: m_name(name), m_start(Profiler::getInstance().now()), m_depth(cpu_depth++) {
+}
+
+Profiler::CpuZone::~CpuZone() {
+    --cpu_depth;
+    auto& profiler = Profiler::getInstance();
+    profiler.addCpuZone({ m_name, m_start, profiler.now(), m_depth, 0 });
+}
+
+Profiler::GpuZone::GpuZone(const char* name)
+: m_name(name), m_query(0), m_depth(0), m_active(false) {
+    auto& profiler = Profiler::getInstance();
+    profiler.initGpu();
+    if (!profiler.m_gpuSupported) {
+        return;
+    }
+    if (!profiler.allocateQueries(m_query)) {
+        ++profiler.m_droppedGpuZones;
+        return;
+    }
+
+    m_active = true;
+    m_depth = profiler.m_gpuDepth++;
+    glQueryCounter(profiler.getQuery(m_query), GL_TIMESTAMP);
+}
+
+Profiler::GpuZone::~GpuZone() {
+    if (!m_active) {
+        return;
+    }
+
+    auto& profiler = Profiler::getInstance();
+    glQueryCounter(profiler.getQuery(m_query + 1), GL_TIMESTAMP);
+    --profiler.m_gpuDepth;
+    profiler.m_current.gpuZones.push_back({ m_name, m_query, m_depth });
+}
+
+void Profiler::initGpu() {
+    if (m_gpuInitialized) {
+        return;
+    }
+    m_gpuInitialized = true;
+
+    GLint timestamp_bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestamp_bits);
+    m_gpuSupported = timestamp_bits > 0;
+    if (!m_gpuSupported) {
+        std::cerr << "Profiler: No timestamp queries, GPU zones are disabled" << std::endl;
+        return;
+    }
+
+    m_queries.resize(QUERY_RING_SIZE);
+    glGenQueries(QUERY_RING_SIZE, m_queries.data());
+
+    // Place GPU timestamps on the CPU timeline
+    GLint64 gpu_time = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+    m_gpuOffset = gpu_time - static_cast<int64_t>(now() * 1.0e6);
+}
+
+bool Profiler::allocateQueries(uint64_t& query) {
+    if (m_queryHead + 2 - m_queryTail > QUERY_RING_SIZE) {
+        return false;
+    }
+    query = m_queryHead;
+    m_queryHead += 2;
+    return true;
+}
+
+void Profiler::addCpuZone(const Zone& zone) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_current.frame.cpuZones.push_back(zone);
+    m_current.frame.cpuZones.back().thread = getThreadIndex();
+}
+
+uint32_t Profiler::getThreadIndex() {
+    const auto id = std::this_thread::get_id();
+    const auto found = std::find(m_threads.begin(), m_threads.end(), id);
+    if (found != m_threads.end()) {
+        return static_cast<uint32_t>(found - m_threads.begin());
+    }
+    m_threads.push_back(id);
+    return static_cast<uint32_t>(m_threads.size() - 1);
+}
+
+bool Profiler::resolve(PendingFrame& pending) {
+    // Queries finish in submission order, but nested zones end before their parents; check every end query
+    for (const auto& zone : pending.gpuZones) {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(getQuery(zone.query + 1), GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+
+    for (const auto& zone : pending.gpuZones) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(getQuery(zone.query), GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(getQuery(zone.query + 1), GL_QUERY_RESULT, &end);
+        pending.frame.gpuZones.push_back({
+            zone.name,
+            (static_cast<int64_t>(begin) - m_gpuOffset) / 1.0e6,
+            (static_cast<int64_t>(end) - m_gpuOffset) / 1.0e6,
+            zone.depth,
+            0
+        });
+    }
+    return true;
+}
+
+void Profiler::newFrame() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_current.frame.end = now();
+        m_current.queryEnd = m_queryHead;
+        const auto index = m_current.frame.index;
+        m_inFlight.push_back(std::move(m_current));
+
+        m_current = PendingFrame();
+        m_current.frame.index = index + 1;
+        m_current.frame.start = m_inFlight.back().frame.end;
+    }
+
+    // Move every frame whose GPU results are ready into the history, oldest first
+    while (!m_inFlight.empty()) {
+        auto& pending = m_inFlight.front();
+        const bool resolved = resolve(pending);
+        if (!resolved && m_inFlight.size() <= MAX_FRAMES_IN_FLIGHT) {
+            break;
+        }
+        if (!resolved) {
+            m_droppedGpuZones += pending.gpuZones.size();
+        }
+
+        m_queryTail = pending.queryEnd;
+        if (pending.frame.index == 0) {
+            m_loading = std::move(pending.frame);
+        }
+        else if (!m_paused) {
+            m_history.push_back(std::move(pending.frame));
+            if (m_history.size() > HISTORY_FRAMES) {
+                m_history.pop_front();
+            }
+        }
+        m_inFlight.pop_front();
+    }
+}
+
+void Profiler::destroy() {
+    if (!m_queries.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data());
+        m_queries.clear();
+    }
+    m_gpuSupported = false;
+    m_inFlight.clear();
+    m_current.gpuZones.clear();
+}
+
+bool Profiler::exportChromeTrace(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Profiler: Could not write trace " << path << std::endl;
+        return false;
+    }
+
+    // Process 1 holds the CPU threads, process 2 the GPU queue
+    constexpr int CPU_PROCESS = 1;
+    constexpr int GPU_PROCESS = 2;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << CPU_PROCESS << ",\"args\":{\"name\":\"CPU\"}}";
+    out << ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << GPU_PROCESS << ",\"args\":{\"name\":\"GPU\"}}";
+
+    bool first = false;
+    const auto write_frame = [&](const Frame& frame) {
+        for (const auto& zone : frame.cpuZones) {
+            writeEvent(out, first, zone, CPU_PROCESS);
+        }
+        for (const auto& zone : frame.gpuZones) {
+            writeEvent(out, first, zone, GPU_PROCESS);
+        }
+        if (frame.index > 0) {
+            writeEvent(out, first, { "Frame", frame.start, frame.end, 0, 0 }, CPU_PROCESS);
+        }
+    };
+
+    write_frame(m_loading);
+    for (const auto& frame : m_history) {
+        write_frame(frame);
+    }
+    out << "\n]}\n";
+
+    if (!out) {
+        std::cerr << "Profiler: Failed writing trace " << path << std::endl;
+        return false;
+    }
+    std::cout << "Profiler: Wrote trace " << path << std::endl;
+    return true;
+}
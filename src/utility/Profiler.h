@@ -0,0 +1,141 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Hierarchical frame profiler for CPU and GPU work.
+// Zones are RAII scopes: CpuZone times the enclosing block on the calling thread, GpuZone brackets the GL
+// commands issued inside it with timestamp queries. Queries come from a fixed ring and are only read once
+// the driver reports them available, so the CPU never waits on the GPU; GPU zones of a frame appear a few
+// frames later. Zones recorded before the first newFrame() (loading) are kept for the trace export.
+class Profiler {
+    public:
+        // Completed frames kept for the UI and the trace export
+        static constexpr size_t HISTORY_FRAMES = 240;
+        // Timestamp queries, two per GPU zone
+        static constexpr uint32_t QUERY_RING_SIZE = 1024;
+
+        struct Zone {
+            const char* name;   // must outlive the profiler, zones are named with string literals
+            double start;       // milliseconds since the profiler was created
+            double end;
+            uint32_t depth;
+            uint32_t thread;    // CPU: order in which threads first recorded a zone; GPU: 0
+        };
+
+        struct Frame {
+            uint64_t index { 0 };
+            double start { 0.0 };
+            double end { 0.0 };
+            std::vector<Zone> cpuZones;
+            std::vector<Zone> gpuZones;
+
+            double getDuration() const { return end - start; }
+        };
+
+        class CpuZone {
+            public:
+                explicit CpuZone(const char* name);
+                ~CpuZone();
+
+                CpuZone(const CpuZone&) = delete;
+                CpuZone& operator=(const CpuZone&) = delete;
+
+            private:
+                const char* m_name;
+                double m_start;
+                uint32_t m_depth;
+        };
+
+        // Needs a current GL context, does nothing if the driver has no timestamp queries
+        class GpuZone {
+            public:
+                explicit GpuZone(const char* name);
+                ~GpuZone();
+
+                GpuZone(const GpuZone&) = delete;
+                GpuZone& operator=(const GpuZone&) = delete;
+
+            private:
+                const char* m_name;
+                uint64_t m_query;
+                uint32_t m_depth;
+                bool m_active;
+        };
+
+        static auto& getInstance() {
+            static Profiler instance;
+            return instance;
+        }
+
+        // Closes the current frame and starts the next; call once per frame on the GL thread
+        void newFrame();
+        // Deletes the query objects, call before the GL context goes away
+        void destroy();
+
+        void setPaused(const bool paused) { m_paused = paused; }
+        bool isPaused() const { return m_paused; }
+
+        // Oldest first
+        const std::deque<Frame>& getHistory() const { return m_history; }
+        // GPU zones dropped because the query ring was full
+        uint64_t getDroppedGpuZones() const { return m_droppedGpuZones; }
+
+        // Loading zones and the frame history in the Chrome trace event format (chrome://tracing, Perfetto)
+        bool exportChromeTrace(const std::string& path) const;
+
+        double now() const;
+
+    private:
+        // GPU zone whose queries have not been read yet
+        struct PendingGpuZone {
+            const char* name;
+            uint64_t query;     // ring position of the begin query, the end query follows it
+            uint32_t depth;
+        };
+
+        struct PendingFrame {
+            Frame frame;
+            std::vector<PendingGpuZone> gpuZones;
+            uint64_t queryEnd { 0 };    // ring position after the frame's last query
+        };
+
+        Profiler();
+
+        void initGpu();
+        bool allocateQueries(uint64_t& query);
+        GLuint getQuery(const uint64_t position) const { return m_queries[position % QUERY_RING_SIZE]; }
+        bool resolve(PendingFrame& pending);
+        void addCpuZone(const Zone& zone);
+        uint32_t getThreadIndex();
+
+        const std::chrono::steady_clock::time_point m_epoch;
+
+        std::mutex m_mutex;
+        PendingFrame m_current;
+        std::deque<PendingFrame> m_inFlight;
+        std::deque<Frame> m_history;
+        Frame m_loading;
+        std::vector<std::thread::id> m_threads;
+        bool m_paused { false };
+
+        // GPU state, GL thread only
+        bool m_gpuInitialized { false };
+        bool m_gpuSupported { false };
+        std::vector<GLuint> m_queries;
+        uint64_t m_queryHead { 0 };     // next query to hand out
+        uint64_t m_queryTail { 0 };     // oldest query not read yet
+        int64_t m_gpuOffset { 0 };      // GPU timestamp minus CPU time, in nanoseconds
+        uint32_t m_gpuDepth { 0 };
+        uint64_t m_droppedGpuZones { 0 };
+};
+
+#endif
@@ -8,73 +8,161 @@
 
 #include <stb_image.h>
 
-unsigned int ResourceManager::loadTexture(std::string path, const bool useMipMaps) const {
+#include "CompressedTexture.h"
+#include "MappedFile.h"
+#include "../graphic/GLState.h"
+
+// S3TC is an extension, not part of the generated core loader
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+namespace {
+    GLenum compressedInternalFormat(const CompressedTexture::format format, const bool srgb) {
+        switch (format) {
+        case CompressedTexture::format_bc1:
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case CompressedTexture::format_bc3:
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case CompressedTexture::format_bc4:
+            return GL_COMPRESSED_RED_RGTC1;
+        case CompressedTexture::format_bc5:
+            return GL_COMPRESSED_RG_RGTC2;
+        case CompressedTexture::format_bc6h:
+            return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+        case CompressedTexture::format_bc7:
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default:
+            return 0;
+        }
+    }
+}
+
+TextureCache::Handle ResourceManager::loadTexture(std::string path, const bool useMipMaps) {
     if (path.empty())
-        return 0;
+        return nullptr;
 
-    std::string new_path = getAssetsPath() + path;
+    if (CompressedTexture::isContainerPath(path)) {
+        return loadCompressedTexture(path);
+    }
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    std::string new_path = getAssetsPath() + path;
 
     int width = 0, height = 0, nrComponents = 0;
     unsigned char* data = stbi_load(new_path.c_str(), &width, &height, &nrComponents, 0);
     if (!data) {
         std::cerr << "Failed to load texture: " << new_path << std::endl;
-        glDeleteTextures(1, &textureID);
-        stbi_image_free(data);
-        return 0;
+        return nullptr;
     }
 
-    GLenum format = 0;
-    switch (nrComponents) {
-        case 1:
-            format = GL_RED;
-            break;
-        case 3:
-            format = GL_RGB;
-            break;
-        case 4:
-            format = GL_RGBA;
-            break;
+    auto texture = textureFromBuffer(data, path, width, height, nrComponents, useMipMaps);
+    stbi_image_free(data);
+    return texture;
+}
+
+TextureCache::Handle ResourceManager::loadCompressedTexture(const std::string path) {
+    const std::string new_path = getAssetsPath() + path;
+
+    MappedFile file;
+    CompressedTexture texture;
+    if (!file.open(new_path) || !texture.parse(file.data(), file.size())) {
+        std::cerr << "Resource Manager: Failed to load compressed texture: " << new_path << std::endl;
+        return nullptr;
     }
 
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    const TextureCache::Parameters parameters{ TextureCache::kind_compressed, static_cast<int32_t>(texture.getWidth()),
+                                               static_cast<int32_t>(texture.getHeight()), 0, true, true };
+    const uint64_t key = TextureCache::makeKey(file.data(), file.size(), parameters);
+    if (auto cached = m_textureCache.find(key)) {
+        return cached;
+    }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    const unsigned int textureID = textureFromCompressed(texture, path);
+    if (!textureID) {
+        return nullptr;
+    }
+    return m_textureCache.insert(key, textureID, texture.getDataSize());
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+unsigned int ResourceManager::textureFromCompressed(const CompressedTexture& texture, const std::string& name) const {
+    const GLenum internal_format = compressedInternalFormat(texture.getFormat(), texture.isSRGB());
+    if (internal_format == 0) {
+        std::cerr << "Resource Manager: Create texture error: " << name << " has no GL format" << std::endl;
+        return 0;
+    }
 
-    if (useMipMaps)
-        glGenerateMipmap(GL_TEXTURE_2D);
+    const bool cubemap = texture.getFaceCount() == 6;
+    const GLenum target = cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
 
-    stbi_image_free(data);
+    // Straight from the file: the blocks are uploaded as stored, every level comes with the container
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    auto& state = GLState::getInstance();
+    state.bindTexture(target, textureID);
+    glTexStorage2D(target, texture.getLevelCount(), internal_format, texture.getWidth(), texture.getHeight());
+    for (uint32_t level = 0; level < texture.getLevelCount(); ++level) {
+        for (uint32_t face = 0; face < texture.getFaceCount(); ++face) {
+            const auto& image = texture.getImage(level, face);
+            const GLenum image_target = cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            glCompressedTexSubImage2D(image_target, level, 0, 0, texture.getLevelWidth(level), texture.getLevelHeight(level),
+                                      internal_format, static_cast<GLsizei>(image.size), image.data);
+        }
+    }
 
+    const GLint wrap = cubemap ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, texture.getLevelCount() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (glGetError() != GL_NO_ERROR) {
+        std::cerr << "Resource Manager: Create texture error: " << name << " (" << CompressedTexture::formatName(texture.getFormat())
+                  << " may not be supported by the driver)" << std::endl;
+        state.deleteTextures(1, &textureID);
+        return 0;
+    }
     return textureID;
 }
 
 unsigned int ResourceManager::loadHDRI(const std::string path) const {
+    int width, height;
+    const auto data{ loadHDRIPixels(path, width, height) };
 
+    if (!data) {
+        std::cerr << "Resource Manager: Failed to load HDRI." << std::endl;
+        std::abort();
+    }
+
+    return hdriFromBuffer(data.get(), width, height);
+}
+
+std::shared_ptr<float> ResourceManager::loadHDRIPixels(const std::string path, int& width, int& height) const {
     stbi_set_flip_vertically_on_load(true);
 
     std::string new_path = getAssetsPath() + path;
 
-    int width, height, nrComp;
-    auto* data{ stbi_loadf(new_path.data(), &width, &height, &nrComp, 0) };
+    int nrComp;
+    // Always RGB, the HDR texture and the SH projection both expect three floats per texel
+    auto* data{ stbi_loadf(new_path.data(), &width, &height, &nrComp, 3) };
 
     stbi_set_flip_vertically_on_load(false);
 
     if (!data) {
-        std::cerr << "Resource Manager: Failed to load HDRI." << std::endl;
-        std::abort();
+        return nullptr;
     }
+    return std::shared_ptr<float>(data, stbi_image_free);
+}
 
+unsigned int ResourceManager::hdriFromBuffer(const float* data, int width, int height) const {
     unsigned int hdrTexture{ 0 };
     glGenTextures(1, &hdrTexture);
-    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+    GLState::getInstance().bindTexture(GL_TEXTURE_2D, hdrTexture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -82,8 +170,6 @@ unsigned int ResourceManager::loadHDRI(const std::string path) const {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    stbi_image_free(data);
-
     return hdrTexture;
 }
 
@@ -102,10 +188,16 @@ std::string ResourceManager::loadTextFile(const std::string path) const {
     return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
 }
 
-unsigned int ResourceManager::textureFromBuffer(void* buffer, std::string name, int width, int height, int nrComponents, const bool useMipMaps) {
+TextureCache::Handle ResourceManager::textureFromBuffer(void* buffer, std::string name, int width, int height, int nrComponents, const bool useMipMaps) {
     if (!buffer) {
         std::cerr << "Resource Manager: Create texture error: " + name << " " << errno << std::endl;
-        return 0;
+        return nullptr;
+    }
+
+    const TextureCache::Parameters parameters{ TextureCache::kind_image, width, height, nrComponents, useMipMaps, true };
+    const uint64_t key = TextureCache::makeKey(buffer, static_cast<size_t>(width) * height * nrComponents, parameters);
+    if (auto cached = m_textureCache.find(key)) {
+        return cached;
     }
 
     GLenum format = 0;
@@ -123,7 +215,7 @@ unsigned int ResourceManager::textureFromBuffer(void* buffer, std::string name,
 
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+    GLState::getInstance().bindTexture(GL_TEXTURE_2D, textureID);
 
     glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, buffer);
 
@@ -135,5 +227,9 @@ unsigned int ResourceManager::textureFromBuffer(void* buffer, std::string name,
     if (useMipMaps)
         glGenerateMipmap(GL_TEXTURE_2D);
 
-    return textureID;
-}
\ No newline at end of file
+    // Unsized formats: drivers pad texels to four bytes, the mip chain adds a third
+    size_t bytes = static_cast<size_t>(width) * height * 4;
+    if (useMipMaps)
+        bytes += bytes / 3;
+    return m_textureCache.insert(key, textureID, bytes);
+}
@@ -1,8 +1,13 @@
 #ifndef RESOURCE_MANAGER_H
 #define RESOURCE_MANAGER_H
 
+#include <memory>
 #include <string>
 
+#include "TextureCache.h"
+
+class CompressedTexture;
+
 class ResourceManager {
     public:
         static auto& getInstance() {
@@ -14,12 +19,27 @@ class ResourceManager {
             return "./../../data/";
         }
 
-        unsigned int loadTexture(std::string path, const bool useMipMaps = true) const;
+        // Textures from loadTexture(), loadCompressedTexture() and textureFromBuffer() go through the cache,
+        // loading identical content again returns the resident texture
+        TextureCache& getTextureCache() { return m_textureCache; }
+
+        // KTX2 and DDS files are uploaded with their own mip chain, useMipMaps only applies to images
+        TextureCache::Handle loadTexture(std::string path, const bool useMipMaps = true);
+        // 2D texture or cubemap, depending on the container; null if the file can't be read
+        TextureCache::Handle loadCompressedTexture(const std::string path);
+        // Not cached, the caller owns the texture
+        unsigned int textureFromCompressed(const CompressedTexture& texture, const std::string& name) const;
         unsigned int loadHDRI(const std::string path) const;
+        // Decoded RGB float texels, bottom row first like loadHDRI; null if the file can't be read
+        std::shared_ptr<float> loadHDRIPixels(const std::string path, int& width, int& height) const;
+        unsigned int hdriFromBuffer(const float* data, int width, int height) const;
 
-        unsigned int textureFromBuffer(void* buffer, std::string name, int width, int height, int nrComponents, const bool useMipMaps = true);
+        TextureCache::Handle textureFromBuffer(void* buffer, std::string name, int width, int height, int nrComponents, const bool useMipMaps = true);
 
         std::string loadTextFile(const std::string path) const;
+
+    private:
+        TextureCache m_textureCache;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "TextureCache.h"
+
+#include <glad/glad.h>
+
+#include "Hash.h"
+#include "../graphic/GLState.h"
+#include "../graphic/GLTextureStreamer.h"
+
+uint64_t TextureCache::makeKey(const void* data, const size_t size, const Parameters& parameters) {
+    uint64_t seed = Hash::combine(0, static_cast<uint64_t>(parameters.source));
+    seed = Hash::combine(seed, static_cast<uint64_t>(static_cast<uint32_t>(parameters.width)) << 32 | static_cast<uint32_t>(parameters.height));
+    seed = Hash::combine(seed, static_cast<uint64_t>(parameters.components));
+    seed = Hash::combine(seed, (parameters.mipmaps ? 1u : 0u) | (parameters.srgbDecode ? 2u : 0u));
+    return Hash::hash64(data, size, seed);
+}
+
+TextureCache::Handle TextureCache::find(const uint64_t key) {
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        ++m_stats.misses;
+        return nullptr;
+    }
+    ++m_stats.hits;
+    return acquire(key, it->second);
+}
+
+TextureCache::Handle TextureCache::insert(const uint64_t key, const unsigned int texture, const size_t bytes) {
+    const auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        // Made twice without a find() in between, keep the first one
+        deleteTexture({ texture, bytes });
+        return acquire(key, it->second);
+    }
+
+    Entry& entry = m_entries[key];
+    entry.texture = std::make_shared<Texture>(Texture{ texture, bytes });
+    entry.serial = m_nextSerial++;
+    entry.references = 0;
+    entry.unused = m_unused.end();
+    m_stats.residentBytes += bytes;
+    ++m_stats.residentCount;
+
+    auto handle = acquire(key, entry);
+    trim();
+    return handle;
+}
+
+void TextureCache::setBudget(const size_t bytes) {
+    m_budget = bytes;
+    trim();
+}
+
+void TextureCache::clear() {
+    for (auto& entry : m_entries) {
+        deleteTexture(*entry.second.texture);
+    }
+    m_entries.clear();
+    m_unused.clear();
+    m_stats.residentBytes = 0;
+    m_stats.residentCount = 0;
+    m_stats.unusedCount = 0;
+}
+
+TextureCache::Handle TextureCache::acquire(const uint64_t key, Entry& entry) {
+    if (entry.references++ == 0 && entry.unused != m_unused.end()) {
+        m_unused.erase(entry.unused);
+        entry.unused = m_unused.end();
+        --m_stats.unusedCount;
+    }
+
+    // The deleter owns a reference to the texture record, so the handle never dangles, even after clear()
+    const auto texture = entry.texture;
+    const uint64_t serial = entry.serial;
+    return Handle(texture.get(), [this, key, serial, texture](const Texture*) {
+        release(key, serial);
+    });
+}
+
+void TextureCache::release(const uint64_t key, const uint64_t serial) {
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end() || it->second.serial != serial) {
+        return;
+    }
+
+    Entry& entry = it->second;
+    if (--entry.references == 0) {
+        m_unused.push_front(key);
+        entry.unused = m_unused.begin();
+        ++m_stats.unusedCount;
+        trim();
+    }
+}
+
+void TextureCache::trim() {
+    while (m_stats.residentBytes > m_budget && !m_unused.empty()) {
+        const auto it = m_entries.find(m_unused.back());
+        m_unused.pop_back();
+        --m_stats.unusedCount;
+
+        deleteTexture(*it->second.texture);
+        m_stats.residentBytes -= it->second.texture->bytes;
+        --m_stats.residentCount;
+        ++m_stats.evictions;
+        m_entries.erase(it);
+    }
+}
+
+void TextureCache::deleteTexture(const Texture& texture) {
+    // A texture can be released before the streamer has filled it
+    GLTextureStreamer::getInstance().cancel(texture.id);
+    GLState::getInstance().deleteTextures(1, &texture.id);
+}
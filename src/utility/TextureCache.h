@@ -0,0 +1,84 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+// GL textures keyed by the hash of their content and of how they were created, so identical images
+// used by several materials or models share one texture.
+// Handles are reference counted. A texture without references stays resident for reuse until the
+// cache exceeds its budget, then the least recently released ones are deleted first. Referenced
+// textures are never evicted, so the budget only bounds what is kept around for reuse.
+class TextureCache {
+    public:
+        static constexpr size_t DEFAULT_BUDGET = 512 * 1024 * 1024;
+
+        // How a texture is made from its bytes, the same bytes made differently are different textures
+        enum kind { kind_image, kind_streamed, kind_compressed };
+
+        struct Parameters {
+            kind source;
+            int32_t width;
+            int32_t height;
+            int32_t components;
+            bool mipmaps;
+            bool srgbDecode;    // only for sRGB formats
+        };
+
+        struct Texture {
+            unsigned int id;
+            size_t bytes;
+        };
+
+        // The texture stays resident while a copy of its handle exists
+        using Handle = std::shared_ptr<const Texture>;
+
+        struct Stats {
+            uint64_t hits { 0 };
+            uint64_t misses { 0 };
+            uint64_t evictions { 0 };
+            size_t residentBytes { 0 };
+            size_t residentCount { 0 };
+            size_t unusedCount { 0 };       // resident without references, evicted first
+        };
+
+        static uint64_t makeKey(const void* data, const size_t size, const Parameters& parameters);
+
+        // Null on a miss
+        Handle find(const uint64_t key);
+        // Takes ownership of texture, bytes is its size in video memory
+        Handle insert(const uint64_t key, const unsigned int texture, const size_t bytes);
+
+        // Evicts unused textures until the resident ones fit, if possible
+        void setBudget(const size_t bytes);
+        size_t getBudget() const { return m_budget; }
+
+        // Deletes every texture, call before the GL context goes away. Handles released later are ignored.
+        void clear();
+
+        const Stats& getStats() const { return m_stats; }
+
+    private:
+        struct Entry {
+            std::shared_ptr<Texture> texture;
+            uint64_t serial;                            // tells releases of an older entry with the same key apart
+            uint32_t references;
+            std::list<uint64_t>::iterator unused;       // into m_unused while references is 0
+        };
+
+        Handle acquire(const uint64_t key, Entry& entry);
+        void release(const uint64_t key, const uint64_t serial);
+        void trim();
+        void deleteTexture(const Texture& texture);
+
+        std::unordered_map<uint64_t, Entry> m_entries;
+        std::list<uint64_t> m_unused;       // most recently released first
+        uint64_t m_nextSerial { 0 };
+        size_t m_budget { DEFAULT_BUDGET };
+        Stats m_stats;
+};
+
+#endif
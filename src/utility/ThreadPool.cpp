@@ -0,0 +1,96 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        // Leave one core for the GL thread
+        const auto hardware_threads = std::thread::hardware_concurrency();
+        thread_count = hardware_threads > 1 ? hardware_threads - 1 : 1;
+    }
+
+    m_workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& func) {
+    if (begin >= end) {
+        return;
+    }
+
+    // Shared so that helpers which only get scheduled after the loop finished can still exit safely,
+    // and the caller waits on finished items rather than on helpers (nested calls never deadlock).
+    struct LoopState {
+        std::atomic<size_t> next;
+        std::atomic<size_t> remaining;
+        size_t end;
+        std::function<void(size_t)> func;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    auto state = std::make_shared<LoopState>();
+    state->next = begin;
+    state->remaining = end - begin;
+    state->end = end;
+    state->func = func;
+
+    // Items are handed out one at a time from a shared counter, so uneven items still balance out
+    const auto run = [state]() {
+        for (size_t i = state->next++; i < state->end; i = state->next++) {
+            state->func(i);
+            if (--state->remaining == 0) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    const auto helper_count = std::min(m_workers.size(), end - begin - 1);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < helper_count; ++i) {
+            m_tasks.emplace(run);
+        }
+    }
+    m_condition.notify_all();
+
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->remaining == 0; });
+}
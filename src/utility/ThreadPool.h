@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+    public:
+        static auto& getInstance() {
+            static ThreadPool instance;
+            return instance;
+        }
+
+        explicit ThreadPool(size_t thread_count = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        template<typename F>
+        std::future<void> submit(F&& task) {
+            auto packaged = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+            auto result = packaged->get_future();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.emplace([packaged]() { (*packaged)(); });
+            }
+            m_condition.notify_one();
+            return result;
+        }
+
+        // Runs func(i) for every i in [begin, end), the calling thread takes part in the work
+        void parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& func);
+
+        size_t getThreadCount() const { return m_workers.size(); }
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stopping { false };
+};
+
+#endif